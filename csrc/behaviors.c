@@ -462,7 +462,8 @@ setuuidtype(struct dcxt_s *dcxp, const struct bv_s *bv, enum proptype_e type)
 
 		/* we are converting strings to objects */
 		if (pp->v.imm.count > 1) {
-			Aobj = acnalloc(pp->v.imm.count * sizeof(struct immobj_s));
+			Aobj = arena_alloc(&dcxp->rootdev->arena,
+							pp->v.imm.count * sizeof(struct immobj_s));
 			if (Aobj == NULL) {
 				acnlogmark(lgERR, "Out of memory");
 				break;
@@ -474,21 +475,17 @@ setuuidtype(struct dcxt_s *dcxp, const struct bv_s *bv, enum proptype_e type)
 		}
 		for (i = 0; i < pp->v.imm.count; ++i) {
 			alias = Astr[i];
-			if ((dcid = acnalloc(UUID_SIZE)) == NULL) {
+			if ((dcid = arena_alloc(&dcxp->rootdev->arena, UUID_SIZE)) == NULL) {
 				acnlogmark(lgERR, "Out of memory");
 			} else if (resolveuuid(dcxp, alias, dcid) == NULL) {
 				acnlogmark(lgERR, "Can't resolve UUID %s", alias);
-				acnfree(dcid);
 				dcid = NULL;
 			}
 			Aobj[i].data = dcid;
 			Aobj[i].size = dcid ? UUID_SIZE : 0;
 			pool_delstr(&dcxp->rootdev->strpool, alias);
 		}
-		if (pp->v.imm.count > 1) {
-			pp->v.imm.t.Aobj = Aobj;
-			acnfree(Astr  /* , pp->v.imm.count * sizeof(ddlchar_t *) */);
-		}
+		if (pp->v.imm.count > 1) pp->v.imm.t.Aobj = Aobj;
 		pp->vtype = VT_imm_object;
 		} break;
 	case VT_NULL:
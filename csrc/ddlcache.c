@@ -0,0 +1,891 @@
+/**********************************************************************/
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2026, the Acacian contributors.
+
+This file forms part of Acacian a full featured implementation of 
+ANSI E1.17 Architecture for Control Networks (ACN)
+
+#tabs=3
+*/
+/**********************************************************************/
+/*
+file: ddlcache.c
+
+Binary cache of parsed device trees.
+
+Parsing the DDL for a device means parsing the device module, all its
+subdevices and the language and behavior sets they use, then
+building the property tree and address map. When <CF_DDL_CACHE> is
+set <parseroot()> saves the finished tree as a single image file
+named by the DCID, and next time the same DCID is requested it maps
+the image instead of parsing.
+
+The image is a copy of the rootdev_s, the ddlprop_s tree, the
+dmpprop_s list, the search map and every string or array they refer
+to, laid out in one block. Pointers within the block are stored as
+offsets from its start and the image ends with a table of the
+locations of every pointer. Loading maps the file privately and adds
+the base address to each of those locations, so the structures can
+then be used exactly as if they had just been parsed.
+
+The image also lists the module files which were read to build it
+with their size and modification time. If any of these has changed
+or can no longer be found the image is ignored and the DDL parsed
+again, which replaces it.
+
+Some things are not saved. Behaviors have already been applied to
+the DMP properties by the time the tree is complete so the bva
+arrays are dropped, as are subdevice parameters which are only used
+during parsing. Labels are saved as literal text in the language
+which was selected when the tree was parsed, except that with
+<CF_DDL_LAZYSTRINGS> a label from a languageset keeps the set UUID
+and key and is reconnected to the set on loading, so the set is
+still only parsed when first looked up. The address map is
+saved in search form and is copied to allocated memory on loading
+since <choosemap()> and <freeamap()> expect to own it.
+
+Images are kept in the directory given by the environment variable
+`DDL_BINCACHE` or in `$HOME/.acacian/ddlbin` beside the default DDL
+directory.
+*/
+/**********************************************************************/
+/*
+Logging level for this source file.
+If not set it will default to the global CF_LOG_DEFAULT
+
+options are
+
+lgOFF lgEMRG lgALRT lgCRIT lgERR lgWARN lgNTCE lgINFO lgDBUG
+*/
+//#define LOGLEVEL lgDBUG
+
+/**********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "acn.h"
+
+/**********************************************************************/
+#if CF_DDL_CACHE
+
+#if CF_DDLACCESS_EPI26 || CF_MAPGEN
+#error CF_DDL_CACHE cannot save EPI26 or mapgen extensions
+#endif
+
+#define DDLC_MAGIC "ACNDDLC"
+/* lazy labels change what label.set holds in the image */
+#define DDLC_VERSION (1 + (CF_DDL_LAZYSTRINGS << 8))
+#define DDLC_EXT ".ddlc"
+#define DDLC_ALIGN 8
+#define DDLC_MAXPATH 256
+
+static const char default_binpath[] = "/.acacian/ddlbin";
+
+/*
+Image header. The sizes of the main structures are included so an
+image written by a build with a different configuration or word size
+is rejected.
+*/
+struct ddlc_hdr_s {
+	char magic[8];
+	uint32_t version;
+	uint16_t endian;
+	uint16_t ptrsize;
+	uint16_t rootsize;
+	uint16_t propsize;
+	uint16_t dpropsize;
+	uint16_t afsize;
+	uint8_t dcid[UUID_SIZE];
+	uint32_t size;
+	uint32_t root;
+	uint32_t nsrcs;
+	uint32_t srcs;
+	uint32_t nrelocs;
+	uint32_t relocs;
+};
+
+struct ddlc_src_s {
+	uint64_t size;
+	int64_t mtime;
+	uint32_t name;
+};
+
+/*
+Image build state. memo maps addresses of source objects which have
+been copied to their offsets in the image so shared objects are only
+copied once and pointers to them can be translated.
+*/
+struct memo_s {
+	const void *src;
+	uint32_t ofs;
+};
+
+struct ddlc_build_s {
+	uint8_t *buf;
+	size_t len;
+	size_t alloc;
+	uint32_t *relocs;
+	size_t nrelocs;
+	size_t relocalloc;
+	struct memo_s *memo;
+	size_t nmemo;
+	size_t memosize;
+	bool fail;
+};
+
+#define AT(b, ofs, type) ((type *)((b)->buf + (ofs)))
+
+/**********************************************************************/
+/*
+Get the path of the image file for a DCID. Returns 0 on success or -1
+if the path cannot be constructed.
+*/
+static int
+binpath(char *buf, const uint8_t *dcid, bool dironly)
+{
+	const char *dir;
+	const char *tail;
+	char dcidstr[UUID_STR_SIZE];
+	int len;
+
+	tail = "";
+	if ((dir = getenv("DDL_BINCACHE")) == NULL) {
+		if ((dir = gethomedir()) == NULL) return -1;
+		tail = default_binpath;
+	}
+	if (dironly) {
+		len = snprintf(buf, DDLC_MAXPATH, "%s%s", dir, tail);
+	} else {
+		len = snprintf(buf, DDLC_MAXPATH, "%s%s%c%s" DDLC_EXT, dir, tail,
+					DIRSEP, uuid2str(dcid, dcidstr));
+	}
+	return (len > 0 && len < DDLC_MAXPATH) ? 0 : -1;
+}
+
+/**********************************************************************/
+/*
+func: ddlcache_addsrc
+
+Add a module file, open on fd, to the list of sources for the tree
+being parsed. Returns 0 on success or -1 on error.
+*/
+int
+ddlcache_addsrc(struct ddlsrc_s **srcs, const ddlchar_t *name, int fd)
+{
+	struct ddlsrc_s *src;
+	struct stat st;
+
+	if (fstat(fd, &st) < 0) return -1;
+	if ((src = acnalloc(sizeof(struct ddlsrc_s) + strlen(name) + 1)) == NULL)
+		return -1;
+	src->size = st.st_size;
+	src->mtime = st.st_mtime;
+	strcpy(src->name, name);
+	src->nxt = *srcs;
+	*srcs = src;
+	return 0;
+}
+
+/**********************************************************************/
+/*
+func: ddlcache_freesrcs
+
+Free a list of sources built by <ddlcache_addsrc()>.
+*/
+void
+ddlcache_freesrcs(struct ddlsrc_s *srcs)
+{
+	struct ddlsrc_s *src;
+
+	while ((src = srcs) != NULL) {
+		srcs = src->nxt;
+		acnfree(src);
+	}
+}
+
+/**********************************************************************/
+/*
+Image building
+*/
+/**********************************************************************/
+static uint32_t
+memofind(struct ddlc_build_s *b, const void *src)
+{
+	size_t i;
+
+	if (b->memosize == 0) return 0;
+	for (i = ((uintptr_t)src >> 3) & (b->memosize - 1); b->memo[i].src;
+			i = (i + 1) & (b->memosize - 1))
+	{
+		if (b->memo[i].src == src) return b->memo[i].ofs;
+	}
+	return 0;
+}
+
+/**********************************************************************/
+static void
+memoadd(struct ddlc_build_s *b, const void *src, uint32_t ofs)
+{
+	size_t i;
+
+	if ((b->nmemo + 1) * 2 > b->memosize) {
+		struct memo_s *old = b->memo;
+		size_t oldsize = b->memosize;
+		size_t j;
+
+		b->memosize = oldsize ? oldsize * 2 : 256;
+		if ((b->memo = acnalloc(b->memosize * sizeof(struct memo_s))) == NULL) {
+			b->memo = old;
+			b->memosize = oldsize;
+			b->fail = true;
+			return;
+		}
+		memset(b->memo, 0, b->memosize * sizeof(struct memo_s));
+		b->nmemo = 0;
+		for (j = 0; j < oldsize; ++j) {
+			if (old[j].src) memoadd(b, old[j].src, old[j].ofs);
+		}
+		if (old) acnfree(old);
+	}
+	for (i = ((uintptr_t)src >> 3) & (b->memosize - 1); b->memo[i].src;
+			i = (i + 1) & (b->memosize - 1)) {}
+	b->memo[i].src = src;
+	b->memo[i].ofs = ofs;
+	++b->nmemo;
+}
+
+/**********************************************************************/
+/*
+Append size bytes from src (or zeros if src is NULL) to the image and
+return their offset.
+*/
+static uint32_t
+bput(struct ddlc_build_s *b, const void *src, size_t size)
+{
+	size_t ofs;
+
+	ofs = (b->len + DDLC_ALIGN - 1) & ~(size_t)(DDLC_ALIGN - 1);
+	if (ofs + size > b->alloc) {
+		size_t nalloc;
+		uint8_t *nbuf;
+
+		for (nalloc = b->alloc ? b->alloc : 4096; nalloc < ofs + size;)
+			nalloc *= 2;
+		if (nalloc > UINT32_MAX || (nbuf = realloc(b->buf, nalloc)) == NULL) {
+			b->fail = true;
+			return 0;
+		}
+		b->buf = nbuf;
+		b->alloc = nalloc;
+	}
+	memset(b->buf + b->len, 0, ofs - b->len);
+	if (src) memcpy(b->buf + ofs, src, size);
+	else memset(b->buf + ofs, 0, size);
+	b->len = ofs + size;
+	return (uint32_t)ofs;
+}
+
+/**********************************************************************/
+/*
+As bput() but only copies each source object once.
+*/
+static uint32_t
+bdup(struct ddlc_build_s *b, const void *src, size_t size)
+{
+	uint32_t ofs;
+
+	if ((ofs = memofind(b, src)) == 0) {
+		ofs = bput(b, src, size);
+		if (ofs) memoadd(b, src, ofs);
+	}
+	return ofs;
+}
+
+/**********************************************************************/
+static uint32_t
+bstr(struct ddlc_build_s *b, const ddlchar_t *str)
+{
+	if (str == NULL) return 0;
+	return bdup(b, str, (strlen(str) + 1) * sizeof(ddlchar_t));
+}
+
+/**********************************************************************/
+/*
+Set the pointer at offset fld in the image to point to offset target
+(NULL if target is 0) and add it to the relocation table.
+*/
+static void
+bptr(struct ddlc_build_s *b, uint32_t fld, uint32_t target)
+{
+	if (b->fail) return;
+	*AT(b, fld, uintptr_t) = target;
+	if (target == 0) return;
+	if (b->nrelocs == b->relocalloc) {
+		uint32_t *nr;
+
+		b->relocalloc = b->relocalloc ? b->relocalloc * 2 : 256;
+		if ((nr = realloc(b->relocs, b->relocalloc * sizeof(uint32_t))) == NULL) {
+			b->fail = true;
+			return;
+		}
+		b->relocs = nr;
+	}
+	b->relocs[b->nrelocs++] = fld;
+}
+
+/**********************************************************************/
+/*
+Point field fld at the already copied object src. Failure to find
+src means the tree refers to something which is not saved.
+*/
+static void
+bref(struct ddlc_build_s *b, uint32_t fld, const void *src)
+{
+	uint32_t ofs = 0;
+
+	if (src && (ofs = memofind(b, src)) == 0) {
+		acnlogmark(lgWARN, "Unsaved reference in device tree");
+		b->fail = true;
+	}
+	bptr(b, fld, ofs);
+}
+
+/**********************************************************************/
+static void
+putprops(struct ddlc_build_s *b, struct ddlprop_s *pp)
+{
+	for (; pp; pp = pp->siblings) {
+		bdup(b, pp, sizeof(struct ddlprop_s));
+		putprops(b, pp->children);
+	}
+}
+
+/**********************************************************************/
+#define PROPFLD(ofs, fld) ((ofs) + offsetof(struct ddlprop_s, fld))
+
+static void
+fixprop(struct ddlc_build_s *b, struct ddlprop_s *pp)
+{
+	uint32_t ofs;
+	uint32_t arr;
+	uint32_t i;
+
+	ofs = memofind(b, pp);
+	bref(b, PROPFLD(ofs, parent), pp->parent);
+	bref(b, PROPFLD(ofs, siblings), pp->siblings);
+	bref(b, PROPFLD(ofs, children), pp->children);
+	bref(b, PROPFLD(ofs, arrayprop), pp->arrayprop);
+	bptr(b, PROPFLD(ofs, bva), 0);
+	bptr(b, PROPFLD(ofs, id), bstr(b, pp->id));
+#if CF_DDL_STRINGS
+#if CF_DDL_LAZYSTRINGS
+	if (pp->label.set) {
+		/* save the set UUID in place of the pointer - see relinklabels() */
+		bptr(b, PROPFLD(ofs, label.set),
+				bput(b, pp->label.set->uuid, UUID_SIZE));
+		bptr(b, PROPFLD(ofs, label.txt), bstr(b, pp->label.txt));
+	} else
+#endif
+	{
+		bptr(b, PROPFLD(ofs, label.set), 0);
+		bptr(b, PROPFLD(ofs, label.txt), bstr(b, lblookup(&pp->label)));
+	}
+#endif
+
+	switch (pp->vtype) {
+	case VT_NULL:
+	case VT_imm_unknown:
+	case VT_implied:
+		break;
+	case VT_network:
+		bref(b, PROPFLD(ofs, v.net.dmp), pp->v.net.dmp);
+		break;
+	case VT_include:
+	case VT_device:
+		/* parameter strings only live as long as the parse */
+		bptr(b, PROPFLD(ofs, v.dev.params), 0);
+		break;
+	case VT_alias:
+		bref(b, PROPFLD(ofs, v.alias), pp->v.alias);
+		break;
+	case VT_imm_uint:
+	case VT_imm_sint:
+		if (pp->v.imm.count > 1) {
+			arr = bput(b, pp->v.imm.t.ptr, pp->v.imm.count * sizeof(uint32_t));
+			bptr(b, PROPFLD(ofs, v.imm.t.ptr), arr);
+		}
+		break;
+	case VT_imm_float:
+		if (pp->v.imm.count > 1) {
+			arr = bput(b, pp->v.imm.t.ptr, pp->v.imm.count * sizeof(double));
+			bptr(b, PROPFLD(ofs, v.imm.t.ptr), arr);
+		}
+		break;
+	case VT_imm_string:
+		if (pp->v.imm.count > 1) {
+			arr = bput(b, NULL, pp->v.imm.count * sizeof(ddlchar_t *));
+			for (i = 0; i < pp->v.imm.count; ++i) {
+				bptr(b, arr + i * sizeof(ddlchar_t *),
+						bstr(b, pp->v.imm.t.Astr[i]));
+			}
+			bptr(b, PROPFLD(ofs, v.imm.t.Astr), arr);
+		} else {
+			bptr(b, PROPFLD(ofs, v.imm.t.str), bstr(b, pp->v.imm.t.str));
+		}
+		break;
+	case VT_imm_object: {
+		struct immobj_s *obj;
+		uint32_t count;
+
+		if (pp->v.imm.count > 1) {
+			obj = pp->v.imm.t.Aobj;
+			count = pp->v.imm.count;
+			arr = bput(b, obj, count * sizeof(struct immobj_s));
+			bptr(b, PROPFLD(ofs, v.imm.t.Aobj), arr);
+		} else {
+			obj = &pp->v.imm.t.obj;
+			count = 1;
+			arr = PROPFLD(ofs, v.imm.t.obj);
+		}
+		for (i = 0; i < count; ++i, ++obj) {
+			bptr(b, arr + i * sizeof(struct immobj_s)
+						+ offsetof(struct immobj_s, data),
+					(obj->data && obj->size > 0)
+						? bput(b, obj->data, obj->size) : 0);
+		}
+	}	break;
+	}
+}
+
+/**********************************************************************/
+static void
+fixprops(struct ddlc_build_s *b, struct ddlprop_s *pp)
+{
+	for (; pp && !b->fail; pp = pp->siblings) {
+		fixprop(b, pp);
+		fixprops(b, pp->children);
+	}
+}
+
+/**********************************************************************/
+static uint32_t
+putamap(struct ddlc_build_s *b, union addrmap_u *amap)
+{
+	uint32_t aofs;
+	uint32_t mofs;
+	uint32_t afofs;
+	struct addrfind_s *af;
+	uint32_t i;
+	int j;
+
+	if (amap->any.type != am_srch) {
+		acnlogmark(lgNTCE, "Only search maps can be cached");
+		b->fail = true;
+		return 0;
+	}
+	aofs = bput(b, amap, sizeof(union addrmap_u));
+	mofs = bput(b, amap->srch.map, amap->srch.count * sizeof(struct addrfind_s));
+	if (b->fail) return 0;
+	AT(b, aofs, union addrmap_u)->srch.size =
+				amap->srch.count * sizeof(struct addrfind_s);
+	bptr(b, aofs + offsetof(struct srch_amap_s, map), mofs);
+
+	for (i = 0, af = amap->srch.map; i < amap->srch.count; ++i, ++af) {
+		afofs = mofs + i * sizeof(struct addrfind_s);
+		if (af->ntests > 1) {
+			uint32_t pofs;
+
+			pofs = bput(b, NULL, af->ntests * sizeof(struct dmpprop_s *));
+			for (j = 0; j < af->ntests; ++j) {
+				bref(b, pofs + j * sizeof(struct dmpprop_s *), af->p.pa[j]);
+			}
+			bptr(b, afofs + offsetof(struct addrfind_s, p.pa), pofs);
+		} else {
+			bref(b, afofs + offsetof(struct addrfind_s, p.prop), af->p.prop);
+		}
+		bptr(b, afofs + offsetof(struct addrfind_s, hits), af->hits
+					? bput(b, af->hits, af->adhi - af->adlo + 1) : 0);
+	}
+	return aofs;
+}
+
+/**********************************************************************/
+/*
+Write the image to its file. Write to a temporary name then rename
+so a reader never sees a partial image.
+*/
+static int
+writeimage(const uint8_t *dcid, const uint8_t *buf, size_t len)
+{
+	char path[DDLC_MAXPATH];
+	char tmp[DDLC_MAXPATH + 16];
+	char *cp;
+	int fd;
+	ssize_t n;
+
+	if (binpath(path, dcid, true) < 0) return -1;
+	/* create the directory and any missing parents */
+	for (cp = path + 1; ; ++cp) {
+		if (*cp == DIRSEP || *cp == 0) {
+			char c = *cp;
+
+			*cp = 0;
+			if (mkdir(path, 0777) < 0 && errno != EEXIST) return -1;
+			if ((*cp = c) == 0) break;
+		}
+	}
+	if (binpath(path, dcid, false) < 0) return -1;
+	snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+
+	if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) return -1;
+	for (; len > 0; buf += n, len -= n) {
+		if ((n = write(fd, buf, len)) < 0) {
+			if (errno == EINTR) {
+				n = 0;
+				continue;
+			}
+			close(fd);
+			unlink(tmp);
+			return -1;
+		}
+	}
+	if (close(fd) < 0 || rename(tmp, path) < 0) {
+		unlink(tmp);
+		return -1;
+	}
+	acnlogmark(lgINFO, "Cached device tree as %s", path);
+	return 0;
+}
+
+/**********************************************************************/
+/*
+func: ddlcache_save
+
+Save a newly parsed device tree in the cache with the list of module
+files it was built from. Returns 0 on success or -1 on failure.
+*/
+int
+ddlcache_save(struct rootdev_s *root, const struct ddlsrc_s *srcs)
+{
+	struct ddlc_build_s b;
+	struct ddlc_hdr_s *hdr;
+	struct dmpprop_s *dp;
+	const struct ddlsrc_s *src;
+	uint32_t rofs;
+	uint32_t sofs;
+	uint32_t nsrcs;
+	uint32_t i;
+	int rslt;
+
+	LOG_FSTART();
+	if (root->amap == NULL || root->ddlroot == NULL) return -1;
+	memset(&b, 0, sizeof(b));
+	bput(&b, NULL, sizeof(struct ddlc_hdr_s));
+
+	/* copy all properties first so references can be resolved */
+	putprops(&b, root->ddlroot);
+	for (dp = root->dmpprops; dp; dp = dp->nxt)
+		bdup(&b, dp, dmppropsize(dp->ndims));
+
+	fixprops(&b, root->ddlroot);
+	for (dp = root->dmpprops; dp; dp = dp->nxt) {
+		uint32_t ofs = memofind(&b, dp);
+
+		bref(&b, ofs + offsetof(struct dmpprop_s, nxt), dp->nxt);
+		bref(&b, ofs + offsetof(struct dmpprop_s, prop), dp->prop);
+	}
+
+	rofs = bput(&b, root, sizeof(struct rootdev_s));
+	if (!b.fail) {
+		struct rootdev_s *r = AT(&b, rofs, struct rootdev_s);
+
+		memset(&r->strpool, 0, sizeof(r->strpool));
+		memset(&r->arena, 0, sizeof(r->arena));
+		memset(&r->idtab, 0, sizeof(r->idtab));
+		r->cache = NULL;
+		r->cachesize = 0;
+		r->usecount = 0;
+		r->memsize = 0;
+		r->lru.l = r->lru.r = NULL;
+	}
+	bref(&b, rofs + offsetof(struct rootdev_s, ddlroot), root->ddlroot);
+	bref(&b, rofs + offsetof(struct rootdev_s, dmpprops), root->dmpprops);
+	bptr(&b, rofs + offsetof(struct rootdev_s, amap), putamap(&b, root->amap));
+
+	for (nsrcs = 0, src = srcs; src; src = src->nxt) ++nsrcs;
+	sofs = bput(&b, NULL, nsrcs * sizeof(struct ddlc_src_s));
+	for (i = 0, src = srcs; src && !b.fail; src = src->nxt, ++i) {
+		uint32_t nofs = bstr(&b, src->name);
+		struct ddlc_src_s *s = AT(&b, sofs, struct ddlc_src_s) + i;
+
+		s->size = src->size;
+		s->mtime = src->mtime;
+		s->name = nofs;
+	}
+
+	if (!b.fail) {
+		uint32_t relofs;
+
+		relofs = bput(&b, b.relocs, b.nrelocs * sizeof(uint32_t));
+		hdr = AT(&b, 0, struct ddlc_hdr_s);
+		memcpy(hdr->magic, DDLC_MAGIC, sizeof(hdr->magic));
+		hdr->version = DDLC_VERSION;
+		hdr->endian = 0x0102;
+		hdr->ptrsize = sizeof(void *);
+		hdr->rootsize = sizeof(struct rootdev_s);
+		hdr->propsize = sizeof(struct ddlprop_s);
+		hdr->dpropsize = sizeof(struct dmpprop_s);
+		hdr->afsize = sizeof(struct addrfind_s);
+		uuidcpy(hdr->dcid, root->dcid);
+		hdr->size = b.len;
+		hdr->root = rofs;
+		hdr->nsrcs = nsrcs;
+		hdr->srcs = sofs;
+		hdr->nrelocs = b.nrelocs;
+		hdr->relocs = relofs;
+	}
+	rslt = -1;
+	if (b.fail) {
+		acnlogmark(lgNTCE, "Can't cache device tree");
+	} else if ((rslt = writeimage(root->dcid, b.buf, b.len)) < 0) {
+		acnlogerror(lgNTCE);
+	}
+	free(b.buf);
+	free(b.relocs);
+	if (b.memo) acnfree(b.memo);
+	LOG_FEND();
+	return rslt;
+}
+
+/**********************************************************************/
+/*
+Image loading
+*/
+/**********************************************************************/
+/*
+Check each of the source modules recorded in an image against the
+current files.
+*/
+static bool
+srcsvalid(const uint8_t *base, const struct ddlc_hdr_s *hdr)
+{
+	const struct ddlc_src_s *src;
+	struct stat st;
+	const char *name;
+	uint32_t i;
+	int fd;
+
+	src = (const struct ddlc_src_s *)(base + hdr->srcs);
+	for (i = 0; i < hdr->nsrcs; ++i, ++src) {
+		if (src->name >= hdr->size
+			|| memchr(base + src->name, 0, hdr->size - src->name) == NULL)
+			return false;
+		name = (const char *)base + src->name;
+		if ((fd = openddl(name)) < 0) {
+			acnlogmark(lgINFO, "Cached source %s not found", name);
+			return false;
+		}
+		if (fstat(fd, &st) < 0 || (uint64_t)st.st_size != src->size
+			|| (int64_t)st.st_mtime != src->mtime)
+		{
+			acnlogmark(lgINFO, "Cached source %s has changed", name);
+			close(fd);
+			return false;
+		}
+		close(fd);
+	}
+	return true;
+}
+
+/**********************************************************************/
+static bool
+hdrvalid(const struct ddlc_hdr_s *hdr, size_t size, const uint8_t *dcid)
+{
+	return (memcmp(hdr->magic, DDLC_MAGIC, sizeof(hdr->magic)) == 0
+		&& hdr->version == DDLC_VERSION
+		&& hdr->endian == 0x0102
+		&& hdr->ptrsize == sizeof(void *)
+		&& hdr->rootsize == sizeof(struct rootdev_s)
+		&& hdr->propsize == sizeof(struct ddlprop_s)
+		&& hdr->dpropsize == sizeof(struct dmpprop_s)
+		&& hdr->afsize == sizeof(struct addrfind_s)
+		&& uuidsEq(hdr->dcid, dcid)
+		&& hdr->size == size
+		&& hdr->root <= size - sizeof(struct rootdev_s)
+		&& hdr->srcs <= size
+		&& hdr->nsrcs <= (size - hdr->srcs) / sizeof(struct ddlc_src_s)
+		&& hdr->relocs <= size
+		&& hdr->nrelocs <= (size - hdr->relocs) / sizeof(uint32_t)
+	);
+}
+
+/**********************************************************************/
+#if CF_DDL_LAZYSTRINGS
+/*
+Labels which refer to a languageset were saved with the set's UUID 
+in place of the set pointer. Find or create the set for each.
+*/
+static int
+relinklabels(struct ddlprop_s *pp)
+{
+	struct lset_s *set;
+	size_t create;
+
+	for (; pp; pp = pp->siblings) {
+		if (pp->label.set) {
+			create = sizeof(struct lset_s);
+			set = (struct lset_s *)findornewuuid(&languagesets,
+						(const uint8_t *)pp->label.set, &create);
+			if (set == NULL) return -1;
+			if (create == 0) set->hasht.pool = &permpool;
+			pp->label.set = set;
+		}
+		if (relinklabels(pp->children) < 0) return -1;
+	}
+	return 0;
+}
+#endif
+
+/**********************************************************************/
+/*
+Copy the search map out of the image so it can be transformed or
+freed like any other.
+*/
+static union addrmap_u *
+thawamap(const union addrmap_u *imap)
+{
+	union addrmap_u *amap;
+	struct addrfind_s *af;
+	uint32_t i;
+
+	amap = acnNew(union addrmap_u);
+	*amap = *imap;
+	if (amap->srch.count == 0) {
+		amap->srch.map = NULL;
+		return amap;
+	}
+	amap->srch.map = mallocx(amap->srch.size);
+	memcpy(amap->srch.map, imap->srch.map, amap->srch.size);
+	for (i = 0, af = amap->srch.map; i < amap->srch.count; ++i, ++af) {
+		if (af->ntests > 1) {
+			struct dmpprop_s **pa;
+
+			pa = mallocx(af->ntests * sizeof(*pa));
+			memcpy(pa, af->p.pa, af->ntests * sizeof(*pa));
+			af->p.pa = pa;
+		}
+		if (af->hits) {
+			uint8_t *hits;
+
+			hits = mallocx(af->adhi - af->adlo + 1);
+			memcpy(hits, af->hits, af->adhi - af->adlo + 1);
+			af->hits = hits;
+		}
+	}
+	return amap;
+}
+
+/**********************************************************************/
+/*
+func: ddlcache_load
+
+Load the device tree for a DCID from the cache. name is the DCID as
+a string as passed to <parseroot()>.
+
+Returns the device tree or NULL if name is not a DCID or there is no
+valid image for it.
+*/
+struct rootdev_s *
+ddlcache_load(const ddlchar_t *name)
+{
+	uint8_t dcid[UUID_SIZE];
+	char path[DDLC_MAXPATH];
+	struct stat st;
+	uint8_t *base;
+	const struct ddlc_hdr_s *hdr;
+	const uint32_t *rp;
+	struct rootdev_s *root;
+	size_t size;
+	uint32_t i;
+	int fd;
+
+	LOG_FSTART();
+	if (str2uuid(name, dcid) != 0 || binpath(path, dcid, false) < 0)
+		return NULL;
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		acnlogmark(lgDBUG, "No cached tree for %s", name);
+		return NULL;
+	}
+	base = MAP_FAILED;
+	size = 0;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(struct ddlc_hdr_s)
+			&& st.st_size <= UINT32_MAX) {
+		size = st.st_size;
+		/* private mapping so relocation writes are not seen by others */
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (base == MAP_FAILED) return NULL;
+
+	hdr = (const struct ddlc_hdr_s *)base;
+	if (!hdrvalid(hdr, size, dcid)) {
+		acnlogmark(lgNTCE, "Ignoring bad or incompatible image %s", path);
+		goto fail;
+	}
+	if (!srcsvalid(base, hdr)) goto fail;
+
+	rp = (const uint32_t *)(base + hdr->relocs);
+	for (i = 0; i < hdr->nrelocs; ++i, ++rp) {
+		uintptr_t *fld;
+
+		if (*rp > size - sizeof(uintptr_t) || (*rp % sizeof(uintptr_t)) != 0)
+			goto corrupt;
+		fld = (uintptr_t *)(base + *rp);
+		if (*fld == 0 || *fld >= size) goto corrupt;
+		*fld += (uintptr_t)base;
+	}
+	root = (struct rootdev_s *)(base + hdr->root);
+#if CF_DDL_LAZYSTRINGS
+	if (relinklabels(root->ddlroot) < 0) goto fail;
+#endif
+	root->amap = thawamap(root->amap);
+	root->cache = base;
+	root->cachesize = size;
+	acnlogmark(lgINFO, "Loaded device tree %s from cache", name);
+	LOG_FEND();
+	return root;
+
+corrupt:
+	acnlogmark(lgNTCE, "Corrupt image %s", path);
+fail:
+	munmap(base, size);
+	LOG_FEND();
+	return NULL;
+}
+
+/**********************************************************************/
+/*
+func: ddlcache_free
+
+Free a device tree loaded by <ddlcache_load()>. Called by
+<freerootdev()>.
+*/
+void
+ddlcache_free(struct rootdev_s *root)
+{
+	LOG_FSTART();
+	if (root->amap) freeamap(root->amap);
+	munmap(root->cache, root->cachesize);
+	LOG_FEND();
+}
+
+#endif  /* CF_DDL_CACHE */
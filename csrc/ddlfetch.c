@@ -0,0 +1,708 @@
+/**********************************************************************/
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2026, the Acacian contributors.
+
+This file forms part of Acacian a full featured implementation of
+ANSI E1.17 Architecture for Control Networks (ACN)
+
+#tabs=3
+*/
+/**********************************************************************/
+/*
+file: ddlfetch.c
+
+Retrieval of DDL modules from devices by TFTP as required by EPI-11.
+
+A device says where its DDL can be found in its SLP
+device-description attribute (EPI-19), usually as
+`$:tftp://<address>/$.ddl` where each `$` after the colon stands
+for the UUID of a module. If a device's root module is not available
+locally, <ddlfetch()> fetches it from there together with any of
+the behaviorsets built into the parser which are missing. As each
+module arrives it is scanned for the UUIDs it refers to and any of
+those which cannot be found by <openddl()> are fetched from the same
+place, until everything the device needs is available to the parser.
+
+Transfers run on the event loop (<evloop.c>), each with its own UDP
+socket, and up to <CF_DDL_FETCHMAX> run at once. Each asks for the
+blksize (RFC 2348) and windowsize (RFC 7440) options so that a
+window of several blocks is sent for each acknowledgement. Servers
+which ignore the options get plain RFC 1350 transfers.
+
+A module is written to a temporary file in the first directory of
+the DDL path (see <getddlpath()>) and renamed to `<UUID>.ddl` when
+it is complete, so a partial module is never seen by the parser.
+*/
+/**********************************************************************/
+/*
+Logging level for this source file.
+If not set it will default to the global CF_LOG_DEFAULT
+
+options are
+
+lgOFF lgEMRG lgALRT lgCRIT lgERR lgWARN lgNTCE lgINFO lgDBUG
+*/
+//#define LOGLEVEL lgDBUG
+
+/**********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <expat.h>
+#include "acn.h"
+
+/**********************************************************************/
+#if CF_DDL_FETCH
+
+#define TFTP_RRQ   1
+#define TFTP_DATA  3
+#define TFTP_ACK   4
+#define TFTP_ERROR 5
+#define TFTP_OACK  6
+
+#define TFTP_HDRSIZE 4
+#define TFTP_DFLTBLKSIZE 512
+#define TFTP_PORT "69"
+/* room for the request - file name is checked against this */
+#define TFTP_MAXRQ 512
+
+#if CF_TFTP_BLKSIZE > TFTP_DFLTBLKSIZE
+#define TFTP_RXSIZE (TFTP_HDRSIZE + CF_TFTP_BLKSIZE)
+#else
+#define TFTP_RXSIZE (TFTP_HDRSIZE + TFTP_DFLTBLKSIZE)
+#endif
+
+struct fetch_s;
+
+/*
+A single module transfer. These are kept in a UUID set per fetch so
+each module is only requested once.
+*/
+struct tftpx_s {
+	uint8_t uuid[UUID_SIZE];  /* must be first */
+	poll_fn *rxfn;
+	struct tftpx_s *nxt;  /* all transfers for the fetch */
+	struct tftpx_s *qnxt;  /* waiting to start */
+	struct fetch_s *fetch;
+	int sk;
+	int fd;
+	struct sockaddr_storage peer;  /* server TID once known */
+	socklen_t peerlen;
+	bool started;  /* server has responded */
+	bool optsdone;  /* blksize and window are settled */
+	bool naked;  /* already acked a gap in this window */
+	uint16_t blksize;
+	uint16_t window;
+	uint16_t block;  /* last block received in order */
+	uint16_t unacked;
+	unsigned int retries;
+	size_t txlen;
+	acnTimer_t timer;
+	uint8_t txbuf[TFTP_MAXRQ];
+	char tmpname[];
+};
+
+/*
+A device's tree of modules.
+*/
+struct fetch_s {
+	uint8_t dcid[UUID_SIZE];
+	struct fetch_s *nxt;
+	struct uuidset_s mods;
+	struct tftpx_s *xfers;
+	unsigned int pending;  /* transfers not yet finished */
+	int err;
+	ddlfetch_fn *donefn;
+	void *ref;
+	struct sockaddr_storage srv;
+	socklen_t srvlen;
+	char *dir;
+	char fname[];  /* remote file name - '$' is the module UUID */
+};
+
+static struct fetch_s *fetches = NULL;
+static struct tftpx_s *waitq = NULL;
+static struct tftpx_s **waitqtail = &waitq;
+static unsigned int nactive = 0;
+/* one extra byte terminates ERROR and OACK strings */
+static uint8_t rxbuf[TFTP_RXSIZE + 1];
+
+static void tftp_rx(uint32_t evf, void *evptr);
+static void tftp_timeout(struct acnTimer_s *timer);
+
+/**********************************************************************/
+static int
+writeall(int fd, const uint8_t *data, size_t len)
+{
+	ssize_t sz;
+
+	for (; len > 0; len -= sz, data += sz) {
+		if ((sz = write(fd, data, len)) < 0) return -1;
+	}
+	return 0;
+}
+
+/**********************************************************************/
+/*
+Queue a module for fetching unless it has already been requested or
+is available locally.
+*/
+static void
+wantmodule(struct fetch_s *fetch, const uint8_t *uuid)
+{
+	struct tftpx_s *x;
+	char uuidstr[UUID_STR_SIZE];
+	size_t create;
+	int fd;
+
+	if (finduuid(&fetch->mods, uuid) != NULL) return;
+	if ((fd = openddl(uuid2str(uuid, uuidstr))) >= 0) {
+		close(fd);
+		return;
+	}
+	/* room for "<dir>/.<uuid>.XXXXXX" */
+	create = sizeof(struct tftpx_s) + strlen(fetch->dir) + UUID_STR_SIZE + 9;
+	x = (struct tftpx_s *)findornewuuid(&fetch->mods, uuid, &create);
+	if (x == NULL) {
+		acnlogerror(lgERR);
+		if (fetch->err == 0) fetch->err = ENOMEM;
+		return;
+	}
+	acnlogmark(lgDBUG, "want %s", uuidstr);
+	x->rxfn = &tftp_rx;
+	x->fetch = fetch;
+	x->sk = x->fd = -1;
+	x->timer.action = &tftp_timeout;
+	x->nxt = fetch->xfers;
+	fetch->xfers = x;
+	++fetch->pending;
+	*waitqtail = x;
+	waitqtail = &x->qnxt;
+}
+
+/**********************************************************************/
+/*
+Feed a newly arrived module to the fetch. Any attribute value which
+is a UUID may be a module reference.
+*/
+static void
+scan_start(void *data, const XML_Char *el, const XML_Char **atts)
+{
+	struct fetch_s *fetch = (struct fetch_s *)data;
+	uint8_t uuid[UUID_SIZE];
+
+	for (; *atts; atts += 2) {
+		if (strlen(atts[1]) == UUID_STR_SIZE - 1
+				&& str2uuid(atts[1], uuid) == 0)
+			wantmodule(fetch, uuid);
+	}
+}
+
+static void
+scanrefs(struct fetch_s *fetch, const char *fname)
+{
+	XML_Parser parser;
+	void *buf;
+	int sz;
+	int fd;
+
+	if ((fd = open(fname, O_RDONLY)) < 0) {
+		acnlogerror(lgERR);
+		return;
+	}
+	if ((parser = XML_ParserCreate(NULL)) == NULL) {
+		acnlogerror(lgERR);
+		close(fd);
+		return;
+	}
+	XML_SetStartElementHandler(parser, &scan_start);
+	XML_SetUserData(parser, fetch);
+	do {
+		if ((buf = XML_GetBuffer(parser, 4096)) == NULL
+			|| (sz = read(fd, buf, 4096)) < 0)
+		{
+			acnlogerror(lgERR);
+			break;
+		}
+		if (! XML_ParseBuffer(parser, sz, sz == 0)) {
+			acnlogmark(lgWARN, "Parse error in %s line %lu: %s", fname,
+					(unsigned long)XML_GetCurrentLineNumber(parser),
+					XML_ErrorString(XML_GetErrorCode(parser)));
+			break;
+		}
+	} while (sz > 0);
+	XML_ParserFree(parser);
+	close(fd);
+}
+
+/**********************************************************************/
+/*
+Close down a transfer. If it succeeded, move the module into place
+and queue anything it refers to.
+*/
+static void
+endxfer(struct tftpx_s *x, int err)
+{
+	struct fetch_s *fetch = x->fetch;
+	char uuidstr[UUID_STR_SIZE];
+
+	uuid2str(x->uuid, uuidstr);
+	cancel_timer(&x->timer);
+	if (x->sk >= 0) {
+		evl_register(x->sk, NULL, 0);
+		close(x->sk);
+		x->sk = -1;
+	}
+	if (x->fd >= 0) {
+		if (err == 0 && fsync(x->fd) < 0) err = errno;
+		close(x->fd);
+		x->fd = -1;
+		if (err == 0) {
+			char fname[strlen(fetch->dir) + UUID_STR_SIZE + 6];
+
+			sprintf(fname, "%s%c%s.ddl", fetch->dir, DIRSEP, uuidstr);
+			if (rename(x->tmpname, fname) < 0) {
+				err = errno;
+			} else {
+				acnlogmark(lgINFO, "Fetched %s", fname);
+				scanrefs(fetch, fname);
+			}
+		}
+		if (err) unlink(x->tmpname);
+	}
+	if (err) {
+		acnlogmark(lgWARN, "Fetch %s failed: %s", uuidstr, strerror(err));
+		if (fetch->err == 0) fetch->err = err;
+	}
+	--nactive;
+	--fetch->pending;
+}
+
+/**********************************************************************/
+/*
+Send (or resend) the current request or acknowledgement.
+*/
+static int
+sendpkt(struct tftpx_s *x)
+{
+	const struct sockaddr_storage *to;
+	socklen_t tolen;
+
+	if (x->started) {
+		to = &x->peer;
+		tolen = x->peerlen;
+	} else {
+		to = &x->fetch->srv;
+		tolen = x->fetch->srvlen;
+	}
+	if (sendto(x->sk, x->txbuf, x->txlen, 0,
+				(const struct sockaddr *)to, tolen) < 0
+		&& errno != EAGAIN && errno != EWOULDBLOCK)
+	{
+		return -1;
+	}
+	set_timer(&x->timer, timerval_ms(CF_TFTP_TIMEOUT));
+	return 0;
+}
+
+/**********************************************************************/
+static int
+sendack(struct tftpx_s *x)
+{
+	marshalU16(marshalU16(x->txbuf, TFTP_ACK), x->block);
+	x->txlen = TFTP_HDRSIZE;
+	x->unacked = 0;
+	return sendpkt(x);
+}
+
+/**********************************************************************/
+/*
+Open the socket and temporary file and send the read request.
+*/
+static int
+startxfer(struct tftpx_s *x)
+{
+	struct fetch_s *fetch = x->fetch;
+	char uuidstr[UUID_STR_SIZE];
+	const char *tp;
+	char *cp;
+
+	++nactive;
+	uuid2str(x->uuid, uuidstr);
+	acnlogmark(lgDBUG, "start %s", uuidstr);
+	sprintf(x->tmpname, "%s%c.%s.XXXXXX", fetch->dir, DIRSEP, uuidstr);
+	if ((x->fd = mkstemp(x->tmpname)) < 0) return -1;
+	fchmod(x->fd, 0644);
+	if ((x->sk = socket(fetch->srv.ss_family,
+					SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0
+		|| evl_register(x->sk, &x->rxfn, EPOLLIN) < 0)
+	{
+		return -1;
+	}
+	cp = (char *)marshalU16(x->txbuf, TFTP_RRQ);
+	for (tp = fetch->fname; *tp; ++tp) {
+		if (*tp == '$') cp = stpcpy(cp, uuidstr);
+		else *cp++ = *tp;
+	}
+	*cp++ = 0;
+	cp = stpcpy(cp, "octet") + 1;
+	cp = stpcpy(cp, "blksize") + 1;
+	cp += sprintf(cp, "%u", CF_TFTP_BLKSIZE) + 1;
+	cp = stpcpy(cp, "windowsize") + 1;
+	cp += sprintf(cp, "%u", CF_TFTP_WINDOW) + 1;
+	x->txlen = cp - (char *)x->txbuf;
+	return sendpkt(x);
+}
+
+/**********************************************************************/
+/*
+Start waiting transfers up to the limit, then report any fetches
+which have nothing left to do. The done callback may start another
+fetch so the list is rescanned after each.
+*/
+static void
+service(void)
+{
+	struct tftpx_s *x;
+	struct fetch_s **fpp;
+	struct fetch_s *fetch;
+
+	while (nactive < CF_DDL_FETCHMAX && (x = waitq) != NULL) {
+		if ((waitq = x->qnxt) == NULL) waitqtail = &waitq;
+		x->qnxt = NULL;
+		if (startxfer(x) < 0) endxfer(x, errno);
+	}
+again:
+	for (fpp = &fetches; (fetch = *fpp) != NULL; fpp = &fetch->nxt) {
+		if (fetch->pending) continue;
+		*fpp = fetch->nxt;
+		(*fetch->donefn)(fetch->dcid, fetch->err, fetch->ref);
+		while ((x = fetch->xfers) != NULL) {
+			fetch->xfers = x->nxt;
+			unlinkuuid(&fetch->mods, x->uuid);
+			acnfree(x);
+		}
+		free(fetch->dir);
+		free(fetch);
+		goto again;
+	}
+}
+
+/**********************************************************************/
+/*
+Apply the options the server accepted. Any it does not mention take
+their RFC 1350 values.
+*/
+static int
+parseoack(struct tftpx_s *x, size_t len)
+{
+	const char *cp = (const char *)rxbuf + 2;
+	const char *ep = (const char *)rxbuf + len;
+	const char *opt;
+	unsigned long val;
+
+	x->blksize = TFTP_DFLTBLKSIZE;
+	x->window = 1;
+	while (cp < ep) {
+		opt = cp;
+		cp = strchr(cp, 0) + 1;
+		if (cp >= ep) return -1;
+		val = strtoul(cp, NULL, 10);
+		cp = strchr(cp, 0) + 1;
+		if (strcasecmp(opt, "blksize") == 0) {
+			if (val < 8 || val > CF_TFTP_BLKSIZE) return -1;
+			x->blksize = val;
+		} else if (strcasecmp(opt, "windowsize") == 0) {
+			if (val < 1 || val > CF_TFTP_WINDOW) return -1;
+			x->window = val;
+		} else {
+			acnlogmark(lgDBUG, "ignoring option %s", opt);
+		}
+	}
+	return 0;
+}
+
+/**********************************************************************/
+/*
+Process a packet from the server. Returns non-zero if the transfer
+has finished.
+*/
+static int
+tftp_pkt(struct tftpx_s *x, size_t len)
+{
+	uint16_t blk;
+
+	if (len < TFTP_HDRSIZE) return 0;
+	rxbuf[len] = 0;
+	switch (unmarshalU16(rxbuf)) {
+	case TFTP_OACK:
+		if (x->optsdone) return 0;
+		if (parseoack(x, len) < 0) {
+			errno = EPROTO;
+			return -1;
+		}
+		x->optsdone = true;
+		return sendack(x);
+	case TFTP_DATA:
+		if (!x->optsdone) {
+			/* server ignored our options */
+			x->blksize = TFTP_DFLTBLKSIZE;
+			x->window = 1;
+			x->optsdone = true;
+		}
+		blk = unmarshalU16(rxbuf + 2);
+		len -= TFTP_HDRSIZE;
+		if (blk == (uint16_t)(x->block + 1)) {
+			if (len > x->blksize) {
+				errno = EPROTO;
+				return -1;
+			}
+			if (writeall(x->fd, rxbuf + TFTP_HDRSIZE, len) < 0) return -1;
+			x->block = blk;
+			x->naked = false;
+			x->retries = 0;
+			if (len < x->blksize) {
+				/* last block - the server will retransmit if this is lost */
+				sendack(x);
+				return 1;
+			}
+			if (++x->unacked >= x->window) return sendack(x);
+			set_timer(&x->timer, timerval_ms(CF_TFTP_TIMEOUT));
+		} else if (blk == x->block && x->unacked == 0) {
+			/* our acknowledgement was probably lost */
+			return sendack(x);
+		} else if ((int16_t)(blk - x->block) > 1 && !x->naked) {
+			/* gap - ack what we have so the server restarts from there */
+			x->naked = true;
+			return sendack(x);
+		}
+		return 0;
+	case TFTP_ERROR:
+		acnlogmark(lgWARN, "TFTP error %u: %s", unmarshalU16(rxbuf + 2),
+					(const char *)rxbuf + TFTP_HDRSIZE);
+		errno = (unmarshalU16(rxbuf + 2) == 1) ? ENOENT : EPROTO;
+		return -1;
+	default:
+		return 0;
+	}
+}
+
+/**********************************************************************/
+static bool
+samehost(const struct sockaddr_storage *a, const struct sockaddr_storage *b)
+{
+	if (a->ss_family != b->ss_family) return false;
+	switch (a->ss_family) {
+	case AF_INET:
+		return ((const struct sockaddr_in *)a)->sin_addr.s_addr
+				== ((const struct sockaddr_in *)b)->sin_addr.s_addr;
+	case AF_INET6:
+		return memcmp(&((const struct sockaddr_in6 *)a)->sin6_addr,
+				&((const struct sockaddr_in6 *)b)->sin6_addr,
+				sizeof(struct in6_addr)) == 0;
+	default:
+		return false;
+	}
+}
+
+/**********************************************************************/
+/*
+Socket callback. The server answers from a new port (its transfer
+ID) which is then the only one accepted.
+*/
+static void
+tftp_rx(uint32_t evf, void *evptr)
+{
+	struct tftpx_s *x;
+	struct sockaddr_storage from;
+	socklen_t fromlen;
+	ssize_t len;
+	int rslt;
+
+	x = container_of(evptr, struct tftpx_s, rxfn);
+	while (1) {
+		fromlen = sizeof(from);
+		len = recvfrom(x->sk, rxbuf, TFTP_RXSIZE + 1, 0,
+							(struct sockaddr *)&from, &fromlen);
+		if (len < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				return;
+			rslt = -1;
+			break;
+		}
+		if (!x->started) {
+			if (!samehost(&from, &x->fetch->srv)) continue;
+			memcpy(&x->peer, &from, fromlen);
+			x->peerlen = fromlen;
+			x->started = true;
+		} else if (fromlen != x->peerlen
+					|| memcmp(&from, &x->peer, fromlen) != 0) {
+			continue;
+		}
+		if ((rslt = tftp_pkt(x, len)) != 0) break;
+	}
+	endxfer(x, (rslt < 0) ? errno : 0);
+	service();
+}
+
+/**********************************************************************/
+static void
+tftp_timeout(struct acnTimer_s *timer)
+{
+	struct tftpx_s *x;
+
+	x = container_of(timer, struct tftpx_s, timer);
+	if (++x->retries <= CF_TFTP_RETRIES) {
+		acnlogmark(lgDBUG, "timeout - retry %u", x->retries);
+		x->naked = false;
+		/* before options are settled resend the request */
+		if ((x->optsdone ? sendack(x) : sendpkt(x)) == 0) return;
+	} else {
+		errno = ETIMEDOUT;
+	}
+	endxfer(x, errno);
+	service();
+}
+
+/**********************************************************************/
+/*
+func: ddlfetch
+
+Fetch the DDL for a device from the location given by url, which is
+a value of the EPI-19 device-description attribute. Only TFTP is
+supported. The url may have a `$:` prefix and each `$` in the file
+name part is replaced by a module UUID.
+
+Returns 0 if the root module for dcid is already available locally
+in which case nothing is fetched (modules it refers to are assumed
+to be available too). Returns 1 if fetching has started, in which
+case donefn is called when every module needed has been fetched or
+has failed. If a transfer cannot even be started donefn may be
+called before ddlfetch() returns. Returns -1 on error with errno
+set.
+*/
+int
+ddlfetch(const uint8_t *dcid, const char *url, ddlfetch_fn *donefn, void *ref)
+{
+	struct fetch_s *fetch;
+	struct addrinfo hints;
+	struct addrinfo *ai;
+	char uuidstr[UUID_STR_SIZE];
+	char pathbuf[100];
+	char host[NI_MAXHOST];
+	char port[8];
+	const char *path;
+	const char *cp;
+	const char *ep;
+	size_t len;
+	int fd;
+	int rslt;
+
+	LOG_FSTART();
+	if ((fd = openddl(uuid2str(dcid, uuidstr))) >= 0) {
+		close(fd);
+		return 0;
+	}
+	/* parse [$:]tftp://host[:port]/name */
+	if (url[0] == '$' && url[1] == ':') url += 2;
+	if (strncasecmp(url, "tftp://", 7) != 0) {
+		acnlogmark(lgERR, "Can't fetch from %s", url);
+		errno = EPROTONOSUPPORT;
+		return -1;
+	}
+	cp = url + 7;
+	if (*cp == '[') {
+		if ((ep = strchr(++cp, ']')) == NULL) goto badurl;
+	} else {
+		for (ep = cp; *ep && *ep != ':' && *ep != '/';) ++ep;
+	}
+	if (ep == cp || (size_t)(ep - cp) >= sizeof(host)) goto badurl;
+	memcpy(host, cp, ep - cp);
+	host[ep - cp] = 0;
+	if (*ep == ']') ++ep;
+	strcpy(port, TFTP_PORT);
+	if (*ep == ':') {
+		for (cp = ++ep; *ep >= '0' && *ep <= '9';) ++ep;
+		if (ep == cp || ep - cp >= (int)sizeof(port)) goto badurl;
+		memcpy(port, cp, ep - cp);
+		port[ep - cp] = 0;
+	}
+	if (*ep++ != '/' || *ep == 0) goto badurl;
+	/* check expanded name fits the request */
+	for (len = 0, cp = ep; *cp; ++cp) len += (*cp == '$') ? UUID_STR_SIZE : 1;
+	if (len > TFTP_MAXRQ - 64) goto badurl;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	if ((rslt = getaddrinfo(host, port, &hints, &ai)) != 0) {
+		acnlogmark(lgERR, "Can't resolve %s: %s", host, gai_strerror(rslt));
+		errno = EHOSTUNREACH;
+		return -1;
+	}
+
+	/* modules go in the first directory of the path */
+	if ((path = getddlpath(pathbuf, sizeof(pathbuf))) == NULL) {
+		freeaddrinfo(ai);
+		errno = ENOENT;
+		return -1;
+	}
+	fetch = mallocxz(sizeof(struct fetch_s) + strlen(ep) + 1);
+	strcpy(fetch->fname, ep);
+	for (len = 0; path[len] && path[len] != PATHSEP; ++len) {}
+	if (len == 0) {
+		path = ".";
+		len = 1;
+	}
+	fetch->dir = mallocx(len + 1);
+	memcpy(fetch->dir, path, len);
+	fetch->dir[len] = 0;
+	if (mkdir(fetch->dir, 0755) < 0 && errno != EEXIST) {
+		acnlogerror(lgERR);
+	}
+	memcpy(&fetch->srv, ai->ai_addr, ai->ai_addrlen);
+	fetch->srvlen = ai->ai_addrlen;
+	freeaddrinfo(ai);
+	uuidcpy(fetch->dcid, dcid);
+	fetch->donefn = donefn;
+	fetch->ref = ref;
+	fetch->nxt = fetches;
+	fetches = fetch;
+	acnlogmark(lgINFO, "Fetching %s from %s", uuidstr, url);
+
+	wantmodule(fetch, dcid);
+#if CF_DDL_BEHAVIORS
+	{
+		/* the parser always loads the behaviorsets it knows */
+		const struct bv_s *kbv;
+		uint8_t uuid[UUID_SIZE];
+
+		for (kbv = known_bvs; kbv->name; ++kbv) {
+			if (kbv->action == NULL && str2uuid(kbv->name, uuid) == 0)
+				wantmodule(fetch, uuid);
+		}
+	}
+#endif
+	service();
+	LOG_FEND();
+	return 1;
+
+badurl:
+	acnlogmark(lgERR, "Bad DDL URL %s", url);
+	errno = EINVAL;
+	return -1;
+}
+
+#endif  /* CF_DDL_FETCH */
@@ -109,6 +109,9 @@ lgOFF lgEMRG lgALRT lgCRIT lgERR lgWARN lgNTCE lgINFO lgDBUG
 #include "expat.h"
 #include "acn.h"
 #include "tohex.h"
+#if CF_DDL_THREADS
+#include <pthread.h>
+#endif
 /**********************************************************************/
 /* bufer size for expat parser */
 #define BUFF_SIZE 2048
@@ -390,6 +393,15 @@ tokmatchofs() returns the offset of the name in the allowed array.
 So if the name *is* in the allowed array then tokmatchtok(name, 
 allowed) == allowed->toks[tokmatchofs(name, allowed)].
 
+hashing:
+
+Before the first parse a perfect hash of all token strings is built 
+(see <tokhash_init()>). A name is then identified by hashing it and 
+making a single string comparison against the token in its slot, 
+after which only the (small) allowed array needs scanning for that 
+token value. If the hash cannot be built the binary search below is 
+used instead.
+
 sorting:
 
 The token search routines use a binary search which means the keys 
@@ -1289,18 +1301,59 @@ struct uuidset_s behaviorsets;
 #endif
 struct uuidset_s devtrees;
 
+/* shared trees in most recently used order */
+static struct rootdev_s *treelru = NULL;
+static size_t treemem = 0;
+
 struct pool_s permpool;
 /**********************************************************************/
 /*
 Rather than parsing multiple modules recursively which can overload 
 lightweight systems they are queued up (in the ddl parse context 
 structure) to be parsed sequentially.
+
+If <CF_DDL_THREADS> is set, worker threads take modules from the 
+queue as soon as they are added, read them and run them through 
+their own expat parser, recording the element and text callbacks in 
+evbuf_s. The main thread then replays each recording through the 
+normal handlers in queue order so the tree and maps are built in 
+exactly the same sequence as a sequential parse. See <parsemodules>.
 */
+#if CF_DDL_THREADS
+struct evbuf_s {
+	uint8_t *buf;
+	size_t len;
+	size_t alloc;
+};
+
+/* record tags in evbuf_s */
+#define REC_START 'S'
+#define REC_END 'E'
+#define REC_TEXT 'T'
+
+struct ddlworkers_s {
+	pthread_mutex_t lock;
+	pthread_cond_t ready;  /* module queued or stopping */
+	pthread_cond_t done;   /* a module has been recorded */
+	struct qentry_s *nxtjob;
+	XML_Parser parser;     /* main thread's parser */
+	bool stop;
+	int nthreads;
+	pthread_t threads[CF_DDL_THREADS];
+};
+#endif
 
 struct qentry_s {
 	struct qentry_s *next;
 	tok_t modtype;
 	void *ref;
+#if CF_DDL_THREADS
+	int fd;
+	int err;
+	bool done;
+	bool bad;
+	struct evbuf_s ev;
+#endif
 	ddlchar_t name[];
 };
 /**********************************************************************/
@@ -1329,58 +1382,253 @@ parenttok(struct dcxt_s *dcxp)
 }
 /**********************************************************************/
 /*
-func: tokmatchtok
+Perfect hash of token strings.
+
+Token strings are hashed once and the hash split between a bucket 
+index and a slot index. Each bucket has its own seed which was 
+chosen when the table was built so that no two tokens land in the 
+same slot. Lookup is therefore one hash, one table probe and one 
+string compare.
+
+Alongside the hash, each element has a bitmask of the child elements 
+and one of the attributes it allows, built from <content> and 
+<elematts>, so <el_start()> checks whether a name is allowed in its 
+context with a single bit test.
 */
-static tok_t
-tokmatchtok(const ddlchar_t *str, const struct allowtok_s *allowed)
+#define TOKHASH_BITS 8
+#define TOKHASH_SIZE (1 << TOKHASH_BITS)
+#define TOKHASH_NBKT 64
+#define TOKHASH_MAXSEED 0x10000
+#define TOKMASKWORDS ((TK__max_ + 31) / 32)
+#define TK_docroot_ TK__elmax_  /* elmask row for the document root */
+
+static struct tokhash_s {
+	bool ready;
+	bool failed;
+	uint16_t seed[TOKHASH_NBKT];
+	tok_t slot[TOKHASH_SIZE];
+	uint32_t elmask[TK__elmax_ + 1][TOKMASKWORDS];
+	uint32_t attmask[TK__elmax_][TOKMASKWORDS];
+} tokhash;
+
+#define tokmasktst(mask, tk) (((mask)[(tk) / 32] >> ((tk) % 32)) & 1)
+
+static inline uint32_t
+tokhash_str(const ddlchar_t *str)
 {
-	int ofs, span;
-	const tok_t *tp;
-	int cmp;
+	uint32_t h = 2166136261u;   /* FNV-1a */
 
-	if (allowed != NULL && (span = allowed->ntoks) > 0) {
-		tp = allowed->toks;
-		while (span) {
-			tp += ofs = span / 2;
-			if ((cmp = strcmp(str, tokstrs[*tp])) == 0) return *tp;
-			if (cmp < 0) {
-				tp -= ofs;
-				span = ofs;
-			} else {
-				++tp;
-				span -= ofs + 1;
+	while (*str) h = (h ^ (uint8_t)*str++) * 16777619u;
+	return h;
+}
+
+static inline unsigned int
+tokhash_slot(uint32_t h, uint32_t seed)
+{
+	h ^= seed * 0x9e3779b1u;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	return h >> (32 - TOKHASH_BITS);
+}
+
+/**********************************************************************/
+static void
+tokmaskset(uint32_t *mask, const struct allowtok_s *allowed)
+{
+	int i;
+
+	if (allowed == NULL) return;
+	for (i = 0; i < allowed->ntoks; ++i)
+		mask[allowed->toks[i] / 32] |= (uint32_t)1 << (allowed->toks[i] % 32);
+}
+
+/**********************************************************************/
+/*
+func: tokhash_init
+
+Build the token hash table. Buckets are placed largest first, trying 
+successive seeds until all tokens in the bucket hit empty slots. On 
+failure tokhash.failed is set and matching falls back to binary 
+search.
+*/
+static void
+tokhash_init(void)
+{
+	uint32_t hv[TK__max_];
+	uint8_t bcount[TOKHASH_NBKT];
+	tok_t tk;
+	int b, n, nmax;
+	uint32_t seed;
+
+	LOG_FSTART();
+	memset(tokhash.slot, TK__none_, sizeof(tokhash.slot));
+	memset(bcount, 0, sizeof(bcount));
+	nmax = 0;
+	for (tk = 0; tk < TK__max_; ++tk) {
+		if (tokstrs[tk] == NULL) continue;
+		hv[tk] = tokhash_str(tokstrs[tk]);
+		n = ++bcount[hv[tk] % TOKHASH_NBKT];
+		if (n > nmax) nmax = n;
+	}
+
+	for (n = nmax; n > 0; --n) {
+		for (b = 0; b < TOKHASH_NBKT; ++b) {
+			if (bcount[b] != n) continue;
+			for (seed = 0; seed < TOKHASH_MAXSEED; ++seed) {
+				tok_t placed = 0;
+				unsigned int sl;
+
+				for (tk = 0; tk < TK__max_; ++tk) {
+					if (tokstrs[tk] == NULL || hv[tk] % TOKHASH_NBKT != (uint32_t)b)
+						continue;
+					sl = tokhash_slot(hv[tk], seed);
+					if (tokhash.slot[sl] != TK__none_) break;
+					tokhash.slot[sl] = tk;
+					++placed;
+				}
+				if (placed == n) break;
+				/* clash - undo any slots used and try next seed */
+				for (tk = 0; placed > 0; ++tk) {
+					if (tokstrs[tk] == NULL || hv[tk] % TOKHASH_NBKT != (uint32_t)b)
+						continue;
+					tokhash.slot[tokhash_slot(hv[tk], seed)] = TK__none_;
+					--placed;
+				}
+			}
+			if (seed >= TOKHASH_MAXSEED) {
+				acnlogmark(lgWARN, "Can't build token hash - using search");
+				tokhash.failed = true;
+				LOG_FEND();
+				return;
 			}
+			tokhash.seed[b] = seed;
 		}
 	}
+	for (tk = 0; tk < TK__elmax_; ++tk) {
+		tokmaskset(tokhash.elmask[tk], content[tk]);
+		tokmaskset(tokhash.attmask[tk], elematts[tk]);
+	}
+	tokmaskset(tokhash.elmask[TK_docroot_], &content_DOCROOT);
+	tokhash.ready = true;
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+Identify a token string using the hash table.
+*/
+static inline tok_t
+tokfind(const ddlchar_t *str)
+{
+	uint32_t h = tokhash_str(str);
+	tok_t tk;
+
+	tk = tokhash.slot[tokhash_slot(h, tokhash.seed[h % TOKHASH_NBKT])];
+	if (tk != TK__none_ && strcmp(str, tokstrs[tk]) == 0) return tk;
 	return TK__none_;
 }
+
 /**********************************************************************/
 /*
-func: tokmatchofs
+Binary search fallback for tokmatchofs() if no hash is available.
 */
 static int
-tokmatchofs(const ddlchar_t *str, const struct allowtok_s *allowed)
+tokbsearch(const ddlchar_t *str, const struct allowtok_s *allowed)
 {
 	int ofs, span;
 	const tok_t *tp;
 	int cmp;
 
-	if (allowed != NULL && (span = allowed->ntoks) > 0) {
-		tp = allowed->toks;
-		while (span) {
-			tp += ofs = span / 2;
-			if ((cmp = strcmp(str, tokstrs[*tp])) == 0) return tp - allowed->toks;
-			if (cmp < 0) {
-				tp -= ofs;
-				span = ofs;
-			} else {
-				++tp;
-				span -= ofs + 1;
-			}
+	tp = allowed->toks;
+	span = allowed->ntoks;
+	while (span) {
+		tp += ofs = span / 2;
+		if ((cmp = strcmp(str, tokstrs[*tp])) == 0) return tp - allowed->toks;
+		if (cmp < 0) {
+			tp -= ofs;
+			span = ofs;
+		} else {
+			++tp;
+			span -= ofs + 1;
 		}
 	}
 	return -1;
 }
+
+/**********************************************************************/
+/*
+func: tokmatchofs
+*/
+static int
+tokmatchofs(const ddlchar_t *str, const struct allowtok_s *allowed)
+{
+	tok_t tk;
+	int i;
+
+	if (allowed == NULL || allowed->ntoks == 0) return -1;
+	if (!tokhash.ready) return tokbsearch(str, allowed);
+
+	if ((tk = tokfind(str)) == TK__none_) return -1;
+	for (i = 0; i < allowed->ntoks; ++i)
+		if (allowed->toks[i] == tk) return i;
+	return -1;
+}
+/**********************************************************************/
+/*
+func: tokmatchtok
+*/
+static tok_t
+tokmatchtok(const ddlchar_t *str, const struct allowtok_s *allowed)
+{
+	int ofs;
+
+	if ((ofs = tokmatchofs(str, allowed)) < 0) return TK__none_;
+	return allowed->toks[ofs];
+}
+
+/**********************************************************************/
+/*
+func: elmatch
+
+Identify an element name and check it is allowed within parent 
+(TK_docroot_ at the top level).
+*/
+static tok_t
+elmatch(const ddlchar_t *el, tok_t parent)
+{
+	tok_t tk;
+
+	if (!tokhash.ready) {
+		return tokmatchtok(el, 
+				(parent == TK_docroot_) ? &content_DOCROOT : content[parent]);
+	}
+	if ((tk = tokfind(el)) == TK__none_ || !tokmasktst(tokhash.elmask[parent], tk))
+		return TK__none_;
+	return tk;
+}
+
+/**********************************************************************/
+/*
+func: attmatch
+
+Identify an attribute name and return its offset in the allowed 
+attributes of element eltok, or -1. Names which are not allowed are 
+rejected by the mask without searching.
+*/
+static int
+attmatch(const ddlchar_t *att, tok_t eltok)
+{
+	const struct allowtok_s *allowed = elematts[eltok];
+	tok_t tk;
+	int i;
+
+	if (!tokhash.ready) return tokmatchofs(att, allowed);
+	if ((tk = tokfind(att)) == TK__none_ || !tokmasktst(tokhash.attmask[eltok], tk))
+		return -1;
+	for (i = 0; allowed->toks[i] != tk; ++i) {}
+	return i;
+}
 /**********************************************************************/
 /*
 Misc text utilities
@@ -1406,7 +1654,7 @@ objlen(const ddlchar_t *str)
 }
 /**********************************************************************/
 static int
-savestrasobj(const ddlchar_t *str, uint8_t **objp)
+savestrasobj(struct arena_s *arena, const ddlchar_t *str, uint8_t **objp)
 {
 	uint8_t *cp;
 	int len;
@@ -1414,7 +1662,7 @@ savestrasobj(const ddlchar_t *str, uint8_t **objp)
 	int nibble;
 
 	if ((len = objlen(str)) < 0) return len;
-	if ((cp = acnalloc(len)) == NULL) return -1;
+	if ((cp = arena_alloc(arena, len)) == NULL) return -1;
 
 	*objp = cp;
 	byte = 1;  /* bit 0 is shift marker */
@@ -1640,13 +1888,15 @@ languageset utilities
 */
 /**********************************************************************/
 #if CF_DDL_STRINGS
+/* language preference from setlang() */
+static const ddlchar_t **userlangs = NULL;
+
 /*
-func: setlang
+Select the first of the user's preferred languages which set provides.
 */
-void
-setlang(const ddlchar_t **ltags)
+static void
+pickuserlang(struct lset_s *set)
 {
-	struct lset_s *set;
 	struct language_s *lng;
 	const ddlchar_t **lp;
 	int l;
@@ -1654,29 +1904,85 @@ setlang(const ddlchar_t **ltags)
 	char dcidstr[UUID_STR_SIZE];
 #endif	
 
-	FOR_EACH_UUID(&languagesets, set, struct lset_s, uuid[0]) {
-		assert(set->nlangs);
-		set->userlang = 0;  /* default */
-		lng = set->languages;
-		for (lp = ltags; *lp; ++lp) {
-			for (l = 0; l < set->nlangs; ++l) {
-				if (strcmp(*lp, lng[l].tag) == 0) {
-					set->userlang = l;
-					goto nextset;
-				}
+	set->userlang = 0;  /* default */
+	if (userlangs == NULL) return;
+	lng = set->languages;
+	for (lp = userlangs; *lp; ++lp) {
+		for (l = 0; l < set->nlangs; ++l) {
+			if (strcmp(*lp, lng[l].tag) == 0) {
+				set->userlang = l;
+				return;
 			}
 		}
+	}
 #if acntestlog(lgINFO)
-		acnlogmark(lgINFO, "Languageset %s does not provide requested language(s)", 
-			uuid2str(set->uuid, dcidstr));
+	acnlogmark(lgINFO, "Languageset %s does not provide requested language(s)", 
+		uuid2str(set->uuid, dcidstr));
 #endif	
-nextset: ;
+}
+
+/*
+func: setlang
+
+Set the preferred languages for labels as a NULL terminated list of 
+language tags in order of preference. The list is kept and must 
+remain valid.
+*/
+void
+setlang(const ddlchar_t **ltags)
+{
+	struct lset_s *set;
+
+	userlangs = ltags;
+	FOR_EACH_UUID(&languagesets, set, struct lset_s, uuid[0]) {
+#if CF_DDL_LAZYSTRINGS
+		if (set->languages == NULL) continue;  /* not parsed yet */
+#endif
+		assert(set->nlangs);
+		pickuserlang(set);
 	} NEXT_UUID();
 }
+
+#if CF_DDL_LAZYSTRINGS
+static void parsemodules(struct dcxt_s *dcxp);
+
+/*
+Parse a languageset on its first use.
+*/
+static void
+loadlset(struct lset_s *set)
+{
+	struct dcxt_s dcxt;
+	char setname[UUID_STR_SIZE];
+
+	LOG_FSTART();
+	if (!tokhash.ready && !tokhash.failed) tokhash_init();
+	memset(&dcxt, 0, sizeof(dcxt));
+	dcxt.skip = NOSKIP;
+	dcxt.elprev = TK__none_;
+	dcxt.nestlvl = -1;
+
+	queue_module(&dcxt, TK_languageset, uuid2str(set->uuid, setname), set);
+	parsemodules(&dcxt);
+#if CF_DDL_CACHE
+	ddlcache_freesrcs(dcxt.srcs);
+#endif
+	if (set->languages == NULL) {
+		acnlogmark(lgERR, "Languageset %s not loaded", setname);
+		set->nlangs = LSET_FAILED;
+	} else {
+		pickuserlang(set);
+	}
+	LOG_FEND();
+}
+#endif  /* CF_DDL_LAZYSTRINGS */
 /**********************************************************************/
 
 /*
-func: findlabel
+func: lblookup
+
+Return the text of a label in the current language. With 
+<CF_DDL_LAZYSTRINGS> this may parse the label's languageset.
 */
 const ddlchar_t *
 lblookup(struct label_s *lbl)
@@ -1685,6 +1991,13 @@ lblookup(struct label_s *lbl)
 	struct lset_s *set;
 
 	if ((set = lbl->set) == NULL) return lbl->txt;
+#if CF_DDL_LAZYSTRINGS
+	if (set->languages == NULL) {
+		if (set->nlangs == LSET_FAILED) return NULL;
+		loadlset(set);
+		if (set->languages == NULL) return NULL;
+	}
+#endif
 	str = (struct string_s *)findkey(&set->hasht, lbl->txt);
 	if (str == NULL) return NULL;
 	if (set->userlang < 0 || set->userlang >= set->nlangs)
@@ -2077,6 +2390,13 @@ start accumulating element content
 
 Before calling this, element text is ignored.
 */
+#if CF_DDL_THREADS
+#define textcapture(dcxp, on) ((dcxp)->wanttext = (on))
+#else
+#define textcapture(dcxp, on) \
+		XML_SetCharacterDataHandler((dcxp)->parser, (on) ? &elem_text : NULL)
+#endif
+
 static void
 startText(struct dcxt_s *dcxp, const ddlchar_t *paramname)
 {
@@ -2085,7 +2405,7 @@ startText(struct dcxt_s *dcxp, const ddlchar_t *paramname)
 	} else {
 		dcxp->txtlen = 0;
 		dcxp->txt.ch[0] = 0;
-		XML_SetCharacterDataHandler(dcxp->parser, &elem_text);
+		textcapture(dcxp, true);
 	}
 }
 /**********************************************************************/
@@ -2100,7 +2420,7 @@ endText(struct dcxt_s *dcxp)
 {
 	if (dcxp->txtlen == -1) return dcxp->txt.p;
 
-	XML_SetCharacterDataHandler(dcxp->parser, NULL);
+	textcapture(dcxp, false);
 	dcxp->txt.ch[dcxp->txtlen] = 0;  /* terminate */
 	return dcxp->txt.ch;
 }
@@ -2183,7 +2503,9 @@ label_start(struct dcxt_s *dcxp, const ddlchar_t **atta)
 			}
 			if (create == 0) {
 				set->hasht.pool = &permpool;
+#if !CF_DDL_LAZYSTRINGS
 				queue_module(dcxp, TK_languageset, setname, set);
+#endif
 			}
 			pp->label.set = set;
 			pp->label.txt = pool_addstr(&dcxp->rootdev->strpool, keyp);
@@ -2713,7 +3035,7 @@ dev_start(struct dcxt_s *dcxp, const ddlchar_t **atta)
 		dev->minaddr = 0xffffffff;
 
 		/* create a device ddlprop_s */
-		dev->ddlroot = pp = acnNew(struct ddlprop_s);
+		dev->ddlroot = pp = arenaNew(&dev->arena, struct ddlprop_s);
 		pp->vtype = VT_device;
 		dcxp->arraytotal = pp->array = 1;
 		/* and an address map */
@@ -2801,7 +3123,7 @@ pprop_start(struct dcxt_s *dcxp, const ddlchar_t **atta)
 		break;
 	}
 	/* allocate a new property */
-	pp = acnNew(struct ddlprop_s);
+	pp = arenaNew(&dcxp->rootdev->arena, struct ddlprop_s);
 	parent = dcxp->m.dev.curprop;
 	pp->parent = parent;	/* link to our parent */
 	pp->childaddr = parent->childaddr; /* default - content may override */
@@ -2820,7 +3142,7 @@ pprop_start(struct dcxt_s *dcxp, const ddlchar_t **atta)
 			|| (pp->vtype = tokmatchofs(atta[5], &proptype_allow)) == -1)
 		{
 			acnlogmark(lgERR, "%4d bad or missing valuetype", dcxp->elcount);
-			acnfree(pp);
+			/* pp is left unlinked in the arena */
 			SKIPON(dcxp);
 			return;
 		}
@@ -2830,7 +3152,7 @@ pprop_start(struct dcxt_s *dcxp, const ddlchar_t **atta)
 		const ddlchar_t *dcidstr;
 
 		if ((dcidstr = resolveuuid(dcxp, atta[0], NULL)) == NULL) {
-			acnfree(pp);
+			/* pp is left unlinked in the arena */
 			SKIPON(dcxp);
 			return;
 		}
@@ -3083,7 +3405,8 @@ skipvalue:
 		}
 		if (pp->v.imm.count == 1) {
 			/* need to assign an array for values */
-			arrayp = mallocx(vsizes[i] * dcxp->arraytotal);
+			arrayp = arena_allocx(&dcxp->rootdev->arena,
+									vsizes[i] * dcxp->arraytotal);
 			switch (i) {
 			case VT_imm_uint - VT_imm_FIRST:   /* uint */
 				*(uint32_t *)arrayp = pp->v.imm.t.ui;
@@ -3135,7 +3458,7 @@ value_end(struct dcxt_s *dcxp)
 		if (count == 0) objp = &pp->v.imm.t.obj;
 		else objp = pp->v.imm.t.Aobj + count;
 
-		objp->size = savestrasobj(vtext, &objp->data);	
+		objp->size = savestrasobj(&dcxp->rootdev->arena, vtext, &objp->data);	
 	}	break;
 	case VT_imm_string: {
 		const ddlchar_t *s;
@@ -3348,6 +3671,7 @@ mapprop(struct dcxt_s *dcxp, struct ddlprop_s *prop)
 		af->adhi = ulim;
 		af->ntests = !ispacked;
 		af->p.prop = np;
+		af->hits = NULL;
 	} else /* overlap */ if (ispacked) {
 		/*
 		We must split this region and insert ours between.
@@ -3363,6 +3687,7 @@ mapprop(struct dcxt_s *dcxp, struct ddlprop_s *prop)
 		af->adhi = ulim;
 		af->ntests = 0;
 		af->p.prop = np;
+		af->hits = NULL;
 		++af;
 		af->adlo = ulim + 1;
 	} else {
@@ -3405,6 +3730,7 @@ mapprop(struct dcxt_s *dcxp, struct ddlprop_s *prop)
 
 				af->adlo = (base < oaf->adlo) ? base : oaf->adlo;
 				af->adhi = (ulim > oaf->adhi) ? ulim : oaf->adhi;
+				af->hits = NULL;
 				/* link in our extra property */
 				af->ntests = oaf->ntests + 1;
 				pa = af->p.pa;
@@ -3434,6 +3760,7 @@ mapprop(struct dcxt_s *dcxp, struct ddlprop_s *prop)
 					af->adhi = (j == amap->srch.count) ? ulim : oaf->adlo - 1;
 					af->ntests = 1;
 					af->p.prop = np;
+					af->hits = NULL;
 					base = af->adhi + 1;
 				}
 			}
@@ -3471,7 +3798,7 @@ propref_start(struct dcxt_s *dcxp, const ddlchar_t **atta)
 	/* need to count dimensions before we can allocate */
 	dims = (pp->array > 1);  /* add 1 if this prop is an array */
 	for (xpp = pp->arrayprop; xpp != NULL; xpp = xpp->arrayprop) ++dims;
-	np = mallocxz(dmppropsize(dims));
+	np = arena_allocxz(&dcxp->rootdev->arena, dmppropsize(dims));
 	np->ndims = dims;
 	pp->v.net.dmp = np;
 	np->prop = pp;
@@ -3589,7 +3916,7 @@ setparam_start(struct dcxt_s *dcxp, const ddlchar_t **atta)
 	const ddlchar_t *contentparam = atta[2];
 
 	LOG_FSTART();
-	parp = acnNew(struct param_s);
+	parp = arenaNew(&dcxp->rootdev->arena, struct param_s);
 	parp->name = pool_addstr(&dcxp->parsepool, name);
 	parp->nxt = dcxp->m.dev.curprop->v.dev.params;
 	dcxp->m.dev.curprop->v.dev.params = parp;
@@ -3686,12 +4013,9 @@ el_start(void *data, const ddlchar_t *el, const ddlchar_t **atts)
 	}
 
 	//acnlogmark(lgDBUG, "<%s %d>", el, dcxp->nestlvl);
-	if (dcxp->nestlvl == 0) {
-		allow = &content_DOCROOT;
-	} else {
-		allow = content[dcxp->elestack[dcxp->nestlvl - 1]];
-	}
-	if (allow == NULL || !ISELTOKEN(eltok = tokmatchtok(el, allow))) {
+	eltok = elmatch(el, (dcxp->nestlvl == 0) ? TK_docroot_
+									: dcxp->elestack[dcxp->nestlvl - 1]);
+	if (!ISELTOKEN(eltok)) {
 		acnlogmark(lgWARN, "%4d Unexpected element \"%s\". skipping...", dcxp->elcount, el);
 		SKIPON(dcxp);
 	} else {
@@ -3700,7 +4024,7 @@ el_start(void *data, const ddlchar_t *el, const ddlchar_t **atts)
 		assert(allow);
 		memset(atta, 0, sizeof(atta));
 		for (; *atts != NULL; atts += 2) {
-			atti = tokmatchofs(atts[0], allow);
+			atti = attmatch(atts[0], eltok);
 			if (atti < 0) {
 				acnlogmark(lgWARN, "%4d unknown attribute %s=\"%s\"",
 								dcxp->elcount, atts[0], atts[1]);
@@ -3780,10 +4104,23 @@ queue_module(struct dcxt_s *dcxp, tok_t modtype, const ddlchar_t *name, void *re
 	qentry->modtype = modtype;
 	qentry->ref = ref;
 	strcpy(qentry->name, name);
+#if CF_DDL_THREADS
+	qentry->fd = -1;
+	qentry->done = qentry->bad = false;
+	memset(&qentry->ev, 0, sizeof(qentry->ev));
+	if (dcxp->workers) pthread_mutex_lock(&dcxp->workers->lock);
+#endif
 
 	if (dcxp->queuehead == NULL) dcxp->queuehead = qentry;
 	else dcxp->queuetail->next = qentry;
 	dcxp->queuetail = qentry;
+#if CF_DDL_THREADS
+	if (dcxp->workers) {
+		if (dcxp->workers->nxtjob == NULL) dcxp->workers->nxtjob = qentry;
+		pthread_cond_signal(&dcxp->workers->ready);
+		pthread_mutex_unlock(&dcxp->workers->lock);
+	}
+#endif
 	acnlogmark(lgDBUG, "module %s queued", name);
 	LOG_FEND();
 }
@@ -3820,25 +4157,344 @@ check_queued_modulex(struct dcxt_s *dcxp, tok_t typefound, const ddlchar_t *uuid
 	acnlogmark(lgINFO, "Starting %s %s", tokstrs[typefound], uuidstr);
 	LOG_FEND();
 }
+/**********************************************************************/
+/*
+Feed an open module file through an XML parser. Returns 0 on success
+or -1 on a read or parse error.
+
+If the file can be mapped it is passed to the parser in one piece,
+otherwise it is read through the parser's own buffers.
+*/
+static int
+parsefile(XML_Parser parser, int fd, const ddlchar_t *name)
+{
+	int sz;
+	void *buf;
+#if CF_DDL_MMAP
+	const void *map;
+	size_t mapsize;
+
+	if ((map = mapddl(fd, &mapsize)) != NULL) {
+		int rslt = 0;
+
+		if (! XML_Parse(parser, map, (int)mapsize, 1)) {
+			acnlogmark(lgERR, "Parse error in %s line %lu: %s", name,
+					(unsigned long)XML_GetCurrentLineNumber(parser),
+					XML_ErrorString(XML_GetErrorCode(parser)));
+			rslt = -1;
+		}
+		unmapddl(map, mapsize);
+		return rslt;
+	}
+#endif
+
+	do {
+		if ((buf = XML_GetBuffer(parser, BUFF_SIZE)) == NULL) {
+			acnlogmark(lgERR, "Can't allocate buffer %s", strerror(errno));
+			return -1;
+		}
+		if ((sz = read(fd, buf, BUFF_SIZE)) < 0) {
+			acnlogerror(lgERR);
+			return -1;
+		}
+		if (! XML_ParseBuffer(parser, sz, sz == 0)) {
+			acnlogmark(lgERR, "Parse error in %s line %lu: %s", name,
+					(unsigned long)XML_GetCurrentLineNumber(parser),
+					XML_ErrorString(XML_GetErrorCode(parser)));
+			return -1;
+		}
+	} while (sz > 0);
+	return 0;
+}
+
+/**********************************************************************/
+#if CF_DDL_THREADS
+/*
+Module pre-parsing. These run in worker threads and must not touch 
+the parse context.
+*/
+static void
+evput(struct qentry_s *qentry, const void *data, size_t len)
+{
+	struct evbuf_s *ev = &qentry->ev;
+
+	if (ev->len + len > ev->alloc) {
+		size_t nalloc;
+		uint8_t *nbuf;
+
+		for (nalloc = ev->alloc ? ev->alloc : 4096; nalloc < ev->len + len;)
+			nalloc *= 2;
+		if ((nbuf = realloc(ev->buf, nalloc)) == NULL) {
+			qentry->bad = true;
+			return;
+		}
+		ev->buf = nbuf;
+		ev->alloc = nalloc;
+	}
+	memcpy(ev->buf + ev->len, data, len);
+	ev->len += len;
+}
+
+#define evputc(qentry, c) {uint8_t _c = (c); evput((qentry), &_c, 1);}
+#define evputs(qentry, s) evput((qentry), (s), (strlen(s) + 1) * sizeof(ddlchar_t))
+
+/**********************************************************************/
+static void
+rec_start(void *data, const ddlchar_t *el, const ddlchar_t **atts)
+{
+	struct qentry_s *qentry = (struct qentry_s *)data;
+
+	evputc(qentry, REC_START);
+	evputs(qentry, el);
+	for (; *atts != NULL; atts += 2) {
+		evputs(qentry, atts[0]);
+		evputs(qentry, atts[1]);
+	}
+	evputs(qentry, "");  /* attribute names are never empty */
+}
+
+/**********************************************************************/
+static void
+rec_end(void *data, const ddlchar_t *el)
+{
+	struct qentry_s *qentry = (struct qentry_s *)data;
+
+	evputc(qentry, REC_END);
+	evputs(qentry, el);
+}
+
 /**********************************************************************/
 static void
+rec_text(void *data, const ddlchar_t *txt, int len)
+{
+	struct qentry_s *qentry = (struct qentry_s *)data;
+
+	evputc(qentry, REC_TEXT);
+	evput(qentry, &len, sizeof(len));
+	evput(qentry, txt, len * sizeof(ddlchar_t));
+}
+
+/**********************************************************************/
+/*
+Open a module and record its XML callbacks. parserp points to the 
+caller's parser which is created on first use.
+*/
+static void
+preparse(struct qentry_s *qentry, XML_Parser *parserp)
+{
+	if ((qentry->fd = openddl(qentry->name)) < 0) {
+		qentry->err = errno;
+		return;
+	}
+	if (*parserp == NULL) {
+		*parserp = XML_ParserCreateNS(NULL, ' ');
+	} else if (XML_ParserReset(*parserp, NULL) == XML_FALSE) {
+		XML_ParserFree(*parserp);
+		*parserp = XML_ParserCreateNS(NULL, ' ');
+	}
+	if (*parserp == NULL) {
+		qentry->bad = true;
+		return;
+	}
+	XML_SetElementHandler(*parserp, &rec_start, &rec_end);
+	XML_SetCharacterDataHandler(*parserp, &rec_text);
+	XML_SetUserData(*parserp, qentry);
+	if (parsefile(*parserp, qentry->fd, qentry->name) < 0) qentry->bad = true;
+}
+
+/**********************************************************************/
+static void *
+preparser(void *arg)
+{
+	struct ddlworkers_s *wk = (struct ddlworkers_s *)arg;
+	XML_Parser parser = NULL;
+	struct qentry_s *qentry;
+
+	pthread_mutex_lock(&wk->lock);
+	while (1) {
+		while (!wk->stop && wk->nxtjob == NULL)
+			pthread_cond_wait(&wk->ready, &wk->lock);
+		if (wk->stop) break;
+		qentry = wk->nxtjob;
+		wk->nxtjob = qentry->next;
+		pthread_mutex_unlock(&wk->lock);
+
+		preparse(qentry, &parser);
+
+		pthread_mutex_lock(&wk->lock);
+		qentry->done = true;
+		pthread_cond_broadcast(&wk->done);
+	}
+	pthread_mutex_unlock(&wk->lock);
+	if (parser) XML_ParserFree(parser);
+	return NULL;
+}
+
+/**********************************************************************/
+static void
+startworkers(struct dcxt_s *dcxp, struct ddlworkers_s *wk)
+{
+	int i;
+
+	memset(wk, 0, sizeof(*wk));
+	pthread_mutex_init(&wk->lock, NULL);
+	pthread_cond_init(&wk->ready, NULL);
+	pthread_cond_init(&wk->done, NULL);
+	wk->nxtjob = dcxp->queuehead;
+	for (i = 0; i < CF_DDL_THREADS; ++i) {
+		/* if we get no threads the main thread does all the work */
+		if (pthread_create(&wk->threads[wk->nthreads], NULL, &preparser, wk) == 0)
+			++wk->nthreads;
+	}
+	acnlogmark(lgDBUG, "Started %d DDL workers", wk->nthreads);
+	dcxp->workers = wk;
+}
+
+/**********************************************************************/
+static void
+stopworkers(struct dcxt_s *dcxp, struct ddlworkers_s *wk)
+{
+	int i;
+
+	pthread_mutex_lock(&wk->lock);
+	wk->stop = true;
+	pthread_cond_broadcast(&wk->ready);
+	pthread_mutex_unlock(&wk->lock);
+	for (i = 0; i < wk->nthreads; ++i) pthread_join(wk->threads[i], NULL);
+	if (wk->parser) XML_ParserFree(wk->parser);
+	pthread_cond_destroy(&wk->done);
+	pthread_cond_destroy(&wk->ready);
+	pthread_mutex_destroy(&wk->lock);
+	dcxp->workers = NULL;
+}
+
+/**********************************************************************/
+/*
+Wait for a module to be recorded. If no worker has taken it yet the 
+main thread records it itself rather than waiting.
+*/
+static void
+waitmodule(struct ddlworkers_s *wk, struct qentry_s *qentry)
+{
+	pthread_mutex_lock(&wk->lock);
+	if (wk->nxtjob == qentry) {
+		wk->nxtjob = qentry->next;
+		pthread_mutex_unlock(&wk->lock);
+		preparse(qentry, &wk->parser);
+		pthread_mutex_lock(&wk->lock);
+		qentry->done = true;
+	}
+	while (!qentry->done) pthread_cond_wait(&wk->done, &wk->lock);
+	pthread_mutex_unlock(&wk->lock);
+}
+
+/**********************************************************************/
+/*
+Replay a recorded module through the parse handlers.
+*/
+static void
+replay(struct dcxt_s *dcxp, struct qentry_s *qentry)
+{
+	const uint8_t *ep;
+	const uint8_t *endp;
+	const ddlchar_t *el;
+	const ddlchar_t *cp;
+	int natts;
+	int len;
+
+	ep = qentry->ev.buf;
+	endp = ep + qentry->ev.len;
+	while (ep < endp) {
+		switch (*ep++) {
+		case REC_START:
+			el = (const ddlchar_t *)ep;
+			for (natts = 0, cp = el + strlen(el) + 1; *cp; ++natts) {
+				cp += strlen(cp) + 1;
+			}
+			{
+				const ddlchar_t *atts[natts + 1];
+				int i;
+
+				for (i = 0, cp = el + strlen(el) + 1; i < natts; ++i) {
+					atts[i] = cp;
+					cp += strlen(cp) + 1;
+				}
+				atts[natts] = NULL;
+				el_start(dcxp, el, atts);
+			}
+			ep = (const uint8_t *)(cp + 1);
+			break;
+		case REC_END:
+			el = (const ddlchar_t *)ep;
+			el_end(dcxp, el);
+			ep += (strlen(el) + 1) * sizeof(ddlchar_t);
+			break;
+		case REC_TEXT:
+			memcpy(&len, ep, sizeof(len));
+			ep += sizeof(len);
+			if (dcxp->wanttext) elem_text(dcxp, (const ddlchar_t *)ep, len);
+			ep += len * sizeof(ddlchar_t);
+			break;
+		default:
+			acnlogmark(lgERR, "Bad module recording");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+#endif  /* CF_DDL_THREADS */
+
+/**********************************************************************/
+/*
+func: parsemodules
+
+Parse each module in the queue in turn. Parsing a module can queue 
+further modules.
+
+If <CF_DDL_THREADS> is set, the modules are read and XML parsed by 
+worker threads which run ahead of the main thread and just replayed 
+here (see <qentry_s>).
+*/
+static void
 parsemodules(struct dcxt_s *dcxp)
 {
 	int fd;
-	int sz;
-	void *buf;
 	struct qentry_s *qentry;
-#if acntestlog(lgDBUG)
+#if CF_DDL_THREADS
+	struct ddlworkers_s workers;
 #endif
 
 	LOG_FSTART();
+#if CF_DDL_THREADS
+	startworkers(dcxp, &workers);
+#endif
 	while ((qentry = dcxp->queuehead)) {
 		acnlogmark(lgINFO, "Parse %s %s", tokstrs[qentry->modtype], qentry->name);
 
 		memset(&dcxp->m, 0, sizeof(dcxp->m));
 		dcxp->elcount = 0;
+#if CF_DDL_THREADS
+		waitmodule(&workers, qentry);
+		if ((fd = qentry->fd) < 0) {
+			errno = qentry->err;
+			acnlogerror(lgERR);
+			exit(EXIT_FAILURE);
+		}
+		if (qentry->bad) {
+			acnlogmark(lgERR, "Can't parse %s", qentry->name);
+			exit(EXIT_FAILURE);
+		}
+#else
 		fd = openddlx(qentry->name);
+#endif
+#if CF_DDL_CACHE
+		ddlcache_addsrc(&dcxp->srcs, qentry->name, fd);
+#endif
 
+#if CF_DDL_THREADS
+		dcxp->wanttext = false;
+		replay(dcxp, qentry);
+		free(qentry->ev.buf);
+#else
 		if (dcxp->parser == NULL) {
 			dcxp->parser = XML_ParserCreateNS(NULL, ' ');
 		} else {
@@ -3850,22 +4506,8 @@ parsemodules(struct dcxt_s *dcxp)
 		XML_SetElementHandler(dcxp->parser, &el_start, &el_end);
 		XML_SetUserData(dcxp->parser, dcxp);
 
-		do {
-			
-			if ((buf = XML_GetBuffer(dcxp->parser, BUFF_SIZE)) == NULL) {
-				acnlogmark(lgERR, "Can't allocate buffer %s", strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-			if ((sz = read(fd, buf, BUFF_SIZE)) < 0) {
-				acnlogerror(lgERR);
-				exit(EXIT_FAILURE);
-			}
-			if (! XML_ParseBuffer(dcxp->parser, sz, sz == 0)) {
-				acnlogmark(lgERR, "Parse error");
-				exit(EXIT_FAILURE);
-			}
-	
-		} while (sz > 0);
+		if (parsefile(dcxp->parser, fd, qentry->name) < 0) exit(EXIT_FAILURE);
+#endif
 	
 		close(fd);	/* leave files as we found them */
 
@@ -3884,7 +4526,11 @@ parsemodules(struct dcxt_s *dcxp)
 		free(qentry);
 	}
 	dcxp->queuetail = NULL;
+#if CF_DDL_THREADS
+	stopworkers(dcxp, &workers);
+#else
 	XML_ParserFree(dcxp->parser);
+#endif
 	/*
 	Dump parser scoped strings
 	*/
@@ -3906,6 +4552,10 @@ This function returns once the entire queue has been processed.
 As parsing progresses, both the property tree (DDL properties) and the address
 map (DMP properties) are constructed.
 
+If <CF_DDL_CACHE> is set and name is a DCID, a cached image of the 
+tree is used if one exists and is up to date with its sources, 
+otherwise the newly parsed tree is saved to the cache.
+
 returns:pointer to the resulting rootdev structure (<struct rootdev_s>) or
 NULL if unrecoverable errors are encountered.
 
@@ -3919,6 +4569,14 @@ parseroot(const char *name)
 	int i = 0;
 
 	LOG_FSTART();
+	if (!tokhash.ready && !tokhash.failed) tokhash_init();
+#if CF_DDL_CACHE
+	if ((dcxt.rootdev = ddlcache_load(name)) != NULL) {
+		adduuid(&devtrees, dcxt.rootdev->dcid);
+		LOG_FEND();
+		return dcxt.rootdev;
+	}
+#endif
 	memset(&dcxt, 0, sizeof(dcxt));
 	dcxt.skip = NOSKIP;
 	dcxt.elprev = TK__none_;
@@ -3941,6 +4599,10 @@ parseroot(const char *name)
 	}
 
 	if (dcxt.rootdev) {
+#if CF_DDLACCESS_DMP
+		/* map is complete - replace property tests by table lookups */
+		buildhittables(dcxt.rootdev->amap);
+#endif
 		/* finished root property */
 		acnlogmark(lgDBUG, "Found %d net properties", dcxt.rootdev->nnetprops);
 		acnlogmark(lgDBUG, " %d flat net properties", dcxt.rootdev->nflatprops);
@@ -3948,113 +4610,186 @@ parseroot(const char *name)
 		acnlogmark(lgDBUG, " max addr %u", dcxt.rootdev->maxaddr);
 
 		adduuid(&devtrees, dcxt.rootdev->dcid);
+#if CF_DDL_CACHE
+		ddlcache_save(dcxt.rootdev, dcxt.srcs);
+#endif
 	}
+#if CF_DDL_CACHE
+	ddlcache_freesrcs(dcxt.srcs);
+#endif
 	LOG_FEND();
 	return dcxt.rootdev;
 }
 /**********************************************************************/
 /*
-Destructors
+func: freerootdev
+
+Free all the resources used by a rootdev_s. The tree itself is in the 
+rootdev's arena so there is no need to walk it.
 */
-/**********************************************************************/
-static void
-freeprop(struct ddlprop_s *prop)
+void
+freerootdev(struct rootdev_s *dev)
 {
-	
 	LOG_FSTART();
-	/*
-	if (prop->id) freestr((void *)prop->id);
-	*/
-	
-	while (1) {
-		struct ddlprop_s *pp;
-
-		pp = prop->children;
-		if (pp == NULL) break;
-		prop->children = pp->siblings;
-		pp->siblings = NULL;
-		freeprop(pp);
+	if (dev->lru.r) {
+		dlUnlink(treelru, dev, lru);
+		treemem -= dev->memsize;
+	}
+	if (finduuid(&devtrees, dev->dcid) == dev->dcid)
+		unlinkuuid(&devtrees, dev->dcid);
+#if CF_DDL_CACHE
+	if (dev->cache) {
+		ddlcache_free(dev);
+		LOG_FEND();
+		return;
 	}
-	acnlogmark(lgDBUG, "     Freeing %s", propxname(prop));
-	
-	/*
-	FIXME: Check carefully for memory leaks.
-	*/
-	switch (prop->vtype) {
-	case VT_NULL:
-	case VT_imm_unknown:
-	case VT_implied:
-		break;
-	case VT_network: {
+#endif
+	pool_reset(&dev->strpool);
+	if (dev->idtab.v) acnfree(dev->idtab.v);
+	if (dev->amap) freeamap(dev->amap);
+	arena_reset(&dev->arena);
+	free(dev);
+	LOG_FEND();
+}
+
+/**********************************************************************/
 /*
-		struct dmpprop_s *np;
+Shared device trees
 
-		np = prop->v.net.dmp;
-		free(np);
+All remote components with the same DCID can share one device tree 
+and address map, which must then be treated as read only. 
+<getrootdev()> finds or parses the tree and <droprootdev()> releases 
+it. Trees which are no longer used stay cached until the total 
+memory of shared trees goes over <CF_DDL_TREEBUDGET>, then the least 
+recently used are freed.
+
+Trees returned directly by <parseroot()> belong to the caller and 
+are not shared.
 */
-		break;
-	}
-	case VT_include:
-		acnlogmark(lgWARN, "     Freeing incomplete includedev");
-	case VT_device:
-		if (prop->v.dev.params) {
-			struct param_s *pp, *ep;
+/**********************************************************************/
+/*
+Approximate memory held by a tree.
+*/
+static size_t
+treesize(struct rootdev_s *root)
+{
+	size_t size;
 
-			ep = NULL;
-			if (prop->parent)
-				ep = itsdevice(prop->parent)->v.dev.params;
-			
-			while ((pp = prop->v.dev.params) != ep) {
-				prop->v.dev.params = pp->nxt;
-				free(pp);
-			}
-		}
-		break;
-	case VT_imm_uint:
-	case VT_imm_sint:
-	case VT_imm_float:
-		if (prop->v.imm.count > 1) free(prop->v.imm.t.ptr);
-		break;
-	case VT_imm_string:
-		if (prop->v.imm.count > 1) free(prop->v.imm.t.Astr);
-		break;
-	case VT_imm_object:
-		if (prop->v.imm.count > 1) {
-			uint32_t i;
+	size = sizeof(struct rootdev_s) + root->arena.size
+			+ pool_memsize(&root->strpool);
+	if (root->idtab.v)
+		size += ((size_t)1 << root->idtab.power) * sizeof(*root->idtab.v);
+#if CF_DDLACCESS_DMP
+	if (root->amap) size += sizeof(union addrmap_u) + root->amap->any.size;
+#endif
+#if CF_DDL_CACHE
+	size += root->cachesize;
+#endif
+	return size;
+}
 
-			for (i = 0; i < prop->v.imm.count; ++i)
-				free(prop->v.imm.t.Aobj[i].data);
-			free(prop->v.imm.t.Aobj);
-		} else {
-			free(prop->v.imm.t.obj.data);
+/**********************************************************************/
+/*
+Free unused trees, least recently used first, until within budget.
+*/
+static void
+evicttrees(void)
+{
+	struct rootdev_s *root;
+	struct rootdev_s *prev;
+	bool last;
+
+	if (treelru == NULL) return;
+	for (root = treelru->lru.l; treemem > CF_DDL_TREEBUDGET; root = prev) {
+		prev = root->lru.l;
+		last = (root == treelru);
+		if (root->usecount == 0) {
+			acnlogmark(lgDBUG, "Evict device tree %u bytes",
+						(unsigned int)root->memsize);
+			freerootdev(root);
 		}
-		break;
+		if (last) break;
 	}
-	free(prop);
-	LOG_FEND();
 }
+
 /**********************************************************************/
 /*
-func: freerootdev
+func: findrootdev
 
-Free all the resources used by a rootdev_s.
+Find a shared device tree which is already in memory. If found it is 
+marked as used and must be released by <droprootdev()>. Returns NULL 
+if not found.
 */
-void
-freerootdev(struct rootdev_s *dev)
+struct rootdev_s *
+findrootdev(const uint8_t *dcid)
 {
-	struct dmpprop_s *dprop;
+	const uint8_t *rootdcid;
+	struct rootdev_s *root;
 
-	LOG_FSTART();
-	pool_reset(&dev->strpool);
-	if (dev->ddlroot) freeprop(dev->ddlroot);
-	if (dev->amap) freeamap(dev->amap);
-	for (dprop = dev->dmpprops; dprop;) {
-	   struct dmpprop_s *np;
+	if ((rootdcid = finduuid(&devtrees, dcid)) == NULL) return NULL;
+	root = container_of(rootdcid, struct rootdev_s, dcid[0]);
+	if (root->lru.r == NULL) return NULL;  /* not shared */
 
-	   np = dprop->nxt;
-	   free(dprop);
-	   dprop = np;
+	if (root != treelru) {
+		dlUnlink(treelru, root, lru);
+		dlAddHead(treelru, root, lru);
 	}
-	free(dev);
+	++root->usecount;
+	return root;
+}
+
+/**********************************************************************/
+/*
+func: getrootdev
+
+Get a shared device tree for dcid, parsing the DDL if it is not 
+already in memory. The tree's address map is optimized by 
+<choosemap()> before it is first returned. Each successful call must 
+be balanced by a call to <droprootdev()>.
+
+Parsing is synchronous so a second request for a DCID always finds 
+the tree made by the first.
+*/
+struct rootdev_s *
+getrootdev(const uint8_t *dcid)
+{
+	struct rootdev_s *root;
+	char dcidstr[UUID_STR_SIZE];
+
+	LOG_FSTART();
+	if ((root = findrootdev(dcid)) != NULL) {
+		LOG_FEND();
+		return root;
+	}
+	uuid2str(dcid, dcidstr);
+	if ((root = parseroot(dcidstr)) == NULL) {
+		LOG_FEND();
+		return NULL;
+	}
+#if CF_DDLACCESS_DMP
+	/* pick index, hybrid or search map to suit the device */
+	choosemap(root->amap, CF_DMPMAP_MEMBUDGET);
+#endif
+	root->usecount = 1;
+	root->memsize = treesize(root);
+	treemem += root->memsize;
+	dlAddHead(treelru, root, lru);
+	acnlogmark(lgDBUG, "Shared device tree %s %u bytes", dcidstr,
+				(unsigned int)root->memsize);
+	evicttrees();
 	LOG_FEND();
+	return root;
+}
+
+/**********************************************************************/
+/*
+func: droprootdev
+
+Release a tree obtained from <getrootdev()> or <findrootdev()>.
+*/
+void
+droprootdev(struct rootdev_s *root)
+{
+	assert(root->usecount > 0);
+	if (--root->usecount == 0) evicttrees();
 }
@@ -39,6 +39,24 @@ lgOFF lgEMRG lgALRT lgCRIT lgERR lgWARN lgNTCE lgINFO lgDBUG
 #include <pwd.h>
 #include <unistd.h>
 #include "acn.h"
+#if CF_DDL_MMAP
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#if CF_DDL_INDEX
+#include <stdio.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <expat.h>
+#if CF_DDL_THREADS
+#include <pthread.h>
+#endif
+#if CF_OS_LINUX
+#include <sys/inotify.h>
+#endif
+#endif  /* CF_DDL_INDEX */
 
 /**********************************************************************/
 /*
@@ -59,8 +77,14 @@ available, other local machines which may cache DDL modules, etc.
 3. Split the file if it contains multiple modules
 4. Return an open file descriptior for the file
 
-Currently it only implements step one. It looks for the file in a 
-path, optionally with one of the supplied extensions.
+Currently it only implements steps one and three. It looks for the 
+file in a path, optionally with one of the supplied extensions. With 
+<CF_DDL_INDEX> the directories in the path are indexed by module 
+UUID first (see <Module index>) and a module from a file holding 
+several is split out into a file of its own. Step two is not done
+here because parsing is synchronous; instead <ddlfetch()> (with
+<CF_DDL_FETCH>) copies a device's modules by TFTP into the first
+directory of the path before the tree is parsed.
 */
 /**********************************************************************/
 /*
@@ -128,6 +152,517 @@ openpath(const char *path, const char *name, const char *exts)
 	return -1;
 }
 
+/**********************************************************************/
+#if CF_DDL_INDEX
+/*
+section: Module index
+
+Instead of trying every directory and extension in the path with 
+open() for each module, the first lookup reads every candidate file 
+in the path directories (names ending `.ddl` or `.xml` or which are 
+a UUID) and indexes the modules each contains by UUID. A lookup is 
+then a search of the UUID set followed by one open().
+
+Where a UUID is found in more than one file, the one from the 
+earliest directory in the path is used. A module found in a file 
+which holds several is copied out to a temporary file containing 
+only that module (see splitmodule()).
+
+On Linux the directories are watched with inotify and changes are 
+applied before each lookup. If the index cannot be kept current or 
+a module is not in it, <openddl()> falls back to searching the path.
+*/
+struct modref_s;
+
+/* one for each UUID in the index */
+struct modidx_s {
+	uint8_t uuid[UUID_SIZE];
+	struct modref_s *refs;  /* files holding this module - best first */
+};
+
+/* a module found in an indexed file */
+struct modref_s {
+	struct modref_s *unxt;  /* same UUID in other files */
+	struct modref_s *fnxt;  /* other modules in the same file */
+	struct modidx_s *idx;
+	struct ddlfile_s *file;
+	long start;  /* module bytes if the file has several, else 0 */
+	long end;
+};
+
+struct ddlfile_s {
+	struct ddlfile_s *nxt;
+	struct ddldir_s *dir;
+	struct modref_s *mods;
+	long hdrend;  /* end of text before the first module */
+	long tlrstart;  /* start of text after the last module */
+	char name[];
+};
+
+struct ddldir_s {
+	struct ddldir_s *nxt;
+	struct ddlfile_s *files;
+	unsigned int pri;  /* position in the path */
+	int wd;
+	char path[];
+};
+
+static struct {
+	char *path;  /* DDL path the index was built from */
+	struct ddldir_s *dirs;
+	struct uuidset_s mods;
+	int infd;
+	bool stale;
+} ddlindex = {.infd = -1};
+
+#if CF_DDL_THREADS
+static pthread_mutex_t indexlock = PTHREAD_MUTEX_INITIALIZER;
+#define lockindex() pthread_mutex_lock(&indexlock)
+#define unlockindex() pthread_mutex_unlock(&indexlock)
+#else
+#define lockindex()
+#define unlockindex()
+#endif
+
+/**********************************************************************/
+/*
+Read all of an open file into a new buffer.
+*/
+static char *
+readall(int fd, size_t size)
+{
+	char *buf;
+	size_t got;
+	ssize_t sz;
+
+	buf = mallocx(size + 1);
+	for (got = 0; got < size; got += sz) {
+		if ((sz = read(fd, buf + got, size - got)) <= 0) {
+			if (sz == 0) errno = ESTALE;
+			free(buf);
+			return NULL;
+		}
+	}
+	return buf;
+}
+
+/**********************************************************************/
+static int
+writeall(int fd, const char *data, size_t len)
+{
+	ssize_t sz;
+
+	for (; len > 0; len -= sz, data += sz) {
+		if ((sz = write(fd, data, len)) < 0) return -1;
+	}
+	return 0;
+}
+
+/**********************************************************************/
+/*
+Remove a module reference from the index.
+*/
+static void
+dropref(struct modref_s *ref)
+{
+	struct modidx_s *idx = ref->idx;
+	struct modref_s **rpp;
+
+	for (rpp = &idx->refs; *rpp != ref; rpp = &(*rpp)->unxt) {}
+	*rpp = ref->unxt;
+	if (idx->refs == NULL) {
+		unlinkuuid(&ddlindex.mods, idx->uuid);
+		acnfree(idx);
+	}
+	free(ref);
+}
+
+/**********************************************************************/
+/*
+Add a module reference to the index in path order.
+*/
+static void
+addref(struct modref_s *ref, const uint8_t *uuid)
+{
+	struct modidx_s *idx;
+	struct modref_s **rpp;
+	size_t create = sizeof(struct modidx_s);
+
+	idx = (struct modidx_s *)findornewuuid(&ddlindex.mods, uuid, &create);
+	if ((ref->idx = idx) == NULL) {
+		acnlogerror(lgERR);
+		exit(EXIT_FAILURE);
+	}
+	for (rpp = &idx->refs; *rpp; rpp = &(*rpp)->unxt) {
+		if ((*rpp)->file->dir->pri > ref->file->dir->pri) break;
+	}
+	ref->unxt = *rpp;
+	*rpp = ref;
+}
+
+/**********************************************************************/
+/*
+Module scanning. Only elements at the second level (within the DDL 
+element) are of interest.
+*/
+struct scan_s {
+	XML_Parser parser;
+	struct ddlfile_s *file;
+	int depth;
+};
+
+static void
+scan_start(void *data, const XML_Char *el, const XML_Char **atts)
+{
+	struct scan_s *scan = (struct scan_s *)data;
+	struct modref_s *ref;
+	uint8_t uuid[UUID_SIZE];
+
+	if (++scan->depth != 2) return;
+	for (; *atts; atts += 2) {
+		if (strcmp(*atts, "UUID") == 0) break;
+	}
+	if (*atts == NULL || str2uuid(atts[1], uuid) != 0) return;
+
+	ref = acnNew(struct modref_s);
+	ref->file = scan->file;
+	ref->start = (long)XML_GetCurrentByteIndex(scan->parser);
+	ref->fnxt = scan->file->mods;
+	scan->file->mods = ref;
+	addref(ref, uuid);
+}
+
+static void
+scan_end(void *data, const XML_Char *el)
+{
+	struct scan_s *scan = (struct scan_s *)data;
+	struct modref_s *ref;
+
+	if (scan->depth-- != 2 || (ref = scan->file->mods) == NULL
+		|| ref->end != 0) return;
+	ref->end = (long)(XML_GetCurrentByteIndex(scan->parser)
+						+ XML_GetCurrentByteCount(scan->parser));
+}
+
+/**********************************************************************/
+/*
+Index the modules in a file. Files which cannot be read or parsed 
+are left out of the index.
+*/
+static void
+scanfile(struct ddldir_s *dir, const char *name)
+{
+	char fname[strlen(dir->path) + strlen(name) + 2];
+	struct scan_s scan;
+	struct ddlfile_s *file;
+	struct modref_s *ref;
+	struct stat st;
+	char *buf;
+	int fd;
+	bool ok;
+
+	sprintf(fname, "%s%c%s", dir->path, DIRSEP, name);
+	if ((fd = open(fname, O_RDONLY)) < 0) return;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0
+		|| st.st_size > INT_MAX
+		|| (buf = readall(fd, st.st_size)) == NULL)
+	{
+		close(fd);
+		return;
+	}
+	close(fd);
+
+	file = mallocxz(sizeof(struct ddlfile_s) + strlen(name) + 1);
+	strcpy(file->name, name);
+	file->dir = dir;
+	scan.file = file;
+	scan.depth = 0;
+	if ((scan.parser = XML_ParserCreate(NULL)) == NULL) {
+		acnlogerror(lgERR);
+		exit(EXIT_FAILURE);
+	}
+	XML_SetElementHandler(scan.parser, &scan_start, &scan_end);
+	XML_SetUserData(scan.parser, &scan);
+	ok = XML_Parse(scan.parser, buf, (int)st.st_size, 1) != XML_STATUS_ERROR;
+	XML_ParserFree(scan.parser);
+	free(buf);
+
+	if (!ok || file->mods == NULL) {
+		acnlogmark(lgDBUG, "not indexed \"%s\"", fname);
+		while ((ref = file->mods)) {
+			file->mods = ref->fnxt;
+			dropref(ref);
+		}
+		free(file);
+		return;
+	}
+	if (file->mods->fnxt == NULL) {
+		file->mods->start = file->mods->end = 0;
+	} else {
+		/* mods are in reverse order */
+		file->tlrstart = file->mods->end;
+		for (ref = file->mods; ref->fnxt; ref = ref->fnxt) {}
+		file->hdrend = ref->start;
+	}
+	file->nxt = dir->files;
+	dir->files = file;
+}
+
+/**********************************************************************/
+/*
+Remove a file from the index.
+*/
+static void
+dropfile(struct ddldir_s *dir, const char *name)
+{
+	struct ddlfile_s **fpp;
+	struct ddlfile_s *file;
+	struct modref_s *ref;
+
+	for (fpp = &dir->files; (file = *fpp); fpp = &file->nxt) {
+		if (strcmp(file->name, name) == 0) break;
+	}
+	if (file == NULL) return;
+	*fpp = file->nxt;
+	while ((ref = file->mods)) {
+		file->mods = ref->fnxt;
+		dropref(ref);
+	}
+	free(file);
+}
+
+/**********************************************************************/
+static bool
+isddlname(const char *name)
+{
+	size_t len = strlen(name);
+
+	if (name[0] == '.') return false;
+	if (len > 4 && (strcmp(name + len - 4, ".ddl") == 0
+					|| strcmp(name + len - 4, ".xml") == 0)) return true;
+	return (len == UUID_STR_SIZE - 1 && str2uuid(name, NULL) == 0);
+}
+
+/**********************************************************************/
+static void
+freeindex(void)
+{
+	struct ddldir_s *dir;
+
+	while ((dir = ddlindex.dirs)) {
+		ddlindex.dirs = dir->nxt;
+		while (dir->files) dropfile(dir, dir->files->name);
+		free(dir);
+	}
+	if (ddlindex.infd >= 0) {
+		close(ddlindex.infd);
+		ddlindex.infd = -1;
+	}
+	free(ddlindex.path);
+	ddlindex.path = NULL;
+}
+
+/**********************************************************************/
+/*
+Build the index from a path. An empty path element is the current 
+directory as it is for <openpath()>.
+*/
+static void
+buildindex(const char *path)
+{
+	struct ddldir_s **dpp;
+	struct ddldir_s *dir;
+	const char *ep;
+	unsigned int pri;
+	DIR *dp;
+	struct dirent *de;
+
+	freeindex();
+	ddlindex.path = mallocx(strlen(path) + 1);
+	strcpy(ddlindex.path, path);
+	ddlindex.stale = false;
+#if CF_OS_LINUX
+	ddlindex.infd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (ddlindex.infd < 0) acnlogerror(lgWARN);
+#endif
+	dpp = &ddlindex.dirs;
+	pri = 0;
+	do {
+		size_t len;
+
+		for (ep = path; *ep && *ep != PATHSEP; ++ep) {}
+		len = ep - path;
+		if (len == 0) {
+			path = ".";
+			len = 1;
+		}
+		dir = mallocxz(sizeof(struct ddldir_s) + len + 1);
+		memcpy(dir->path, path, len);
+		dir->pri = pri++;
+		dir->wd = -1;
+		*dpp = dir;
+		dpp = &dir->nxt;
+		path = ep;
+
+		if ((dp = opendir(dir->path)) == NULL) continue;
+#if CF_OS_LINUX
+		if (ddlindex.infd >= 0) {
+			dir->wd = inotify_add_watch(ddlindex.infd, dir->path,
+					IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE
+					| IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+		}
+#endif
+		while ((de = readdir(dp)) != NULL) {
+			if (isddlname(de->d_name)) scanfile(dir, de->d_name);
+		}
+		closedir(dp);
+	} while (*path++);
+}
+
+/**********************************************************************/
+#if CF_OS_LINUX
+/*
+Apply any directory changes reported since the last lookup. Events 
+which affect a whole directory mark the index stale so it is 
+rebuilt.
+*/
+static void
+updateindex(void)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	struct ddldir_s *dir;
+	ssize_t len;
+	char *cp;
+
+	if (ddlindex.infd < 0) return;
+	while ((len = read(ddlindex.infd, buf, sizeof(buf))) > 0) {
+		for (cp = buf; cp < buf + len; cp += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)cp;
+			if (ev->mask & (IN_Q_OVERFLOW | IN_IGNORED
+									| IN_DELETE_SELF | IN_MOVE_SELF)) {
+				ddlindex.stale = true;
+				continue;
+			}
+			if (ev->len == 0 || !isddlname(ev->name)) continue;
+			/* a directory may be in the path more than once */
+			for (dir = ddlindex.dirs; dir; dir = dir->nxt) {
+				if (dir->wd != ev->wd) continue;
+				acnlogmark(lgDBUG, "changed \"%s%c%s\"", dir->path, DIRSEP, ev->name);
+				dropfile(dir, ev->name);
+				if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+					scanfile(dir, ev->name);
+			}
+		}
+	}
+}
+#else
+#define updateindex()
+#endif
+
+/**********************************************************************/
+/*
+Copy one module out of a file holding several into a temporary 
+file, together with the text before the first module and after the 
+last (the XML declaration and DDL element tags). The copy is given 
+the modification time of the original so <ddlcache.c> sees it as 
+unchanged while the original is. Consumes fd and returns a 
+descriptor for the copy or -1 on error.
+*/
+static int
+splitmodule(int fd, const struct modref_s *ref)
+{
+	const struct ddlfile_s *file = ref->file;
+	struct timespec times[2];
+	struct stat st;
+	char *buf;
+	int sfd;
+
+	if (fstat(fd, &st) < 0 || (buf = readall(fd, st.st_size)) == NULL) {
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	if (st.st_size < file->tlrstart) {
+		/* changed since it was indexed */
+		free(buf);
+		ddlindex.stale = true;
+		errno = ESTALE;
+		return -1;
+	}
+#if CF_OS_LINUX
+	sfd = memfd_create(file->name, MFD_CLOEXEC);
+#else
+	{
+		FILE *tf;
+
+		sfd = -1;
+		if ((tf = tmpfile()) != NULL) {
+			sfd = dup(fileno(tf));
+			fclose(tf);
+		}
+	}
+#endif
+	if (sfd < 0
+		|| writeall(sfd, buf, file->hdrend) < 0
+		|| writeall(sfd, buf + ref->start, ref->end - ref->start) < 0
+		|| writeall(sfd, buf + file->tlrstart, st.st_size - file->tlrstart) < 0
+		|| lseek(sfd, 0, SEEK_SET) < 0)
+	{
+		if (sfd >= 0) close(sfd);
+		free(buf);
+		return -1;
+	}
+	free(buf);
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	futimens(sfd, times);
+	return sfd;
+}
+
+/**********************************************************************/
+/*
+Look up a module in the index, building or updating it first as 
+necessary. Returns an open file descriptor or -1 with errno ENOENT 
+if the module is not indexed.
+*/
+static int
+openindexed(const char *path, const uint8_t *dcid)
+{
+	const struct modidx_s *idx;
+	const struct modref_s *ref;
+	int fd;
+
+	lockindex();
+	if (ddlindex.path == NULL || strcmp(path, ddlindex.path) != 0) {
+		buildindex(path);
+	} else {
+		updateindex();
+		if (ddlindex.stale) buildindex(path);
+	}
+	if ((idx = (const struct modidx_s *)finduuid(&ddlindex.mods, dcid))
+			== NULL) {
+		unlockindex();
+		errno = ENOENT;
+		return -1;
+	}
+	ref = idx->refs;
+	{
+		char fname[strlen(ref->file->dir->path) + strlen(ref->file->name) + 2];
+
+		sprintf(fname, "%s%c%s", ref->file->dir->path, DIRSEP, ref->file->name);
+		acnlogmark(lgDBUG, "index \"%s\"", fname);
+		if ((fd = open(fname, O_RDONLY)) < 0) {
+			if (errno == ENOENT) ddlindex.stale = true;
+		} else if (ref->end > ref->start) {
+			fd = splitmodule(fd, ref);
+		}
+	}
+	unlockindex();
+	return fd;
+}
+#endif  /* CF_DDL_INDEX */
+
 /**********************************************************************/
 const char default_path[] = "/.acacian/ddlcache";
 
@@ -148,28 +683,58 @@ gethomedir(void)
 }
 /**********************************************************************/
 /*
-func: openddlx
+func: getddlpath
+
+Return the DDL search path. This is the environment variable 
+`DDL_PATH` if set, otherwise the default `$HOME/.acacian/ddlcache` 
+which is constructed in buf. Returns NULL if neither is available.
+*/
+const char *
+getddlpath(char *buf, size_t size)
+{
+	const char *path;
+
+	if ((path = getenv("DDL_PATH")) == NULL
+		&& (path = gethomedir()) != NULL
+	) {
+		char *cp;
 
-Open a ddl file or exit on failure.
+		acnlogmark(lgDBUG, "constructing default path");
+		cp = stpncpy(buf, path, size);
+		cp = stpncpy(cp, default_path, buf + size - cp);
+		path = buf;
+	}
+	return path;
+}
+
+/**********************************************************************/
+/*
+func: openddl
+
+Open a ddl file.
 
 If the supplied name looks like a UUID string it is converted to lower case 
 which is the convention used for UUID file-names (should use a full 
 case insensitive file search here). Then the path is searched for 
 `name`, `name.ddl` or `name.xml`. If the file is fouind the opened 
-file descriptor is returned. If it cannot be found openddlx() quits 
-(should do better here!).
+file descriptor is returned, otherwise -1.
 
 The path is given by the environment variable `DDL_PATH`. If this isn't
 found then the default `$HOME/.acacian/ddlcache` is used.
+
+With <CF_DDL_INDEX> a UUID is first looked up in the module index 
+and the path is only searched if it is not found there.
 */
 int
-openddlx(ddlchar_t *name)
+openddl(const ddlchar_t *name)
 {
 	const char *path;
-	int fd;
 	const char *nm;
 	char buf[UUID_STR_SIZE];
 	char dfpath[100];
+#if CF_DDL_INDEX
+	uint8_t dcid[UUID_SIZE];
+#endif
 
 	nm = name;
 	if (str2uuid(name, NULL) == 0) {  /* is name a UUID? */
@@ -179,21 +744,71 @@ openddlx(ddlchar_t *name)
 		nm = buf;
 	}
 
-	if ((path = getenv("DDL_PATH")) == NULL
-		&& (path = gethomedir()) != NULL
-	) {
-		char *cp;
+	path = getddlpath(dfpath, sizeof(dfpath));
+	acnlogmark(lgDBUG, "DDL_PATH \"%s\"", path);
+#if CF_DDL_INDEX
+	if (path && str2uuid(name, dcid) == 0) {
+		int fd;
 
-		acnlogmark(lgDBUG, "constructing default path");
-		cp = stpncpy(dfpath, path, sizeof(dfpath));
-		cp = stpncpy(cp, default_path, dfpath + sizeof(dfpath) - cp);
-		path = dfpath;
+		if ((fd = openindexed(path, dcid)) >= 0 || errno != ENOENT)
+			return fd;
 	}
-	acnlogmark(lgDBUG, "DDL_PATH \"%s\"", path);
-	fd = openpath(path, nm, ":.ddl:.xml");
-	if (fd >= 0) return fd;
+#endif
+	return openpath(path, nm, ":.ddl:.xml");
+}
+
+/**********************************************************************/
+/*
+func: openddlx
+
+Open a ddl file as <openddl()> or exit on failure (should do better 
+here!).
+*/
+int
+openddlx(ddlchar_t *name)
+{
+	int fd;
+
+	if ((fd = openddl(name)) >= 0) return fd;
 
 	acnlogerror(lgERR);
 	exit(EXIT_FAILURE);
 }
 
+#if CF_DDL_MMAP
+/**********************************************************************/
+/*
+func: mapddl
+
+Map a DDL file opened by <openddl()> read-only into memory. On 
+success the size is put in *sizep and the start of the mapping 
+returned. If fd is not a regular file, is empty or is too big to map 
+returns NULL without logging and the caller should read it instead.
+*/
+const void *
+mapddl(int fd, size_t *sizep)
+{
+	struct stat st;
+	void *map;
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)
+		|| st.st_size <= 0 || st.st_size > INT_MAX) return NULL;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) return NULL;
+	*sizep = st.st_size;
+	return map;
+}
+
+/**********************************************************************/
+/*
+func: unmapddl
+
+Release a mapping returned by <mapddl()>.
+*/
+void
+unmapddl(const void *map, size_t size)
+{
+	munmap((void *)map, size);
+}
+#endif  /* CF_DDL_MMAP */
@@ -913,6 +913,16 @@ discAtt_cb(
 			if (rslt & slp_dev) {
 				Rcomp->slp.dcid = mallocx(UUID_SIZE);
 				uuidcpy(Rcomp->slp.dcid, uuid);
+#if CF_DDL_FETCH
+				/* keep the first DDL location we can fetch from */
+				for (i = eatts->vcount[na_ddl], cp = eatts->attp[na_ddl];
+						Rcomp->slp.ddlurl == NULL && i--;
+						cp = strchr(cp, 0) + 1)
+				{
+					if (strncasecmp(cp, "$:tftp://", 9) == 0)
+						Rcomp->slp.ddlurl = strdup(cp);
+				}
+#endif
 			}
 			goto done;
 		}
@@ -33,6 +33,12 @@ lgOFF lgEMRG lgALRT lgCRIT lgERR lgWARN lgNTCE lgINFO lgDBUG
 /**********************************************************************/
 
 #include "acn.h"
+#if CF_DMPON_TCP
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <netinet/tcp.h>
+#endif
 
 /**********************************************************************/
 /*
@@ -81,6 +87,22 @@ dmp_register(
 /*
 Transmit functions
 
+With both SDT and stream transports, the transmit context records 
+which it is using.
+*/
+#if CF_DMP_MULTITRANSPORT
+#define istcp(tcxt) ((tcxt)->tcp)
+#elif CF_DMPON_TCP
+#define istcp(tcxt) 1
+#else
+#define istcp(tcxt) 0
+#endif
+
+#if CF_DMPON_TCP
+static int tcp_newblock(struct dmptcxt_s *tcxt, int *size);
+static void tcp_flush(struct dmptcxt_s *tcxt);
+#endif
+/*
 dmp_newblock()
 */
 /**********************************************************************/
@@ -91,6 +113,16 @@ dmp_newblock(struct dmptcxt_s *tcxt, int *size)
 	assert(tcxt);
 	if (tcxt->pdup) dmp_closeblock(tcxt);
 
+#if CF_DMPON_TCP
+	if (istcp(tcxt)) {
+		if (tcp_newblock(tcxt, size) < 0) {
+			acnlogmark(lgWARN, "dmp_newblock fail");
+			return -1;
+		}
+		tcxt->lastaddr = 0;
+		return 0;
+	}
+#endif
 #if CF_DMPON_SDT
 	tcxt->pdup = startProtoMsg(&tcxt->txwrap, tcxt->dest, DMP_PROTOCOL_ID, tcxt->wflags, size);
 	if (tcxt->pdup == NULL) {
@@ -115,6 +147,14 @@ void
 dmp_closeblock(struct dmptcxt_s *tcxt)
 {
 	LOG_FSTART();
+#if CF_DMPON_TCP
+	if (istcp(tcxt)) {
+		/* commit the PDUs to the block */
+		tcxt->txblk->len = tcxt->pdup - tcxt->txblk->data;
+		tcxt->pdup = NULL;
+		return;
+	}
+#endif
 #if CF_DMPON_SDT
 	endProtoMsg(tcxt->txwrap, tcxt->pdup);
 	tcxt->pdup = NULL;
@@ -127,8 +167,14 @@ void
 dmp_flushpdus(struct dmptcxt_s *tcxt)
 {
 	LOG_FSTART();
-#if CF_DMPON_SDT
 	if (tcxt->pdup) dmp_closeblock(tcxt);
+#if CF_DMPON_TCP
+	if (istcp(tcxt)) {
+		tcp_flush(tcxt);
+		return;
+	}
+#endif
+#if CF_DMPON_SDT
 	flushWrapper(&tcxt->txwrap);
 #endif
 	LOG_FEND();
@@ -248,7 +294,7 @@ dmp_closepdu(struct dmptcxt_s *tcxt, uint8_t *nxtp)
 	LOG_FSTART();
 	assert(tcxt);
 	assert(tcxt->pdup);
-	assert(nxtp <= tcxt->txwrap->txbuf + tcxt->txwrap->size);
+	assert(nxtp <= tcxt->endp);
 
 	marshalU16(tcxt->pdup, ((nxtp - tcxt->pdup) + FIRST_FLAGS));
 	tcxt->lastaddr = tcxt->nxtaddr;
@@ -287,7 +333,7 @@ dmp_truncatepdu(struct dmptcxt_s *tcxt, uint32_t count, uint8_t *nxtp)
 			/* ensure we've a range */
 			&& IS_RANGE(tcxt->pdup[DMP_OFS_HEADER])
 			/* no overflow (always passes if nxtp is NULL) */
-			&& nxtp <= tcxt->txwrap->txbuf + tcxt->txwrap->size
+			&& nxtp <= tcxt->endp
 	);
 
 	switch (tcxt->pdup[DMP_OFS_HEADER] & DMPAD_SIZEMASK) {
@@ -311,6 +357,781 @@ dmp_truncatepdu(struct dmptcxt_s *tcxt, uint32_t count, uint8_t *nxtp)
 	LOG_FEND();
 }
 /**********************************************************************/
+static int
+cmpvaladdr(const void *a, const void *b)
+{
+	uint32_t aa = ((const struct dmpval_s *)a)->addr;
+	uint32_t ba = ((const struct dmpval_s *)b)->addr;
+
+	return (aa > ba) - (aa < ba);
+}
+
+/**********************************************************************/
+/*
+dmp_txvals()
+
+Transmit a list of property values as a compact stream of PDUs.
+
+The list is sorted by address then split into runs of equally sized 
+values at a constant address increment. Each run goes out as a 
+single range address PDU (or a single address PDU if the run has 
+only one member) and if all values in a set-property run are the 
+same, as a range address with a single common value. dmp_openpdu 
+chooses the address size and relative addressing and starts new 
+blocks (and wrappers) as needed. Runs too big for one PDU are split.
+
+Returns the number of PDUs generated or -1 on error.
+*/
+static int
+dmp_txvals(struct dmptcxt_s *tcxt, uint8_t vec, struct dmpval_s *vals, int count)
+{
+	struct dmpval_s *vp;
+	struct dmpval_s *endp;
+	struct dmpval_s *rp;
+	struct adspec_s ads;
+	uint8_t *txp;
+	uint32_t inc;
+	unsigned int n;
+	unsigned int maxn;
+	int size;
+	int npdus = 0;
+	bool common;
+
+	LOG_FSTART();
+	if (count > 1) qsort(vals, count, sizeof(*vals), &cmpvaladdr);
+
+	for (vp = vals, endp = vals + count; vp < endp; vp += n) {
+		size = vp->size;
+		maxn = (DMP_SDT_MAXDATA - 12) / (size ? size : 1);
+		inc = (vp + 1 < endp) ? vp[1].addr - vp->addr : 0;
+
+		/* find the extent of the run */
+		common = (vec == DMP_SET_PROPERTY);
+		for (n = 1; vp + n < endp && n < maxn
+				&& vp[n].size == size
+				&& vp[n].addr - vp[n - 1].addr == inc
+				&& inc != 0; ++n)
+		{
+			common = common && memcmp(vp[n].data, vp->data, size) == 0;
+		}
+		ads.addr = vp->addr;
+		ads.inc = inc;
+		ads.count = n;
+
+		if (n > 1 && common) {
+			txp = dmp_openpdu(tcxt, (vec << 8) | DMPAD_RANGE_SINGLE, &ads, size);
+			if (txp == NULL) return -1;
+			txp = marshalBytes(txp, vp->data, size);
+		} else {
+			txp = dmp_openpdu(tcxt, (vec << 8) | DMPAD_RANGE_STRUCT, &ads, size * n);
+			if (txp == NULL) return -1;
+			for (rp = vp; rp < vp + n; ++rp)
+				txp = marshalBytes(txp, rp->data, size);
+		}
+		dmp_closepdu(tcxt, txp);
+		++npdus;
+	}
+	LOG_FEND();
+	return npdus;
+}
+
+/**********************************************************************/
+int
+dmp_setprops(struct dmptcxt_s *tcxt, struct dmpval_s *vals, int count)
+{
+	return dmp_txvals(tcxt, DMP_SET_PROPERTY, vals, count);
+}
+
+/**********************************************************************/
+int
+dmp_events(struct dmptcxt_s *tcxt, struct dmpval_s *vals, int count)
+{
+	return dmp_txvals(tcxt, DMP_EVENT, vals, count);
+}
+
+/**********************************************************************/
+/*
+Address bitsets - one bit per address
+*/
+#define EVBITS 32
+#define bitwords(span) (((span) + EVBITS - 1) / EVBITS)
+#define evbit(ofs) ((uint32_t)1 << ((ofs) % EVBITS))
+#define bittst(bits, ofs) (((bits)[(ofs) / EVBITS] & evbit(ofs)) != 0)
+#define bitset(bits, ofs) ((bits)[(ofs) / EVBITS] |= evbit(ofs))
+
+/**********************************************************************/
+#if CF_DMPCOMP_xD && CF_EVLOOP
+/*
+Event publisher
+
+Changes are recorded as bits in pub->dirty, one per address in the 
+window [base, base + span). The first change after a quiet period 
+schedules a flush no sooner than interval_ms after the previous one 
+so any number of changes in between are coalesced and only the latest 
+values are sent.
+*/
+static void evpubAction(struct acnTimer_s *timer);
+
+/**********************************************************************/
+/*
+Collect the current values of all addresses whose bit is set in bits
+into a single allocation holding the dmpval_s array followed by the 
+marshaled data. Returns the array (caller frees) and its length in 
+*countp.
+*/
+static struct dmpval_s *
+getvals(
+	evval_fn *getval,
+	void *ref,
+	uint32_t base,
+	uint32_t span,
+	unsigned int size,
+	const uint32_t *bits,
+	unsigned int nbits,
+	int *countp
+)
+{
+	struct dmpval_s *vals;
+	uint8_t *bp;
+	uint32_t wx;
+	uint32_t ofs;
+	uint32_t word;
+	int n;
+	int sz;
+
+	vals = mallocx(nbits * (sizeof(struct dmpval_s) + size));
+	bp = (uint8_t *)(vals + nbits);
+	n = 0;
+
+	for (wx = 0; wx < bitwords(span); ++wx) {
+		for (word = bits[wx], ofs = wx * EVBITS; word; word >>= 1, ++ofs) {
+			if ((word & 1) == 0) continue;
+			sz = (*getval)(ref, base + ofs, bp);
+			if (sz <= 0) continue;
+			vals[n].addr = base + ofs;
+			vals[n].size = sz;
+			vals[n].data = bp;
+			bp += sz;
+			++n;
+		}
+	}
+	*countp = n;
+	return vals;
+}
+
+/**********************************************************************/
+static inline void
+evmark(struct dmp_evpub_s *pub, uint32_t ofs)
+{
+	if (!bittst(pub->dirty, ofs)) {
+		bitset(pub->dirty, ofs);
+		++pub->ndirty;
+	}
+}
+
+/**********************************************************************/
+static void
+evschedule(struct dmp_evpub_s *pub)
+{
+	uint32_t since;
+
+	if (pub->ndirty == 0 || is_active(&pub->timer)) return;
+	since = (uint32_t)time_in_ms(get_acn_time()) - pub->lastflush;
+	set_timer(&pub->timer, timerval_ms(
+			(since >= pub->interval_ms) ? 0 : pub->interval_ms - since));
+}
+
+/**********************************************************************/
+struct dmp_evpub_s *
+dmp_newevpub(
+	struct dmptcxt_s *tcxt,
+	uint32_t base,
+	uint32_t span,
+	unsigned int size,
+	evval_fn *getval,
+	void *ref,
+	unsigned int interval_ms
+)
+{
+	struct dmp_evpub_s *pub;
+
+	LOG_FSTART();
+	if (tcxt == NULL || span == 0 || getval == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+	pub = mallocxz(sizeof(struct dmp_evpub_s)
+					+ bitwords(span) * sizeof(uint32_t));
+	pub->tcxt = tcxt;
+	pub->base = base;
+	pub->span = span;
+	pub->size = size;
+	pub->getval = getval;
+	pub->ref = ref;
+	pub->interval_ms = interval_ms;
+	/* allow an immediate first flush */
+	pub->lastflush = (uint32_t)time_in_ms(get_acn_time()) - interval_ms;
+	pub->timer.action = evpubAction;
+	pub->timer.userp = pub;
+	LOG_FEND();
+	return pub;
+}
+
+/**********************************************************************/
+void
+dmp_freeevpub(struct dmp_evpub_s *pub)
+{
+	cancel_timer(&pub->timer);
+	free(pub);
+}
+
+/**********************************************************************/
+void
+dmp_evdirty(struct dmp_evpub_s *pub, const struct adspec_s *ads)
+{
+	uint32_t ofs;
+	uint32_t n;
+
+	LOG_FSTART();
+	for (ofs = ads->addr - pub->base, n = ads->count; n--; ofs += ads->inc) {
+		if (ofs < pub->span) evmark(pub, ofs);
+		if (ads->inc == 0) break;
+	}
+	evschedule(pub);
+	LOG_FEND();
+}
+
+/**********************************************************************/
+int
+dmp_evflush(struct dmp_evpub_s *pub)
+{
+	struct dmpval_s *vals;
+	int n;
+	int rslt;
+
+	LOG_FSTART();
+	cancel_timer(&pub->timer);
+	pub->lastflush = (uint32_t)time_in_ms(get_acn_time());
+	if (pub->ndirty == 0) return 0;
+
+	vals = getvals(pub->getval, pub->ref, pub->base, pub->span, pub->size,
+					pub->dirty, pub->ndirty, &n);
+	memset(pub->dirty, 0, bitwords(pub->span) * sizeof(uint32_t));
+	pub->ndirty = 0;
+	rslt = dmp_events(pub->tcxt, vals, n);
+	dmp_flushpdus(pub->tcxt);
+	free(vals);
+	LOG_FEND();
+	return rslt;
+}
+
+/**********************************************************************/
+static void
+evpubAction(struct acnTimer_s *timer)
+{
+	dmp_evflush((struct dmp_evpub_s *)timer->userp);
+}
+
+/**********************************************************************/
+#if CF_DMPON_SDT
+/*
+Subscriber registry
+
+Each registry covers one property (array) and holds a list of groups.
+A group is one local event channel with its own event publisher, 
+and a list of subscribers (remote components which are members of 
+that channel). Each subscriber has a bitset of the addresses it is 
+interested in and the group keeps the union of those.
+
+A new subscriber joins the first group whose interest overlaps its 
+own, so components watching the same properties share a channel and 
+each event is sent once. Only if there is no overlap is a new channel 
+opened. Changes are only marked dirty in groups which have at least 
+one interested member.
+
+Subscribers leave as a result of SDT member events or of unsubscribe 
+messages, both of which arrive in the middle of SDT processing. 
+Dropping members or closing the group channel there would pull 
+structures out from under SDT, so departing subscribers are moved to 
+the group's gone list and a zero delay timer does the work later.
+*/
+struct subscr_s {
+	struct subscr_s *nxt;
+	struct Rcomponent_s *Rcomp;
+	struct member_s *memb;  /* our member in the group channel once connected */
+	uint32_t bits[];
+};
+
+struct subgrp_s {
+	struct subgrp_s *nxt;
+	struct dmp_subreg_s *reg;
+	struct dmptcxt_s tcxt;
+	struct dmp_evpub_s *pub;
+	struct subscr_s *subs;
+	struct subscr_s *gone;  /* waiting for the reaper */
+	struct acnTimer_s reaper;
+	uint32_t interest[];
+};
+
+struct dmp_subreg_s {
+	struct dmp_subreg_s *nxt;
+	const struct dmpprop_s *dprop;
+	evval_fn *getval;
+	void *ref;
+	unsigned int interval_ms;
+	unsigned int nwords;
+	struct subgrp_s *grps;
+};
+
+static struct dmp_subreg_s *subregs = NULL;
+
+#define grpLchan(grp) ((struct Lchannel_s *)(grp)->tcxt.dest)
+
+/**********************************************************************/
+struct dmp_subreg_s *
+dmp_newsubreg(
+	const struct dmpprop_s *dprop,
+	evval_fn *getval,
+	void *ref,
+	unsigned int interval_ms
+)
+{
+	struct dmp_subreg_s *reg;
+
+	if (dprop == NULL || getval == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+	reg = acnNew(struct dmp_subreg_s);
+	reg->dprop = dprop;
+	reg->getval = getval;
+	reg->ref = ref;
+	reg->interval_ms = interval_ms;
+	reg->nwords = bitwords(dprop->span);
+	reg->nxt = subregs;
+	subregs = reg;
+	return reg;
+}
+
+/**********************************************************************/
+static bool
+bitsoverlap(const uint32_t *a, const uint32_t *b, unsigned int nwords)
+{
+	while (nwords--) if (*a++ & *b++) return true;
+	return false;
+}
+
+/**********************************************************************/
+static bool
+bitsempty(const uint32_t *a, unsigned int nwords)
+{
+	while (nwords--) if (*a++) return false;
+	return true;
+}
+
+/**********************************************************************/
+static unsigned int
+bitcount(const uint32_t *a, unsigned int nwords)
+{
+	unsigned int n = 0;
+
+	while (nwords--) n += __builtin_popcount(*a++);
+	return n;
+}
+
+static void grpreap(struct acnTimer_s *timer);
+
+/**********************************************************************/
+static struct subgrp_s *
+newgrp(ifMC(struct Lcomponent_s *Lcomp,) struct dmp_subreg_s *reg)
+{
+	struct subgrp_s *grp;
+	struct Lchannel_s *Lchan;
+
+	Lchan = openChannel(ifMC(Lcomp,) CHF_NOCLOSE, NULL);
+	if (Lchan == NULL) return NULL;
+	grp = mallocxz(sizeof(struct subgrp_s) + reg->nwords * sizeof(uint32_t));
+	grp->reg = reg;
+	grp->tcxt.dest = Lchan;
+	grp->tcxt.wflags = WRAP_ALL_MEMBERS;
+	inittimer(&grp->reaper);
+	grp->reaper.action = &grpreap;
+	grp->reaper.userp = grp;
+	grp->pub = dmp_newevpub(&grp->tcxt, reg->dprop->addr, reg->dprop->span,
+					reg->dprop->size, reg->getval, reg->ref, reg->interval_ms);
+	if (grp->pub == NULL) {
+		closeChannel(Lchan);
+		free(grp);
+		return NULL;
+	}
+	grp->nxt = reg->grps;
+	reg->grps = grp;
+	return grp;
+}
+
+/**********************************************************************/
+static void
+freegrp(struct dmp_subreg_s *reg, struct subgrp_s *grp)
+{
+	struct subgrp_s **grpp;
+	struct subscr_s *sub;
+
+	for (grpp = &reg->grps; *grpp != grp; grpp = &(*grpp)->nxt) {}
+	*grpp = grp->nxt;
+	cancel_timer(&grp->reaper);
+	dmp_freeevpub(grp->pub);
+	while ((sub = grp->subs) != NULL) {
+		grp->subs = sub->nxt;
+		if (sub->memb) drop_member(sub->memb, SDT_REASON_NONSPEC);
+		free(sub);
+	}
+	while ((sub = grp->gone) != NULL) {
+		grp->gone = sub->nxt;
+		free(sub);
+	}
+	closeChannel(grpLchan(grp));
+	free(grp);
+}
+
+/**********************************************************************/
+void
+dmp_freesubreg(struct dmp_subreg_s *reg)
+{
+	struct dmp_subreg_s **regp;
+
+	while (reg->grps) freegrp(reg, reg->grps);
+	for (regp = &subregs; *regp != reg; regp = &(*regp)->nxt) {}
+	*regp = reg->nxt;
+	free(reg);
+}
+
+/**********************************************************************/
+/*
+Recalculate the union of subscriber interests after a reduction.
+*/
+static void
+grpinterest(struct dmp_subreg_s *reg, struct subgrp_s *grp)
+{
+	struct subscr_s *sub;
+	unsigned int i;
+
+	memset(grp->interest, 0, reg->nwords * sizeof(uint32_t));
+	for (sub = grp->subs; sub; sub = sub->nxt) {
+		for (i = 0; i < reg->nwords; ++i) grp->interest[i] |= sub->bits[i];
+	}
+}
+
+/**********************************************************************/
+/*
+Timer action: drop the members of departed subscribers from the group 
+channel unless they have subscribed again since, then close the 
+group if nobody is left.
+*/
+static void
+grpreap(struct acnTimer_s *timer)
+{
+	struct subgrp_s *grp = (struct subgrp_s *)timer->userp;
+	struct subscr_s *sub;
+	struct subscr_s *live;
+	struct member_s *memb;
+
+	LOG_FSTART();
+	if (grp->subs == NULL) {
+		freegrp(grp->reg, grp);
+		LOG_FEND();
+		return;
+	}
+	while ((sub = grp->gone) != NULL) {
+		grp->gone = sub->nxt;
+		for (live = grp->subs; live; live = live->nxt)
+			if (live->Rcomp == sub->Rcomp) break;
+		if (live == NULL
+			&& (memb = findMember(grpLchan(grp), sub->Rcomp)) != NULL)
+		{
+			drop_member(memb, SDT_REASON_NONSPEC);
+		}
+		free(sub);
+	}
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+Queue a departed subscriber for the reaper.
+*/
+static void
+gonesub(struct subgrp_s *grp, struct subscr_s *sub)
+{
+	sub->memb = NULL;
+	sub->nxt = grp->gone;
+	grp->gone = sub;
+	if (!is_active(&grp->reaper)) set_timer(&grp->reaper, timerval_ms(0));
+}
+
+/**********************************************************************/
+/*
+Remove a subscriber. Its member is dropped from the group channel and 
+empty groups are closed later by grpreap().
+*/
+static void
+remsub(struct dmp_subreg_s *reg, struct subgrp_s *grp, struct subscr_s *sub)
+{
+	struct subscr_s **subp;
+
+	for (subp = &grp->subs; *subp != sub; subp = &(*subp)->nxt) {}
+	*subp = sub->nxt;
+	gonesub(grp, sub);
+	grpinterest(reg, grp);
+}
+
+/**********************************************************************/
+static struct subscr_s *
+findsub(
+	struct dmp_subreg_s *reg,
+	struct Rcomponent_s *Rcomp,
+	struct subgrp_s **grpp
+)
+{
+	struct subgrp_s *grp;
+	struct subscr_s *sub;
+
+	for (grp = reg->grps; grp; grp = grp->nxt) {
+		for (sub = grp->subs; sub; sub = sub->nxt) {
+			if (sub->Rcomp == Rcomp) {
+				*grpp = grp;
+				return sub;
+			}
+		}
+	}
+	return NULL;
+}
+
+/**********************************************************************/
+/*
+Send sync events for the addresses in bits to one subscriber only.
+*/
+static void
+syncsub(struct dmp_subreg_s *reg, struct subscr_s *sub, const uint32_t *bits)
+{
+	struct dmptcxt_s tcxt;
+	struct dmpval_s *vals;
+	int n;
+
+	memset(&tcxt, 0, sizeof(tcxt));
+	tcxt.dest = sub->memb;
+	tcxt.wflags = WRAP_REL_ON;
+	vals = getvals(reg->getval, reg->ref, reg->dprop->addr, 
+					reg->dprop->span, reg->dprop->size, bits,
+					bitcount(bits, reg->nwords), &n);
+	dmp_txvals(&tcxt, DMP_SYNC_EVENT, vals, n);
+	dmp_flushpdus(&tcxt);
+	free(vals);
+}
+
+/**********************************************************************/
+/*
+Common code for dmp_rxsubscribe and dmp_rxunsubscribe.
+*/
+static int
+rx_subscription(struct dmprcxt_s *rcxt, bool subscribe)
+{
+	struct dmp_subreg_s *reg;
+	struct member_s *memb;
+	struct subgrp_s *INITIALIZED(grp);
+	struct subscr_s *sub;
+	uint32_t ofs;
+	uint32_t n;
+	int nprops;
+	unsigned int i;
+
+	LOG_FSTART();
+	ofs = rcxt->ads.addr - rcxt->dprop->addr;
+	nprops = rcxt->ads.count;
+	if (rcxt->ads.inc && (ofs + (nprops - 1) * rcxt->ads.inc) >= rcxt->dprop->span)
+		nprops = (rcxt->dprop->span - 1 - ofs) / rcxt->ads.inc + 1;
+
+#if CF_DMP_MULTITRANSPORT
+	if (rcxt->tcp) {
+		/* events go out on SDT group channels so a stream cannot join */
+		if (subscribe) {
+			struct adspec_s ads;
+			uint8_t *txp;
+
+			ads.addr = rcxt->ads.addr;
+			ads.inc = rcxt->ads.inc;
+			ads.count = nprops;
+			txp = dmp_openpdu(&rcxt->rspcxt, PDU_SUBREJ_COMMON, &ads, 1);
+			if (txp) {
+				*txp++ = DMPRC_NOSUBSCRIBE;
+				dmp_closepdu(&rcxt->rspcxt, txp);
+			}
+		}
+		return nprops;
+	}
+#endif
+	memb = (struct member_s *)rcxt->src;
+	for (reg = subregs; reg; reg = reg->nxt) if (reg->dprop == rcxt->dprop) break;
+	if (reg == NULL) {
+		acnlogmark(lgERR, "No subscriber registry for address %u", rcxt->ads.addr);
+		return nprops;
+	}
+	{
+		uint32_t chg[reg->nwords];
+
+		memset(chg, 0, sizeof(chg));
+		for (n = nprops; n--; ofs += rcxt->ads.inc) bitset(chg, ofs);
+
+		sub = findsub(reg, membRcomp(memb), &grp);
+		if (!subscribe) {
+			if (sub == NULL) goto done;
+			for (i = 0; i < reg->nwords; ++i) sub->bits[i] &= ~chg[i];
+			if (bitsempty(sub->bits, reg->nwords)) remsub(reg, grp, sub);
+			else grpinterest(reg, grp);
+		} else if (sub) {
+			for (i = 0; i < reg->nwords; ++i) {
+				chg[i] &= ~sub->bits[i];  /* just the new ones */
+				sub->bits[i] |= chg[i];
+				grp->interest[i] |= chg[i];
+			}
+			if (sub->memb && !bitsempty(chg, reg->nwords))
+				syncsub(reg, sub, chg);
+		} else {
+			for (grp = reg->grps; grp; grp = grp->nxt) {
+				if (bitsoverlap(grp->interest, chg, reg->nwords)) break;
+			}
+			if (grp == NULL
+				&& (grp = newgrp(ifMC(membLcomp(memb),) reg)) == NULL)
+			{
+				acnlogerror(lgERR);
+				goto done;
+			}
+			sub = mallocxz(sizeof(struct subscr_s) 
+							+ reg->nwords * sizeof(uint32_t));
+			sub->Rcomp = membRcomp(memb);
+			memcpy(sub->bits, chg, sizeof(chg));
+			sub->nxt = grp->subs;
+			grp->subs = sub;
+			for (i = 0; i < reg->nwords; ++i) grp->interest[i] |= chg[i];
+			/*
+			sync events are sent when dmp_subconnect() tells us the 
+			member has connected
+			*/
+			if (addMember(grpLchan(grp), sub->Rcomp) < 0) {
+				if (errno == EALREADY) {
+					/* resubscribed before the reaper dropped it */
+					sub->memb = findMember(grpLchan(grp), sub->Rcomp);
+					syncsub(reg, sub, sub->bits);
+				} else {
+					acnlogerror(lgERR);
+					remsub(reg, grp, sub);
+				}
+			}
+		}
+	}
+done:
+	LOG_FEND();
+	return nprops;
+}
+
+/**********************************************************************/
+int
+dmp_rxsubscribe(struct dmprcxt_s *rcxt, const uint8_t *bp)
+{
+	return rx_subscription(rcxt, true);
+}
+
+/**********************************************************************/
+int
+dmp_rxunsubscribe(struct dmprcxt_s *rcxt, const uint8_t *bp)
+{
+	return rx_subscription(rcxt, false);
+}
+
+/**********************************************************************/
+static struct subgrp_s *
+findgrp(struct Lchannel_s *Lchan, struct dmp_subreg_s **regp)
+{
+	struct dmp_subreg_s *reg;
+	struct subgrp_s *grp;
+
+	for (reg = subregs; reg; reg = reg->nxt) {
+		for (grp = reg->grps; grp; grp = grp->nxt) {
+			if (grpLchan(grp) == Lchan) {
+				*regp = reg;
+				return grp;
+			}
+		}
+	}
+	return NULL;
+}
+
+/**********************************************************************/
+bool
+dmp_subconnect(struct Lchannel_s *Lchan, struct member_s *memb)
+{
+	struct dmp_subreg_s *INITIALIZED(reg);
+	struct subgrp_s *grp;
+	struct subscr_s *sub;
+
+	if ((grp = findgrp(Lchan, &reg)) == NULL) return false;
+	for (sub = grp->subs; sub; sub = sub->nxt) {
+		if (sub->Rcomp == membRcomp(memb)) break;
+	}
+	if (sub == NULL) {
+		/* unsubscribed whilst the join was in progress */
+		sub = acnNew(struct subscr_s);
+		sub->Rcomp = membRcomp(memb);
+		gonesub(grp, sub);
+	} else {
+		sub->memb = memb;
+		syncsub(reg, sub, sub->bits);
+	}
+	return true;
+}
+
+/**********************************************************************/
+bool
+dmp_subdisconnect(struct Lchannel_s *Lchan, struct member_s *memb)
+{
+	struct dmp_subreg_s *INITIALIZED(reg);
+	struct subgrp_s *grp;
+	struct subscr_s *sub;
+
+	if ((grp = findgrp(Lchan, &reg)) == NULL) return false;
+	for (sub = grp->subs; sub; sub = sub->nxt) {
+		if (sub->Rcomp == membRcomp(memb)) {
+			remsub(reg, grp, sub);
+			break;
+		}
+	}
+	return true;
+}
+
+/**********************************************************************/
+void
+dmp_subchanged(struct dmp_subreg_s *reg, const struct adspec_s *ads)
+{
+	struct subgrp_s *grp;
+	uint32_t ofs;
+	uint32_t n;
+
+	LOG_FSTART();
+	for (grp = reg->grps; grp; grp = grp->nxt) {
+		for (ofs = ads->addr - reg->dprop->addr, n = ads->count; n--;
+				ofs += ads->inc)
+		{
+			if (ofs < reg->dprop->span && bittst(grp->interest, ofs))
+				evmark(grp->pub, ofs);
+			if (ads->inc == 0) break;
+		}
+		evschedule(grp->pub);
+	}
+	LOG_FEND();
+}
+
+#endif  /* CF_DMPON_SDT */
+#endif  /* CF_DMPCOMP_xD && CF_EVLOOP */
+/**********************************************************************/
 /*
 //macros: vecflags bits
 
@@ -400,28 +1221,696 @@ const uint16_t failrsp[] = {
 };
 #endif
 
-const uint8_t badaccess[] = {
-#if CF_DMPCOMP_xD
-	[DMP_GET_PROPERTY]       = DMPRC_NOREAD,
-	[DMP_SET_PROPERTY]       = DMPRC_NOWRITE,
-#if CF_DMP_NOEVENTS
-	[DMP_SUBSCRIBE]          = DMPRC_NOSUBSCRIBE,
-#else
-	[DMP_SUBSCRIBE]          = DMPRC_NOEVENT,
-#endif
-	[DMP_UNSUBSCRIBE]        = 0,
-#endif
-#if CF_DMPCOMP_Cx
-	[DMP_GET_PROPERTY_REPLY] = 0,
-	[DMP_EVENT]              = 0,
-	[DMP_GET_PROPERTY_FAIL]  = 0,
-	[DMP_SET_PROPERTY_FAIL]  = 0,
-	[DMP_SUBSCRIBE_ACCEPT]   = 0,
-	[DMP_SUBSCRIBE_REJECT]   = 0,
-	[DMP_SYNC_EVENT]         = 0,
-#endif
-};
+const uint8_t badaccess[] = {
+#if CF_DMPCOMP_xD
+	[DMP_GET_PROPERTY]       = DMPRC_NOREAD,
+	[DMP_SET_PROPERTY]       = DMPRC_NOWRITE,
+#if CF_DMP_NOEVENTS
+	[DMP_SUBSCRIBE]          = DMPRC_NOSUBSCRIBE,
+#else
+	[DMP_SUBSCRIBE]          = DMPRC_NOEVENT,
+#endif
+	[DMP_UNSUBSCRIBE]        = 0,
+#endif
+#if CF_DMPCOMP_Cx
+	[DMP_GET_PROPERTY_REPLY] = 0,
+	[DMP_EVENT]              = 0,
+	[DMP_GET_PROPERTY_FAIL]  = 0,
+	[DMP_SET_PROPERTY_FAIL]  = 0,
+	[DMP_SUBSCRIBE_ACCEPT]   = 0,
+	[DMP_SUBSCRIBE_REJECT]   = 0,
+	[DMP_SYNC_EVENT]         = 0,
+#endif
+};
+
+/**********************************************************************/
+#if CF_DMPCOMP_Cx && CF_DMP_RMIRROR
+/*
+Remote property mirror
+*/
+/**********************************************************************/
+struct dmp_mirror_s *
+dmp_newmirror(struct Rcomponent_s *Rcomp)
+{
+	struct dmp_mirror_s *mir;
+	const struct dmpprop_s **plist;
+	unsigned int n;
+	unsigned int i;
+	size_t bsize;
+
+	LOG_FSTART();
+	if (Rcomp->dmp.amap == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if ((plist = amap_proplist(Rcomp->dmp.amap, &n)) == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+	mir = acnNew(struct dmp_mirror_s);
+	mir->amap = Rcomp->dmp.amap;
+	mir->nprops = n;
+	mir->props = mallocx((n ? n : 1) * sizeof(struct mirprop_s));
+	for (bsize = 0, i = 0; i < n; ++i) {
+		const struct dmpdim_s *dp;
+		struct mirprop_s *mp = mir->props + i;
+
+		mp->dprop = plist[i];
+		mp->ofs = bsize;
+		mp->slot = plist[i]->size + ((plist[i]->flags & pflg(vsize)) ? 2 : 0);
+		if (plist[i]->flags & pflg(overlap)) {
+			/* elements share addresses so keep one slot per address */
+			mp->nslots = plist[i]->span;
+		} else {
+			mp->nslots = 1;
+			for (dp = plist[i]->dim; dp < plist[i]->dim + plist[i]->ndims; ++dp)
+				mp->nslots *= dp->cnt;
+		}
+		bsize += (size_t)mp->slot * mp->nslots;
+	}
+	free(plist);
+	mir->buf = mallocxz(bsize ? bsize : 1);
+	mir->bufsize = bsize;
+	if (Rcomp->dmp.mirror) dmp_freemirror(Rcomp);
+	Rcomp->dmp.mirror = mir;
+	LOG_FEND();
+	return mir;
+}
+
+/**********************************************************************/
+void
+dmp_freemirror(struct Rcomponent_s *Rcomp)
+{
+	struct dmp_mirror_s *mir;
+
+	if ((mir = Rcomp->dmp.mirror) == NULL) return;
+	Rcomp->dmp.mirror = NULL;
+	free(mir->buf);
+	free(mir->props);
+	free(mir);
+}
+
+/**********************************************************************/
+/*
+Find the mirror entry for a property (as found in the address map).
+*/
+static struct mirprop_s *
+findmirprop(struct dmp_mirror_s *mir, const struct dmpprop_s *dprop)
+{
+	unsigned int lo, hi, mid;
+
+	lo = 0;
+	hi = mir->nprops;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (mir->props[mid].dprop->addr < dprop->addr) lo = mid + 1;
+		else hi = mid;
+	}
+	/* several properties may share a base address */
+	for (; lo < mir->nprops && mir->props[lo].dprop->addr == dprop->addr; ++lo)
+		if (mir->props[lo].dprop == dprop) return mir->props + lo;
+	return NULL;
+}
+
+/**********************************************************************/
+/*
+Slot number of addr within a property. Array elements are numbered 
+in dimension order so sparse and interleaved arrays are stored 
+densely. Returns UINT32_MAX if addr is not an element of the property.
+*/
+static uint32_t
+mirslot(const struct mirprop_s *mp, uint32_t addr)
+{
+	const struct dmpdim_s *dp;
+	uint32_t a0;
+	uint32_t ix;
+
+	a0 = addr - mp->dprop->addr;
+	if (mp->dprop->flags & pflg(overlap)) ix = a0;
+	else {
+		ix = 0;
+		for (dp = mp->dprop->dim; dp < mp->dprop->dim + mp->dprop->ndims; ++dp) {
+			if (a0 / dp->inc >= dp->cnt) return UINT32_MAX;
+			ix = ix * dp->cnt + a0 / dp->inc;
+			a0 %= dp->inc;
+		}
+		if (a0 != 0) return UINT32_MAX;
+	}
+	return (ix < mp->nslots) ? ix : UINT32_MAX;
+}
+
+/**********************************************************************/
+const uint8_t *
+dmp_mirrorval(struct dmp_mirror_s *mir, uint32_t addr, unsigned int *sizep)
+{
+	const struct dmpprop_s *dprop;
+	struct mirprop_s *mp;
+	uint32_t ix;
+	const uint8_t *vp;
+
+	if ((dprop = addr_to_prop(mir->amap, addr)) == NULL) return NULL;
+	if ((mp = findmirprop(mir, dprop)) == NULL) return NULL;
+	if ((ix = mirslot(mp, addr)) == UINT32_MAX) return NULL;
+	vp = mir->buf + mp->ofs + (size_t)ix * mp->slot;
+	if (mp->dprop->flags & pflg(vsize)) {
+		uint16_t len = unmarshalU16(vp);
+
+		*sizep = (len >= 2) ? len - 2 : 0;
+		return vp + 2;
+	}
+	*sizep = mp->slot;
+	return vp;
+}
+
+/**********************************************************************/
+/*
+Record an address range as dirty, merging with existing ranges where 
+they touch. When the list is full the new range is merged into the 
+nearest one.
+*/
+static void
+mirdirty(struct dmp_mirror_s *mir, uint32_t lo, uint32_t hi)
+{
+	struct dmp_range_s *rp;
+	struct dmp_range_s *best;
+	uint32_t gap;
+	uint32_t bestgap;
+
+	++mir->gen;
+	best = NULL;
+	bestgap = UINT32_MAX;
+	for (rp = mir->dirty; rp < mir->dirty + mir->ndirty; ++rp) {
+		if (lo > rp->hi) gap = lo - rp->hi;
+		else if (rp->lo > hi) gap = rp->lo - hi;
+		else gap = 0;
+		if (gap < bestgap) {
+			bestgap = gap;
+			best = rp;
+		}
+	}
+	if (best == NULL || (bestgap > 1 && mir->ndirty < CF_DMP_MIRRORDIRTY)) {
+		rp = mir->dirty + mir->ndirty++;
+		rp->lo = lo;
+		rp->hi = hi;
+		return;
+	}
+	if (lo < best->lo) best->lo = lo;
+	if (hi > best->hi) best->hi = hi;
+}
+
+/**********************************************************************/
+int
+dmp_mirrorchanges(struct dmp_mirror_s *mir, struct dmp_range_s *ranges, int max)
+{
+	int n;
+
+	n = (mir->ndirty < (unsigned)max) ? (int)mir->ndirty : max;
+	memcpy(ranges, mir->dirty, n * sizeof(struct dmp_range_s));
+	mir->ndirty = 0;
+	return n;
+}
+
+/**********************************************************************/
+/*
+Number of addresses in rcxt->ads which fall within rcxt->dprop.
+*/
+static uint32_t
+adsinprop(const struct dmprcxt_s *rcxt)
+{
+	uint32_t ofs;
+	uint32_t n;
+
+	ofs = rcxt->ads.addr - rcxt->dprop->addr;
+	n = rcxt->ads.count;
+	if (rcxt->ads.inc && (ofs + (n - 1) * rcxt->ads.inc) >= rcxt->dprop->span)
+		n = (rcxt->dprop->span - 1 - ofs) / rcxt->ads.inc + 1;
+	return n;
+}
+
+/**********************************************************************/
+/*
+Copy received values from a get-property reply or event into the 
+mirror. Returns the number of properties consumed, as a receive 
+function would, or -1 if the data runs past the end of the PDU.
+*/
+static int
+rx_mirror(struct dmprcxt_s *rcxt, const uint8_t *dp)
+{
+	struct dmp_mirror_s *mir = rcxt->mirror;
+	struct mirprop_s *mp;
+	const struct dmpprop_s *dprop = rcxt->dprop;
+	uint32_t nprops;
+	uint32_t addr;
+	uint32_t ix;
+	uint32_t n;
+	uint8_t *vp;
+	bool multi;
+
+	nprops = adsinprop(rcxt);
+	if ((mp = findmirprop(mir, dprop)) == NULL) {
+		acnlogmark(lgWARN, "Property %u not mirrored", dprop->addr);
+		return nprops;
+	}
+	multi = IS_MULTIDATA(rcxt->hdr);
+
+	if ((dprop->flags & pflg(vsize)) == 0) {
+		if ((size_t)(rcxt->endp - dp) < (size_t)(multi ? nprops : 1) * mp->slot) {
+			acnlogmark(lgERR, "Short data at %u", rcxt->ads.addr);
+			return -1;
+		}
+		ix = mirslot(mp, rcxt->ads.addr);
+		if (multi && ix != UINT32_MAX && nprops > 1 && mirslot(mp, 
+				rcxt->ads.addr + (nprops - 1) * rcxt->ads.inc) == ix + nprops - 1)
+		{
+			/* the common case - consecutive elements, straight copy */
+			memcpy(mir->buf + mp->ofs + (size_t)ix * mp->slot, dp,
+					(size_t)nprops * mp->slot);
+		} else {
+			for (addr = rcxt->ads.addr, n = nprops; n--; addr += rcxt->ads.inc) {
+				if ((ix = mirslot(mp, addr)) != UINT32_MAX)
+					memcpy(mir->buf + mp->ofs + (size_t)ix * mp->slot, dp, mp->slot);
+				if (multi) dp += mp->slot;
+			}
+		}
+	} else {
+		for (addr = rcxt->ads.addr, n = nprops; n--; addr += rcxt->ads.inc) {
+			uint16_t len;
+
+			if (rcxt->endp - dp < 2
+				|| (len = unmarshalU16(dp)) < 2 || len > rcxt->endp - dp)
+			{
+				acnlogmark(lgERR, "Short data at %u", addr);
+				return -1;
+			}
+			if ((ix = mirslot(mp, addr)) != UINT32_MAX) {
+				vp = mir->buf + mp->ofs + (size_t)ix * mp->slot;
+				if (len > mp->slot) {
+					acnlogmark(lgNTCE, "Value truncated at %u", addr);
+					memcpy(vp, dp, mp->slot);
+					marshalU16(vp, mp->slot);
+				} else {
+					memcpy(vp, dp, len);
+				}
+			}
+			if (multi) dp += len;
+		}
+	}
+	mirdirty(mir, rcxt->ads.addr,
+				rcxt->ads.addr + (nprops - 1) * rcxt->ads.inc);
+	return nprops;
+}
+
+#endif  /* CF_DMPCOMP_Cx && CF_DMP_RMIRROR */
+
+#if CF_DMPCOMP_Cx && CF_DMP_REQTRACK
+/**********************************************************************/
+/*
+Request tracking
+
+Outstanding requests are kept in the order sent so, since all have 
+the same timeout, the head of the list is always the next to expire 
+and one timer serves the whole tracker. The same timer is set to 
+fire immediately when replies free space in the window, so refills 
+triggered by a whole batch of received replies go out together. If 
+a flush fails the refill is retried at the request timeout instead.
+
+Each request records which of its addresses have been answered so 
+duplicate replies are not counted twice.
+
+The completion callback may free the tracker. While callbacks are 
+running dmp_freereqtrk() only detaches it and marks it freed, and 
+reqcomplete() finishes the job once it is safe.
+*/
+#define nowms() ((uint32_t)time_in_ms(get_acn_time()))
+
+/*
+Index of addr within a request, or -1 if the request does not 
+include it.
+*/
+static int64_t
+reqaddrix(const struct adspec_s *ads, uint32_t addr)
+{
+	uint32_t ofs = addr - ads->addr;
+
+	if (ads->count == 1 || ads->inc == 0) return (ofs == 0) ? 0 : -1;
+	if (ofs % ads->inc == 0 && ofs / ads->inc < ads->count)
+		return ofs / ads->inc;
+	return -1;
+}
+
+/**********************************************************************/
+static void
+reqarm(struct dmp_reqtrk_s *trk)
+{
+	int32_t ms = -1;
+	int32_t retry;
+
+	if (trk->sent) {
+		ms = (int32_t)(trk->sent->deadline - nowms());
+		if (ms < 0) ms = 0;
+	}
+	if (trk->pending && trk->nsent < trk->window) {
+		/* refill at once unless the last attempt failed */
+		retry = (trk->flags & RT_STALLED) ? (int32_t)trk->timeout_ms : 0;
+		if (ms < 0 || retry < ms) ms = retry;
+	}
+	if (ms < 0) {
+		cancel_timer(&trk->timer);
+		return;
+	}
+	set_timer(&trk->timer, timerval_ms(ms));
+}
+
+/**********************************************************************/
+/*
+Complete every request with DMPREQ_CANCEL and free the tracker.
+*/
+static void
+reqtrkfree(struct dmp_reqtrk_s *trk)
+{
+	struct dmp_req_s *req;
+	int i;
+
+	for (i = 0; i < 2; ++i) {
+		while ((req = (i ? trk->pending : trk->sent)) != NULL) {
+			if (i) trk->pending = req->nxt;
+			else trk->sent = req->nxt;
+			if (trk->donefn)
+				(*trk->donefn)(trk->Rcomp, &req->ads, DMPREQ_CANCEL, req->ref);
+			free(req);
+		}
+	}
+	free(trk);
+}
+
+/**********************************************************************/
+/*
+Unlink and complete every sent request which has no addresses left 
+and, if expire is set, every one whose deadline has passed. Returns 
+false if the callback freed the tracker (it is gone on return).
+*/
+static bool
+reqcomplete(struct dmp_reqtrk_s *trk, bool expire)
+{
+	struct dmp_req_s **reqp;
+	struct dmp_req_s *req;
+	uint32_t now = nowms();
+	int status;
+
+	trk->flags |= RT_INCALLBACK;
+	for (reqp = &trk->sent; (req = *reqp) != NULL;) {
+		if (req->left == 0) {
+			status = req->status;
+		} else if (expire && (int32_t)(req->deadline - now) <= 0) {
+			status = DMPREQ_TIMEOUT;
+		} else {
+			reqp = &req->nxt;
+			continue;
+		}
+		*reqp = req->nxt;
+		/* the callback may send more so keep the tail valid */
+		if (trk->senttail == &req->nxt) trk->senttail = reqp;
+		--trk->nsent;
+		if (trk->donefn) (*trk->donefn)(trk->Rcomp, &req->ads, status, req->ref);
+		free(req);
+		if (trk->flags & RT_FREED) break;
+	}
+	trk->flags &= ~RT_INCALLBACK;
+	if (trk->flags & RT_FREED) {
+		reqtrkfree(trk);
+		return false;
+	}
+	return true;
+}
+
+/**********************************************************************/
+static void
+reqtimer(struct acnTimer_s *timer)
+{
+	struct dmp_reqtrk_s *trk = (struct dmp_reqtrk_s *)timer->userp;
+
+	LOG_FSTART();
+	if (reqcomplete(trk, true) && dmp_reqflush(trk) <= 0) reqarm(trk);
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+Count off n addresses from rcxt->ads against the outstanding 
+requests. For a get-property fail rcp points to the reason code(s).
+*/
+static void
+rx_reqtrk(struct dmprcxt_s *rcxt, uint32_t n, const uint8_t *rcp)
+{
+	struct dmp_reqtrk_s *trk = rcxt->reqtrk;
+	struct dmp_req_s *req;
+	uint32_t addr;
+	uint32_t i;
+	int64_t ix;
+	bool done = false;
+
+	for (addr = rcxt->ads.addr, i = 0; i < n; ++i, addr += rcxt->ads.inc) {
+		for (req = trk->sent; req != NULL; req = req->nxt) {
+			if (req->left == 0 || (ix = reqaddrix(&req->ads, addr)) < 0
+				|| bittst(req->answered, ix))
+			{
+				continue;  /* not ours or a duplicate reply */
+			}
+			bitset(req->answered, ix);
+			if (rcp && req->status == 0)
+				req->status = IS_MULTIDATA(rcxt->hdr) ? rcp[i] : rcp[0];
+			if (--req->left == 0) done = true;
+			break;
+		}
+	}
+	if (done) {
+		/* a callback may have freed the tracker - stop using it */
+		if (reqcomplete(trk, false)) reqarm(trk);
+		else rcxt->reqtrk = NULL;
+	}
+}
+
+/**********************************************************************/
+/*
+func: dmp_newreqtrk
+*/
+struct dmp_reqtrk_s *
+dmp_newreqtrk(
+	struct Rcomponent_s *Rcomp,
+	struct dmptcxt_s *tcxt,
+	unsigned int window,
+	unsigned int timeout_ms,
+	dmpreq_fn *donefn
+)
+{
+	struct dmp_reqtrk_s *trk;
+
+	LOG_FSTART();
+	if (window == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if ((trk = acnNew(struct dmp_reqtrk_s)) == NULL) return NULL;
+	trk->Rcomp = Rcomp;
+	trk->tcxt = tcxt;
+	trk->donefn = donefn;
+	trk->window = window;
+	trk->timeout_ms = timeout_ms;
+	trk->senttail = &trk->sent;
+	inittimer(&trk->timer);
+	trk->timer.action = &reqtimer;
+	trk->timer.userp = trk;
+	if (Rcomp->dmp.reqtrk) dmp_freereqtrk(Rcomp);
+	Rcomp->dmp.reqtrk = trk;
+	LOG_FEND();
+	return trk;
+}
+
+/**********************************************************************/
+/*
+func: dmp_freereqtrk
+*/
+void
+dmp_freereqtrk(struct Rcomponent_s *Rcomp)
+{
+	struct dmp_reqtrk_s *trk;
+
+	LOG_FSTART();
+	if ((trk = Rcomp->dmp.reqtrk) == NULL) return;
+	Rcomp->dmp.reqtrk = NULL;
+	cancel_timer(&trk->timer);
+	/* called back from reqcomplete() which will free it when done */
+	if (trk->flags & RT_INCALLBACK) trk->flags |= RT_FREED;
+	else reqtrkfree(trk);
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+func: dmp_reqget
+*/
+int
+dmp_reqget(struct dmp_reqtrk_s *trk, const struct adspec_s *ads, void *ref)
+{
+	struct dmp_req_s *req;
+	struct dmp_req_s **reqp;
+
+	LOG_FSTART();
+	if (ads->count == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	req = mallocxz(sizeof(struct dmp_req_s) 
+					+ bitwords(ads->count) * sizeof(uint32_t));
+	if (req == NULL) return -1;
+	req->ads = *ads;
+	if (req->ads.count == 1) req->ads.inc = 0;
+	req->left = ads->count;
+	req->ref = ref;
+	/* keep the queue in address order */
+	for (reqp = &trk->pending; *reqp && (*reqp)->ads.addr <= ads->addr;)
+		reqp = &(*reqp)->nxt;
+	req->nxt = *reqp;
+	*reqp = req;
+	LOG_FEND();
+	return 0;
+}
+
+/**********************************************************************/
+/*
+func: dmp_reqgetall
+*/
+static int
+reqrows(struct dmp_reqtrk_s *trk, const struct dmpprop_s *dprop, int dimx,
+			uint32_t addr, void *ref)
+{
+	const struct dmpdim_s *dp = dprop->dim + dimx;
+	struct adspec_s ads;
+	uint32_t i;
+	int n;
+	int total;
+
+	if (dimx == dprop->ndims - 1) {
+		ads.addr = addr;
+		ads.inc = dp->inc;
+		ads.count = dp->cnt;
+		return (dmp_reqget(trk, &ads, ref) < 0) ? -1 : 1;
+	}
+	for (total = 0, i = 0; i < dp->cnt; ++i, addr += dp->inc) {
+		if ((n = reqrows(trk, dprop, dimx + 1, addr, ref)) < 0) return -1;
+		total += n;
+	}
+	return total;
+}
+
+int
+dmp_reqgetall(struct dmp_reqtrk_s *trk, void *ref)
+{
+	const struct dmpprop_s **plist;
+	const struct dmpprop_s *dprop;
+	struct adspec_s ads;
+	unsigned int np;
+	unsigned int i;
+	int n;
+	int total = 0;
+
+	LOG_FSTART();
+	if (trk->Rcomp->dmp.amap == NULL 
+		|| (plist = amap_proplist(trk->Rcomp->dmp.amap, &np)) == NULL)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	for (i = 0; i < np; ++i) {
+		dprop = plist[i];
+		if (!(dprop->flags & pflg(read))) continue;
+		if (dprop->ndims == 0 || (dprop->flags & pflg(packed))) {
+			ads.addr = dprop->addr;
+			ads.inc = 1;
+			ads.count = dprop->span;
+			n = (dmp_reqget(trk, &ads, ref) < 0) ? -1 : 1;
+		} else {
+			n = reqrows(trk, dprop, 0, dprop->addr, ref);
+		}
+		if (n < 0) {
+			total = -1;
+			break;
+		}
+		total += n;
+	}
+	free(plist);
+	LOG_FEND();
+	return total;
+}
+
+/**********************************************************************/
+/*
+func: dmp_reqflush
+
+Each PDU takes the first queued request and merges following 
+requests which continue the same address sequence.
+*/
+int
+dmp_reqflush(struct dmp_reqtrk_s *trk)
+{
+	struct dmp_req_s *req;
+	struct dmp_req_s *last;
+	struct adspec_s ads;
+	uint32_t next;
+	unsigned int nreq;
+	int nsent = 0;
+	int rslt = 0;
+	uint8_t *dp;
+
+	LOG_FSTART();
+	while (trk->pending && trk->nsent + nsent < trk->window) {
+		req = trk->pending;
+		ads = req->ads;
+		nreq = 1;
+		for (last = req; last->nxt && trk->nsent + nsent + nreq < trk->window;) {
+			const struct adspec_s *nads = &last->nxt->ads;
+
+			if (ads.count == 1) {
+				/* a single address fixes the increment */
+				if (nads->addr <= ads.addr) break;
+				ads.inc = nads->addr - ads.addr;
+			}
+			next = ads.addr + ads.inc * ads.count;
+			if (nads->addr != next || (nads->count > 1 && nads->inc != ads.inc))
+				break;
+			ads.count += nads->count;
+			last = last->nxt;
+			++nreq;
+		}
+		dp = dmp_openpdu(trk->tcxt, DMP_GET_PROPERTY << 8 
+					| ((ads.count == 1) ? DMPAD_SINGLE : DMPAD_RANGE_NODATA), 
+					&ads, 0);
+		if (dp == NULL) {
+			trk->flags |= RT_STALLED;
+			rslt = -1;
+			break;
+		}
+		dmp_closepdu(trk->tcxt, dp);
+		trk->flags &= ~RT_STALLED;
+
+		/* move the requests to the sent list */
+		trk->pending = last->nxt;
+		last->nxt = NULL;
+		*trk->senttail = req;
+		trk->senttail = &last->nxt;
+		for (; req; req = req->nxt) req->deadline = nowms() + trk->timeout_ms;
+		nsent += nreq;
+	}
+	if (nsent > 0) {
+		trk->nsent += nsent;
+		dmp_flushpdus(trk->tcxt);
+		reqarm(trk);
+	}
+	LOG_FEND();
+	return (rslt < 0) ? rslt : nsent;
+}
 
+#endif  /* CF_DMPCOMP_Cx && CF_DMP_REQTRACK */
 /**********************************************************************/
 #if CF_DMPCOMP_Cx
 /*
@@ -436,6 +1925,8 @@ static const uint8_t *
 rx_ctlvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 {
 	const uint8_t *dp;
+	uint32_t count;
+	uint32_t ixs[rcxt->amap->any.maxdims + 1];  /* reused for each property */
 
 	LOG_FSTART();
 
@@ -491,24 +1982,36 @@ rx_ctlvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 	/*
 	We go through the range - no responses allowed for controller vectors
 	*/
-	while (rcxt->ads.count > 0) {
+	for (count = rcxt->ads.count; count > 0; rcxt->ads.count = count) {
 		int32_t nprops;
+		uint32_t run;
+#if CF_DMP_REQTRACK
+		const uint8_t *rcp = dp;  /* reason codes for fails */
+#endif
 
-		rcxt->dprop = addr_to_prop(rcxt->amap, rcxt->ads.addr);
+		rcxt->dprop = addr_to_proprun(rcxt->amap, &rcxt->ads, &run, ixs);
 		if (rcxt->dprop == NULL) {
 			/* property not in map */
 			acnlogmark(lgWARN, "Address %u does not match map", rcxt->ads.addr);
 			if (haspdata(rcxt->vec)) return NULL;  /* lost sync */
 			nprops = 1;
-			if (hasrcdata(rcxt->vec) && (rcxt->ads.count == 1
+			if (hasrcdata(rcxt->vec) && (count == 1
 				|| IS_MULTIDATA(rcxt->hdr)))
 			{
 				++dp;
 			}
 		} else {
+			/* handlers see just the slice within this property */
+			rcxt->ads.count = run;
+			rcxt->ixs = (rcxt->dprop->flags & pflg(overlap)) ? NULL : ixs;
 			/* call the appropriate function */
 			if (haspdata(rcxt->vec)) {
-				nprops = (*rcxt->rxfn)(rcxt, dp);
+				nprops = -1;
+#if CF_DMP_RMIRROR
+				if (rcxt->mirror && (nprops = rx_mirror(rcxt, dp)) < 0)
+					return NULL;  /* short data */
+#endif
+				if (rcxt->rxfn) nprops = (*rcxt->rxfn)(rcxt, dp);
 				if (nprops < 0) return NULL;
 				if (IS_MULTIDATA(rcxt->hdr)) {
 					if (rcxt->dprop->flags & pflg(vsize)) {
@@ -518,23 +2021,33 @@ rx_ctlvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 					} else {
 						dp += nprops * rcxt->dprop->size;
 					}
-				} else if (nprops == rcxt->ads.count) {
+				} else if (nprops == count) {
 					if (rcxt->dprop->flags & pflg(vsize))
 						dp += unmarshalU16(dp);
 					else
 						dp += rcxt->dprop->size;
 				}
 			} else if (hasrcdata(rcxt->vec)) {
-				nprops = (*rcxt->rxfn)(rcxt, dp);
+				/* no handler - just skip the reason codes */
+				nprops = rcxt->rxfn ? (*rcxt->rxfn)(rcxt, dp) : (int32_t)run;
 				if (nprops < 0) return NULL;
 				if (IS_MULTIDATA(rcxt->hdr)) dp += nprops;
-				else if (nprops == rcxt->ads.count) dp += 1;
+				else if (nprops == count) dp += 1;
 			} else {
-				nprops = (*rcxt->rxfn)(rcxt, dp);
+				nprops = rcxt->rxfn ? (*rcxt->rxfn)(rcxt, dp) : (int32_t)run;
 				if (nprops < 0) return NULL;
 			}
 		}
-		rcxt->ads.count -= nprops;
+		rcxt->ixs = NULL;
+#if CF_DMP_REQTRACK
+		if (rcxt->reqtrk) {
+			if (rcxt->vec == DMP_GET_PROPERTY_REPLY)
+				rx_reqtrk(rcxt, nprops, NULL);
+			else if (rcxt->vec == DMP_GET_PROPERTY_FAIL)
+				rx_reqtrk(rcxt, nprops, rcp);
+		}
+#endif
+		count -= nprops;
 		rcxt->ads.addr += nprops * rcxt->ads.inc;
 	}
 	LOG_FEND();
@@ -544,6 +2057,55 @@ rx_ctlvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 
 /**********************************************************************/
 #if CF_DMPCOMP_xD
+/*
+Failure responses
+
+Rather than a separate single address response for every address 
+which fails, consecutive failures with the same reason code are 
+accumulated in a failrun_s and sent as one range address PDU with a 
+common reason. A scan across a sparse address space then produces a 
+handful of responses.
+*/
+struct failrun_s {
+	uint32_t addr;
+	uint32_t count;
+	uint8_t reason;
+};
+
+static void
+flushfails(struct dmprcxt_s *rcxt, struct failrun_s *fr, uint32_t inc)
+{
+	struct adspec_s ads;
+	uint8_t *txp;
+
+	if (fr->count == 0) return;
+	ads.addr = fr->addr;
+	ads.inc = inc;
+	ads.count = fr->count;
+	txp = dmp_openpdu(&rcxt->rspcxt, failrsp[rcxt->vec], &ads, 1);
+	if (txp) {
+		*txp++ = fr->reason;
+		dmp_closepdu(&rcxt->rspcxt, txp);
+	}
+	fr->count = 0;
+}
+
+static void
+addfail(struct dmprcxt_s *rcxt, struct failrun_s *fr,
+			uint32_t addr, uint32_t inc, uint8_t reason)
+{
+	if (failrsp[rcxt->vec] == 0) return;
+	if (fr->count && (fr->reason != reason
+				|| addr != fr->addr + fr->count * inc))
+	{
+		flushfails(rcxt, fr, inc);
+	}
+	if (fr->count++ == 0) {
+		fr->addr = addr;
+		fr->reason = reason;
+	}
+}
+
 /*
 rx_devvec()
 
@@ -555,10 +2117,10 @@ address-range. Address and data (if vector takes data) are at datap.
 static const uint8_t *
 rx_devvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 {
-	uint8_t *txp;
-	struct dmptcxt_s *rspcxt = &rcxt->rspcxt;
+	struct failrun_s fails;
 	uint32_t addr, inc, count;
 	const uint8_t *dp;
+	uint32_t ixs[rcxt->amap->any.maxdims + 1];  /* reused for each property */
 
 	LOG_FSTART();
 
@@ -614,34 +2176,37 @@ rx_devvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 	/*
 	Go through the range - possibly building responses.
 	*/
+	fails.count = 0;
 	while (count > 0) {
 		int32_t nprops;
-
-		rcxt->dprop = addr_to_prop(rcxt->amap, addr);
+		uint32_t run;
+
+		/*
+		Find the property and how many elements of the range fall 
+		within it so the handler gets the whole slice at once.
+		*/
+		rcxt->ads.addr = addr;
+		rcxt->ads.inc = inc;
+		rcxt->ads.count = count;
+#if CF_DMPMAP_GENFN
+		/* our own map - call its generated lookup directly */
+		rcxt->dprop = proprun(addr_map_find(addr), &rcxt->ads, &run, ixs);
+#else
+		rcxt->dprop = addr_to_proprun(rcxt->amap, &rcxt->ads, &run, ixs);
+#endif
 		if (rcxt->dprop == NULL) {
 			/* dproperty not in map */
 			acnlogmark(lgWARN, "Address %u does not match map", addr);
-			if (failrsp[rcxt->vec]) {
-				struct adspec_s ads = {addr,1,1};
-
-				txp = dmp_openpdu(rspcxt, failrsp[rcxt->vec], &ads, 1);
-				*txp++ = DMPRC_NOSUCHPROP;
-				dmp_closepdu(rspcxt, txp);
+			addfail(rcxt, &fails, addr, inc, DMPRC_NOSUCHPROP);
+			if (rcxt->vec == DMP_SET_PROPERTY) {
+				flushfails(rcxt, &fails, inc);
+				return NULL;  /* lost sync */
 			}
-			if (rcxt->vec == DMP_SET_PROPERTY) return NULL;  /* lost sync */
 			nprops = 1;
 		} else if (!canaccess(rcxt->vec, rcxt->dprop)) {
 			acnlogmark(lgNTCE, "Access violation: address %u", addr);
 			/* access error */
-			if (failrsp[rcxt->vec]) {
-				/* FIXME: Should respond with range for all addresses 
-				matching this property */
-				struct adspec_s ads = {addr,1,1};
-
-				txp = dmp_openpdu(rspcxt, failrsp[rcxt->vec], &ads, 1);
-				*txp++ = badaccess[rcxt->vec];
-				dmp_closepdu(rspcxt, txp);
-			}
+			addfail(rcxt, &fails, addr, inc, badaccess[rcxt->vec]);
 			if (rcxt->vec == DMP_SET_PROPERTY && (IS_MULTIDATA(rcxt->hdr)
 				|| count == 1))
 			{
@@ -654,6 +2219,8 @@ rx_devvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 		} else {
 			dmprx_fn * INITIALIZED(rxfn);
 
+			/* keep any responses in address order */
+			flushfails(rcxt, &fails, inc);
 			/* call the appropriate function */
 #if CF_PROPEXT_FNS
 			switch(rcxt->vec) {
@@ -674,10 +2241,10 @@ rx_devvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 #else
 			rxfn = rcxt->rxfn;
 #endif
-			rcxt->ads.addr = addr;
-			rcxt->ads.inc = inc;
-			rcxt->ads.count = count;
+			rcxt->ads.count = run;
+			rcxt->ixs = (rcxt->dprop->flags & pflg(overlap)) ? NULL : ixs;
 			nprops = (*rxfn)(rcxt, dp);
+			rcxt->ixs = NULL;
 			if (nprops < 0) return NULL;
 			if (rcxt->vec == DMP_SET_PROPERTY) {
 				int i;
@@ -694,25 +2261,30 @@ rx_devvec(struct dmprcxt_s *rcxt, const uint8_t *datap)
 		count -= nprops;
 		addr += nprops * inc;
 	}
+	flushfails(rcxt, &fails, inc);
 	LOG_FEND();
 	return dp;
 }
 
 #endif  /* CF_DMPCOMP_xD */
 /**********************************************************************/
-#if CF_DMPON_SDT
-void
-dmp_sdtRx(struct member_s *memb, const uint8_t *pdus, int blocksize, void *ref)
+/*
+rx_block()
+
+Parse and handle a received block of DMP PDUs. The caller has set 
+up the source and any response context in rcxt.
+*/
+#if CF_DMPON_SDT || CF_DMPON_TCP
+static void
+rx_block(struct dmprcxt_s *rcxt, struct Lcomponent_s *Lcomp,
+			struct Rcomponent_s *Rcomp, const uint8_t *pdus, int blocksize)
 {
-	uint8_t INITIALIZED(header);
 	const uint8_t *datap = NULL;  /* avoid initialization warning */
 	int INITIALIZED(datasize);
 	const uint8_t *pdup;
 	const uint8_t *pp;
 	const uint8_t *endp;
 	uint8_t flags;
-	uint8_t INITIALIZED(cmd);
-	struct dmprcxt_s rcxt;
 
 	LOG_FSTART();
 	if (blocksize < DMP_BLOCK_MIN) {
@@ -726,29 +2298,22 @@ dmp_sdtRx(struct member_s *memb, const uint8_t *pdus, int blocksize, void *ref)
 		return;
 	}
 
-	memset(&rcxt, 0, sizeof(rcxt));
-	rcxt.src = memb;
-#if CF_DMPCOMP_xD
-	rcxt.rspcxt.dest = memb;
-	rcxt.rspcxt.wflags = WRAP_REL_ON | WRAP_REPLY;
-#endif
-
 	for (pdup = pdus; pdup < pdus + blocksize - 2;)
 	{
 		flags = *pdup;
 		pp = pdup + 2;
 		pdup += getpdulen(pdup);   /* point to next PDU or end of block */
 
-		if (flags & VECTOR_bFLAG) rcxt.vec = *pp++;
-		if (flags & HEADER_bFLAG) rcxt.hdr = *pp++;
+		if (flags & VECTOR_bFLAG) rcxt->vec = *pp++;
+		if (flags & HEADER_bFLAG) rcxt->hdr = *pp++;
 
 		if (
-				rcxt.vec > DMP_MAX_VECTOR 
-			|| vecflags[rcxt.vec] == 0
-			|| ((vecflags[rcxt.vec] & (rcdata | propdata)) == 0
-					&& IS_MULTIDATA(rcxt.hdr))
+				rcxt->vec > DMP_MAX_VECTOR 
+			|| vecflags[rcxt->vec] == 0
+			|| ((vecflags[rcxt->vec] & (rcdata | propdata)) == 0
+					&& IS_MULTIDATA(rcxt->hdr))
 		) {
-			acnlogmark(lgERR, "Bad DMP message %u or rcxt.hdr %02x", rcxt.vec, rcxt.hdr);
+			acnlogmark(lgERR, "Bad DMP message %u or rcxt->hdr %02x", rcxt->vec, rcxt->hdr);
 			continue;
 		}
 
@@ -758,46 +2323,55 @@ dmp_sdtRx(struct member_s *memb, const uint8_t *pdus, int blocksize, void *ref)
 		} else {
 			pp = datap;
 		}
+		rcxt->endp = pp + datasize;
 
-		rcxt.rxfn = membLcomp(memb)->dmp.rxvec[rcxt.vec];
-		assert(rcxt.rxfn != NULL);
+		rcxt->rxfn = Lcomp->dmp.rxvec[rcxt->vec];
+		/*
+		rx_ctlvec() copes with a missing receive function so only 
+		commands to a device must have one
+		*/
+#if CF_DMPCOMP_CD
+		assert(rcxt->rxfn != NULL || (vecflags[rcxt->vec] & ctltodev) == 0);
+#elif CF_DMPCOMP__D
+		assert(rcxt->rxfn != NULL);
+#endif
 
 #if CF_DMPCOMP_CD
-		if (vecflags[rcxt.vec] & ctltodev) {
-			rcxt.amap = membLcomp(memb)->dmp.amap;
+		if (vecflags[rcxt->vec] & ctltodev) {
+			rcxt->amap = Lcomp->dmp.amap;
 			/*
-			All commands have similar format based on rcxt.hdr and only 
+			All commands have similar format based on rcxt->hdr and only 
 			differ in the number of data items for each address, so work 
 			through addresses calling appropriate function.
 			*/
 			for (endp = pp + datasize; pp < endp; ) {
-				pp = rx_devvec(&rcxt, pp);
+				pp = rx_devvec(rcxt, pp);
 				if (pp == NULL) break;	/* serious error */
 			}
 		} else {
-			rcxt.amap = membRcomp(memb)->dmp.amap;
+			rcxt->amap = Rcomp->dmp.amap;
 			for (endp = pp + datasize; pp < endp; ) {
-				pp = rx_ctlvec(&rcxt, pp);
+				pp = rx_ctlvec(rcxt, pp);
 				if (pp == NULL) break;	/* serious error */
 			}
 		}
 #elif CF_DMPCOMP__D
-		rcxt.amap = membLcomp(memb)->dmp.amap;
+		rcxt->amap = Lcomp->dmp.amap;
 		for (endp = pp + datasize; pp < endp; ) {
-			pp = rx_devvec(&rcxt, pp);
+			pp = rx_devvec(rcxt, pp);
 			if (pp == NULL) break;	/* serious error */
 		}
 #else  /* must be CF_DMPCOMP_C_ */
-		rcxt.amap = membRcomp(memb)->dmp.amap;
+		rcxt->amap = Rcomp->dmp.amap;
 		for (endp = pp + datasize; pp < endp; ) {
-			pp = rx_ctlvec(&rcxt, pp);
+			pp = rx_ctlvec(rcxt, pp);
 			if (pp == NULL) break;	/* serious error */
 		}
 #endif  /* CF_DMPCOMP_C_ */
 	}
 #if CF_DMPCOMP_xD
 	/* If processing has created PDUs to transmit then flush them */
-	dmp_flushpdus(&rcxt.rspcxt);
+	dmp_flushpdus(&rcxt->rspcxt);
 #endif
 
 	if (pdup != pdus + blocksize)  { /* sanity check */
@@ -805,5 +2379,437 @@ dmp_sdtRx(struct member_s *memb, const uint8_t *pdus, int blocksize, void *ref)
 	}
 	LOG_FEND();
 }
+#endif  /* CF_DMPON_SDT || CF_DMPON_TCP */
+
+/**********************************************************************/
+#if CF_DMPON_SDT
+void
+dmp_sdtRx(struct member_s *memb, const uint8_t *pdus, int blocksize, void *ref)
+{
+	struct dmprcxt_s rcxt;
+
+	LOG_FSTART();
+	memset(&rcxt, 0, sizeof(rcxt));
+	rcxt.src = memb;
+#if CF_DMPCOMP_Cx && CF_DMP_RMIRROR
+	rcxt.mirror = membRcomp(memb)->dmp.mirror;
+#endif
+#if CF_DMPCOMP_Cx && CF_DMP_REQTRACK
+	rcxt.reqtrk = membRcomp(memb)->dmp.reqtrk;
+#endif
+#if CF_DMPCOMP_xD
+	rcxt.rspcxt.dest = memb;
+	rcxt.rspcxt.wflags = WRAP_REL_ON | WRAP_REPLY;
+#endif
+	rx_block(&rcxt, membLcomp(memb), membRcomp(memb), pdus, blocksize);
+	LOG_FEND();
+}
 
 #endif  /* CF_DMPON_SDT */
+
+#if CF_DMPON_TCP
+/**********************************************************************/
+/*
+Stream transport
+
+Each connection keeps a queue of closed blocks waiting to be written 
+and a free list of spare blocks. A transmit context holds the block 
+it is filling in txblk, which may accumulate several DMP blocks 
+(each starting with a PDU with all fields present) until it is full 
+or flushed. Flushing queues the block and enables EPOLLOUT so the 
+whole queue is written by a single writev() from the event loop.
+*/
+#define TCP_HDRLEN 4
+
+enum tcpflg_e {
+	TCPF_INRX = 1,   /* processing received data */
+	TCPF_CLOSE = 2,  /* close requested from a receive handler */
+};
+
+#if CF_MULTI_COMPONENT
+#define cxnLcomp(cxn) ((cxn)->Lcomp)
+#else
+#define cxnLcomp(cxn) (&localComponent)
+#endif
+
+/**********************************************************************/
+static struct dmp_tcpblk_s *
+tcp_getblk(struct dmp_tcpcxn_s *cxn)
+{
+	struct dmp_tcpblk_s *blk;
+
+	if ((blk = cxn->freeblks) != NULL) cxn->freeblks = blk->nxt;
+	else if ((blk = mallocx(sizeof(struct dmp_tcpblk_s))) == NULL) return NULL;
+	blk->nxt = NULL;
+	blk->len = TCP_HDRLEN;
+	return blk;
+}
+
+#define tcp_putblk(cxn, blk) ((blk)->nxt = (cxn)->freeblks, (cxn)->freeblks = (blk))
+
+/**********************************************************************/
+static void
+tcp_wantwrite(struct dmp_tcpcxn_s *cxn, bool want)
+{
+	uint32_t events;
+
+	events = want ? (cxn->events | EPOLLOUT) : (cxn->events & ~EPOLLOUT);
+	if (events == cxn->events) return;
+	if (evl_modify(cxn->fd, &cxn->pollfn, events) < 0) {
+		acnlogerror(lgERR);
+		return;
+	}
+	cxn->events = events;
+}
+
+/**********************************************************************/
+/*
+Add a filled block to the transmit queue.
+*/
+static void
+tcp_queue(struct dmp_tcpcxn_s *cxn, struct dmp_tcpblk_s *blk)
+{
+	marshalU32(blk->data, blk->len - TCP_HDRLEN);
+	blk->nxt = NULL;
+	*cxn->txqtail = blk;
+	cxn->txqtail = &blk->nxt;
+	++cxn->nq;
+	tcp_wantwrite(cxn, true);
+}
+
+/**********************************************************************/
+static int
+tcp_newblock(struct dmptcxt_s *tcxt, int *size)
+{
+	struct dmp_tcpcxn_s *cxn = tcxt->dest;
+	struct dmp_tcpblk_s *blk;
+
+	if (*size > CF_DMPTCP_BLOCKSIZE - TCP_HDRLEN) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+	blk = tcxt->txblk;
+	if (blk && CF_DMPTCP_BLOCKSIZE - blk->len < (unsigned int)*size) {
+		/* no room - send what we have */
+		tcp_queue(cxn, blk);
+		tcxt->txblk = blk = NULL;
+	}
+	if (blk == NULL) {
+		if (cxn->nq >= CF_DMPTCP_MAXQUEUE) {
+			errno = ENOBUFS;
+			return -1;
+		}
+		if ((blk = tcp_getblk(cxn)) == NULL) return -1;
+		tcxt->txblk = blk;
+	}
+	tcxt->pdup = blk->data + blk->len;
+	tcxt->endp = blk->data + CF_DMPTCP_BLOCKSIZE;
+	*size = tcxt->endp - tcxt->pdup;
+	return 0;
+}
+
+/**********************************************************************/
+static void
+tcp_flush(struct dmptcxt_s *tcxt)
+{
+	struct dmp_tcpblk_s *blk;
+
+	if ((blk = tcxt->txblk) == NULL) return;
+	tcxt->txblk = NULL;
+	if (blk->len > TCP_HDRLEN) tcp_queue(tcxt->dest, blk);
+	else tcp_putblk((struct dmp_tcpcxn_s *)tcxt->dest, blk);
+}
+
+/**********************************************************************/
+/*
+Write as much of the queue as the socket will take. Returns -1 on a 
+fatal error.
+*/
+static int
+tcp_write(struct dmp_tcpcxn_s *cxn)
+{
+	struct iovec iov[CF_DMPTCP_MAXIOV];
+	struct dmp_tcpblk_s *blk;
+	ssize_t total;
+	ssize_t rslt;
+	bool partial;
+	int n;
+
+	LOG_FSTART();
+	while (cxn->txq) {
+		total = 0;
+		for (n = 0, blk = cxn->txq; blk && n < CF_DMPTCP_MAXIOV; blk = blk->nxt, ++n) {
+			iov[n].iov_base = blk->data;
+			iov[n].iov_len = blk->len;
+			total += blk->len;
+		}
+		iov[0].iov_base = cxn->txq->data + cxn->txofs;
+		iov[0].iov_len -= cxn->txofs;
+		total -= cxn->txofs;
+
+		if ((rslt = writev(cxn->fd, iov, n)) < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			acnlogerror(lgERR);
+			return -1;
+		}
+		acnlogmark(lgDBUG, "writev %d blocks, %d bytes", n, (int)rslt);
+		partial = (rslt < total);
+		/* release the blocks we have finished */
+		rslt += cxn->txofs;
+		while ((blk = cxn->txq) != NULL && rslt >= blk->len) {
+			rslt -= blk->len;
+			cxn->txq = blk->nxt;
+			--cxn->nq;
+			tcp_putblk(cxn, blk);
+		}
+		cxn->txofs = rslt;
+		if (partial) break;  /* socket is full */
+	}
+	if (cxn->txq == NULL) {
+		cxn->txqtail = &cxn->txq;
+		tcp_wantwrite(cxn, false);
+	}
+	LOG_FEND();
+	return 0;
+}
+
+/**********************************************************************/
+/*
+Read what is available and handle all complete blocks. Returns -1 if 
+the connection should be closed.
+*/
+static int
+tcp_read(struct dmp_tcpcxn_s *cxn)
+{
+	ssize_t rslt;
+	uint8_t *bp;
+	uint8_t *endp;
+	uint32_t len;
+	struct dmprcxt_s rcxt;
+	int err = 0;
+
+	LOG_FSTART();
+	rslt = read(cxn->fd, cxn->rxbuf + cxn->rxlen, sizeof(cxn->rxbuf) - cxn->rxlen);
+	if (rslt < 0) {
+		if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+		acnlogerror(lgERR);
+		return -1;
+	}
+	if (rslt == 0) {
+		acnlogmark(lgINFO, "Stream closed by remote");
+		return -1;
+	}
+	cxn->rxlen += rslt;
+
+	cxn->flags |= TCPF_INRX;
+	endp = cxn->rxbuf + cxn->rxlen;
+	for (bp = cxn->rxbuf; endp - bp >= TCP_HDRLEN; bp += TCP_HDRLEN + len) {
+		len = unmarshalU32(bp);
+		if (len > CF_DMPTCP_BLOCKSIZE - TCP_HDRLEN) {
+			acnlogmark(lgERR, "Rx stream block too long (%u)", len);
+			err = -1;
+			break;
+		}
+		if ((uint32_t)(endp - bp) < TCP_HDRLEN + len) break;  /* incomplete */
+
+		memset(&rcxt, 0, sizeof(rcxt));
+		rcxt.src = cxn;
+#if CF_DMP_MULTITRANSPORT
+		rcxt.tcp = 1;
+#endif
+#if CF_DMPCOMP_Cx && CF_DMP_RMIRROR
+		rcxt.mirror = cxn->Rcomp->dmp.mirror;
+#endif
+#if CF_DMPCOMP_Cx && CF_DMP_REQTRACK
+		rcxt.reqtrk = cxn->Rcomp->dmp.reqtrk;
+#endif
+#if CF_DMPCOMP_xD
+		dmp_tcptcxt(&rcxt.rspcxt, cxn);
+#endif
+		rx_block(&rcxt, cxnLcomp(cxn), cxn->Rcomp, bp + TCP_HDRLEN, len);
+		if (cxn->flags & TCPF_CLOSE) break;
+	}
+	cxn->flags &= ~TCPF_INRX;
+	if (err < 0 || (cxn->flags & TCPF_CLOSE)) return -1;
+
+	/* keep any partial block for next time */
+	cxn->rxlen = endp - bp;
+	if (cxn->rxlen && bp > cxn->rxbuf) memmove(cxn->rxbuf, bp, cxn->rxlen);
+	LOG_FEND();
+	return 0;
+}
+
+/**********************************************************************/
+static void
+tcp_free(struct dmp_tcpcxn_s *cxn)
+{
+	struct dmp_tcpblk_s *blk;
+	struct dmp_Rcomp_s *rdmp;
+	unsigned int i;
+
+	LOG_FSTART();
+	evl_register(cxn->fd, NULL, 0);
+	close(cxn->fd);
+	rdmp = &cxn->Rcomp->dmp;
+	for (i = 0; i < rdmp->ncxns; ++i) {
+		if (rdmp->cxns[i] == cxn) {
+			rdmp->cxns[i] = rdmp->cxns[--rdmp->ncxns];
+			break;
+		}
+	}
+	while ((blk = cxn->txq) != NULL) {
+		cxn->txq = blk->nxt;
+		free(blk);
+	}
+	while ((blk = cxn->freeblks) != NULL) {
+		cxn->freeblks = blk->nxt;
+		free(blk);
+	}
+	free(cxn);
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+Event loop callback
+*/
+static void
+tcp_poll(uint32_t evf, void *evptr)
+{
+	struct dmp_tcpcxn_s *cxn = (struct dmp_tcpcxn_s *)evptr;
+
+	LOG_FSTART();
+	/* on hangup keep reading until we get end of file */
+	if (((evf & EPOLLIN) && tcp_read(cxn) < 0)
+		|| ((evf & EPOLLOUT) && tcp_write(cxn) < 0)
+		|| (evf & EPOLLERR)
+		|| ((evf & EPOLLHUP) && !(evf & EPOLLIN)))
+	{
+		if (cxn->flags & TCPF_CLOSE) tcp_write(cxn);  /* local close */
+		else if (cxn->closefn) (*cxn->closefn)(cxn, cxn->ref);
+		tcp_free(cxn);
+	}
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+func: dmp_tcpopen
+*/
+struct dmp_tcpcxn_s *
+dmp_tcpopen(
+	ifMC(struct Lcomponent_s *Lcomp,)
+	struct Rcomponent_s *Rcomp,
+	int fd,
+	dmptcp_close_fn *closefn,
+	void *ref
+)
+{
+	struct dmp_tcpcxn_s *cxn;
+	int flags;
+	int one = 1;
+
+	LOG_FSTART();
+	if (Rcomp->dmp.ncxns >= CF_DMP_RMAXCXNS) {
+		acnlogmark(lgERR, "Too many connections to component");
+		errno = EMFILE;
+		return NULL;
+	}
+	if ((flags = fcntl(fd, F_GETFL)) < 0 
+		|| fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+	{
+		acnlogerror(lgERR);
+		return NULL;
+	}
+	/* we do our own batching - fails harmlessly on Unix sockets */
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	if ((cxn = acnNew(struct dmp_tcpcxn_s)) == NULL) return NULL;
+	cxn->pollfn = &tcp_poll;
+	cxn->fd = fd;
+	cxn->events = EPOLLIN;
+#if CF_MULTI_COMPONENT
+	cxn->Lcomp = Lcomp;
+#endif
+	cxn->Rcomp = Rcomp;
+	cxn->closefn = closefn;
+	cxn->ref = ref;
+	cxn->txqtail = &cxn->txq;
+
+	if (evl_register(fd, &cxn->pollfn, cxn->events) < 0) {
+		acnlogerror(lgERR);
+		free(cxn);
+		return NULL;
+	}
+	Rcomp->dmp.cxns[Rcomp->dmp.ncxns++] = cxn;
+	LOG_FEND();
+	return cxn;
+}
+
+/**********************************************************************/
+/*
+func: dmp_tcpconnect
+*/
+struct dmp_tcpcxn_s *
+dmp_tcpconnect(
+	ifMC(struct Lcomponent_s *Lcomp,)
+	struct Rcomponent_s *Rcomp,
+	const struct sockaddr *addr,
+	socklen_t addrlen,
+	dmptcp_close_fn *closefn,
+	void *ref
+)
+{
+	struct dmp_tcpcxn_s *cxn;
+	int fd;
+
+	LOG_FSTART();
+	if ((fd = socket(addr->sa_family, SOCK_STREAM, 0)) < 0) {
+		acnlogerror(lgERR);
+		return NULL;
+	}
+	if (connect(fd, addr, addrlen) < 0) {
+		acnlogerror(lgERR);
+		close(fd);
+		return NULL;
+	}
+	if ((cxn = dmp_tcpopen(ifMC(Lcomp,) Rcomp, fd, closefn, ref)) == NULL)
+		close(fd);
+	LOG_FEND();
+	return cxn;
+}
+
+/**********************************************************************/
+/*
+func: dmp_tcpclose
+*/
+void
+dmp_tcpclose(struct dmp_tcpcxn_s *cxn)
+{
+	LOG_FSTART();
+	if (cxn->flags & TCPF_INRX) {
+		/* tcp_read will free it when the handler returns */
+		cxn->flags |= TCPF_CLOSE;
+		return;
+	}
+	tcp_write(cxn);
+	tcp_free(cxn);
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+func: dmp_tcptcxt
+*/
+void
+dmp_tcptcxt(struct dmptcxt_s *tcxt, struct dmp_tcpcxn_s *cxn)
+{
+	memset(tcxt, 0, sizeof(*tcxt));
+	tcxt->dest = cxn;
+#if CF_DMP_MULTITRANSPORT
+	tcxt->tcp = 1;
+#endif
+}
+
+#endif  /* CF_DMPON_TCP */
@@ -168,11 +168,15 @@ dimmatch(const struct dmpdim_s *dp, int ndims, uint32_t a0, uint32_t maxad, uint
 		return true;
 	} else if (ndims > 1) {
 		uint32_t b;
-		int x;
+		uint32_t x;
 
 		maxad -= *t;  /* maxad is maximum offset due to smaller dimensions */
 		if (maxad >= a0) b = 0;
-		else b = a0 - a0 % dp->inc - maxad;
+		else {
+			/* lowest multiple of inc which smaller dimensions can reach */
+			b = a0 - maxad;
+			b += (dp->inc - b % dp->inc) % dp->inc;
+		}
 		for (x = b; x <= *t; x += dp->inc) {
 		   if (dimmatch(dp + 1, ndims - 1, a0 - x, maxad, t + 1)) {
 				LOG_FEND();
@@ -198,17 +202,17 @@ dimmatch(const struct dmpdim_s *dp, int ndims, uint32_t a0, uint32_t maxad, uint
 /*
 func: propmatch
 
-Test whether an address matches a property.
+Test whether an address matches a property. Lookup functions generated 
+by mapgen do the arithmetic for most properties inline and only call 
+this for self-overlapping arrays.
 */
-static bool
+bool
 propmatch(const struct dmpprop_s *p, uint32_t addr)
 {
 	uint32_t maxad;
 	uint32_t a0;
 	uint32_t x;
 	const struct dmpdim_s *dp;
-	uint32_t *ip;
-	uint32_t t[p->ndims];
 
 	LOG_FSTART();
 	a0 = addr - p->addr;
@@ -226,6 +230,10 @@ propmatch(const struct dmpprop_s *p, uint32_t addr)
 		return false;
 	}
 	/* worst case - we have a self-overlapping array */
+	{
+	uint32_t *ip;
+	uint32_t t[p->ndims];
+
 	maxad = 0;
 	if (p->ndims > 1) {
 		for (dp = p->dim + p->ndims, ip = t + p->ndims; --dp >= p->dim;) {
@@ -239,6 +247,7 @@ propmatch(const struct dmpprop_s *p, uint32_t addr)
 	acnlogmark(lgDBUG, "maxad %u", maxad);
 	LOG_FEND();
 	return dimmatch(p->dim, p->ndims, a0, maxad, t);
+	}
 }
 
 /**********************************************************************/
@@ -259,16 +268,13 @@ to a single sparse array, further testing is needed to confirm whether
 the address is a hit and if so to which property.
 */
 static struct addrfind_s *
-addr_to_map(union addrmap_u *amap, uint32_t addr)
+findregion(struct addrfind_s *alo, int span, uint32_t addr)
 {
-	struct addrfind_s *af, *alo;
-	int span;
+	struct addrfind_s *af;
 
 	LOG_FSTART();
 	/* search the map for our insertion point */
 	//acnlogmark(lgDBUG, "Search map for address %u", addr);
-	alo = amap->srch.map;
-	span = amap->srch.count;
 	while (span ) {
 		af = alo + span / 2;
 		//acnlogmark(lgDBUG, "trying %u..%u", af->adlo, af->adhi);
@@ -286,6 +292,44 @@ addr_to_map(union addrmap_u *amap, uint32_t addr)
 	return NULL;
 }
 
+#define addr_to_map(amap, addr) \
+		findregion((amap)->srch.map, (amap)->srch.count, (addr))
+
+/**********************************************************************/
+/*
+Apply any tests needed to find which property within a search region 
+an address actually matches. If the region has a hit table this is a 
+single lookup.
+*/
+static const struct dmpprop_s *
+region_to_prop(const struct addrfind_s *af, uint32_t addr)
+{
+	const struct dmpprop_s *prop;
+
+	if (af->hits) {
+		int hit = af->hits[addr - af->adlo];
+
+		if (hit == 0) return NULL;
+		return (af->ntests > 1) ? af->p.pa[hit - 1] : af->p.prop;
+	}
+	switch (af->ntests) {
+	case 0:
+		return af->p.prop;
+	case 1:
+		prop = af->p.prop;
+		return propmatch(prop, addr) ? prop : NULL;
+	default: {
+		struct dmpprop_s **pa;
+		int i;
+
+		pa = af->p.pa;
+		for (i = 0; i < af->ntests; ++i) {
+			if (propmatch(pa[i], addr)) return pa[i];
+		}
+		return NULL;
+	}}
+}
+
 /**********************************************************************/
 /*
 func: addr_to_prop
@@ -323,29 +367,133 @@ addr_to_prop(union addrmap_u *amap, uint32_t addr)
 
 		//acnlogmark(lgDBUG, "Binary search map");
 		if ((af = addr_to_map(amap, addr)) == NULL) return NULL;
-		switch (af->ntests) {
-		case 0:
-			return af->p.prop;
-		case 1:
-			prop = af->p.prop;
-			return propmatch(prop, addr) ? prop : NULL;
-		default: {
-			struct dmpprop_s **pa;
-			int i;
+		return region_to_prop(af, addr);
+	}
+	case am_hybrid: {
+		uint32_t ofs;
+		struct hpage_s *pg;
+		struct addrfind_s *af;
 
-			pa = af->p.pa;
-			for (i = 0; i < af->ntests; ++i) {
-				if (propmatch(pa[i], addr)) return pa[i];
-			}
+		ofs = addr - amap->hybr.base;
+		if ((ofs >> CF_DMPMAP_PAGEBITS) >= amap->hybr.npages) return NULL;
+		pg = amap->hybr.map + (ofs >> CF_DMPMAP_PAGEBITS);
+		switch (pg->type) {
+		case hp_indx:
+			return pg->p.pa[ofs & HPAGE_MASK];
+		case hp_prop:
+			/* a property with no holes */
+			prop = pg->p.prop;
+			return (addr - prop->addr < prop->span) ? prop : NULL;
+		case hp_srch:
+			if ((af = findregion(pg->p.af, pg->count, addr)) == NULL)
+				return NULL;
+			return region_to_prop(af, addr);
+		default:
 			return NULL;
-		}}
+		}
 	}
+	case am_func:
+		return (*amap->func.fn)(addr);
 	default:
 		acnlogmark(lgERR, "Unrecognized address map type %d", amap->any.type);
 		return NULL;
 	}
 	LOG_FEND();
 }
+/**********************************************************************/
+#if CF_DMP
+/*
+func: addr_to_proprun
+
+Find the property matching the first address of a range together 
+with the number of consecutive elements of the range which fall within 
+that same property. Receive code can then hand a whole slice to the 
+application with one lookup instead of one per address.
+
+If indexes is not NULL it must have room for the map's maxdims 
+entries and is filled with the array indexes of the first address in 
+tree order (see <dmpdim_s>). Self-overlapping arrays have no unique 
+decomposition so for these indexes are not filled and the run length 
+is always 1.
+
+Returns the property or NULL if the first address is not in the map. 
+The run length is returned in *countp (1 if not found).
+*/
+const struct dmpprop_s *
+addr_to_proprun(
+	union addrmap_u *amap,
+	const struct adspec_s *ads,
+	uint32_t *countp,
+	uint32_t *indexes
+)
+{
+	return proprun(addr_to_prop(amap, ads->addr), ads, countp, indexes);
+}
+
+/**********************************************************************/
+/*
+func: proprun
+
+The second half of <addr_to_proprun()>: given the property already 
+found for the first address of a range (or NULL), work out the run 
+length and indexes. Devices built with <CF_DMPMAP_GENFN> find the 
+property with their generated lookup function and call this directly.
+*/
+const struct dmpprop_s *
+proprun(
+	const struct dmpprop_s *prop,
+	const struct adspec_s *ads,
+	uint32_t *countp,
+	uint32_t *indexes
+)
+{
+	const struct dmpdim_s *dp;
+	uint32_t a0;
+	uint32_t ix;
+	uint32_t n;
+
+	LOG_FSTART();
+	*countp = 1;
+	if (prop == NULL) return NULL;
+	if (prop->ndims == 0 || (prop->flags & pflg(overlap))) {
+		if (ads->inc == 0) *countp = ads->count;
+		return prop;
+	}
+	a0 = ads->addr - prop->addr;
+	if (ads->inc == 0) {
+		n = ads->count;
+	} else if (prop->flags & pflg(packed)) {
+		/* every address in the span belongs to us */
+		n = (prop->span - 1 - a0) / ads->inc + 1;
+	} else {
+		/*
+		dims are in decreasing order of increment. The first whose 
+		increment divides the range increment is the one the range 
+		iterates over - it can continue to the end of that dimension.
+		*/
+		n = 1;
+		for (dp = prop->dim; dp < prop->dim + prop->ndims; ++dp) {
+			ix = a0 / dp->inc;
+			if (ads->inc % dp->inc == 0) {
+				n = (dp->cnt - 1 - ix) / (ads->inc / dp->inc) + 1;
+				break;
+			}
+			a0 %= dp->inc;
+		}
+		a0 = ads->addr - prop->addr;
+	}
+	if (indexes) {
+		for (dp = prop->dim; dp < prop->dim + prop->ndims; ++dp) {
+			indexes[dp->lvl] = a0 / dp->inc;
+			a0 %= dp->inc;
+		}
+	}
+	*countp = (n < ads->count) ? n : ads->count;
+	LOG_FEND();
+	return prop;
+}
+#endif  /* CF_DMP */
+
 /**********************************************************************/
 /*
 */
@@ -355,8 +503,10 @@ freesrchmap(struct addrfind_s *afarray, int count)
 	struct addrfind_s *af;
 
 	LOG_FSTART();
-	for (af = afarray; af < afarray + count; ++af)
+	for (af = afarray; af < afarray + count; ++af) {
 		if (af->ntests > 1) free(af->p.pa);
+		if (af->hits) free(af->hits);
+	}
 	free(afarray);
 	LOG_FEND();
 }
@@ -373,6 +523,19 @@ freeamap(union addrmap_u *amap)
 	case am_srch:
 		freesrchmap(amap->srch.map, amap->srch.count);
 		break;
+	case am_hybrid: {
+		uint32_t i;
+
+		for (i = 0; i < amap->hybr.npages; ++i) {
+			if (amap->hybr.map[i].type == hp_indx) free(amap->hybr.map[i].p.pa);
+		}
+		free(amap->hybr.map);
+		freesrchmap(amap->hybr.srch, amap->hybr.srchcount);
+	}	break;
+	case am_func:
+		/* generated by mapgen - nothing was allocated */
+		LOG_FEND();
+		return;
 	default:
 		acnlogmark(lgWARN, "Freeing unknown map type");
 		/* fall through */
@@ -384,6 +547,85 @@ freeamap(union addrmap_u *amap)
 	LOG_FEND();
 }
 
+/**********************************************************************/
+static int
+cmppropaddr(const void *a, const void *b)
+{
+	const struct dmpprop_s *pa = *(const struct dmpprop_s **)a;
+	const struct dmpprop_s *pb = *(const struct dmpprop_s **)b;
+
+	if (pa->addr != pb->addr) return (pa->addr > pb->addr) - (pa->addr < pb->addr);
+	return (pa > pb) - (pa < pb);
+}
+
+/**********************************************************************/
+/*
+func: amap_proplist
+
+Make a list of all the distinct properties in an address map, sorted 
+by address. Returns a malloc'd array (which the caller must free) and 
+puts the number of entries in *countp.
+*/
+const struct dmpprop_s **
+amap_proplist(union addrmap_u *amap, unsigned int *countp)
+{
+	const struct dmpprop_s **props;
+	unsigned int n;
+	unsigned int i, j;
+
+	LOG_FSTART();
+	n = 0;
+	switch (amap->any.type) {
+	case am_srch:
+	case am_hybrid: {
+		struct addrfind_s *afs;
+		struct addrfind_s *af;
+		uint32_t count;
+
+		if (amap->any.type == am_srch) {
+			afs = amap->srch.map;
+			count = amap->srch.count;
+		} else {
+			afs = amap->hybr.srch;
+			count = amap->hybr.srchcount;
+		}
+		for (af = afs, i = 0; i < count; ++i, ++af)
+			n += (af->ntests > 1) ? af->ntests : 1;
+		props = mallocx((n ? n : 1) * sizeof(*props));
+		n = 0;
+		for (af = afs, i = 0; i < count; ++i, ++af) {
+			if (af->ntests > 1) {
+				for (j = 0; j < (unsigned)af->ntests; ++j) props[n++] = af->p.pa[j];
+			} else {
+				props[n++] = af->p.prop;
+			}
+		}
+	}	break;
+	case am_func:
+		n = amap->func.nprops;
+		props = mallocx((n ? n : 1) * sizeof(*props));
+		memcpy(props, amap->func.props, n * sizeof(*props));
+		break;
+	case am_indx:
+		props = mallocx((amap->indx.range ? amap->indx.range : 1) * sizeof(*props));
+		for (i = 0; i < amap->indx.range; ++i) {
+			if (amap->indx.map[i]) props[n++] = amap->indx.map[i];
+		}
+		break;
+	default:
+		acnlogmark(lgERR, "Unrecognized address map type %d", amap->any.type);
+		*countp = 0;
+		return NULL;
+	}
+	qsort(props, n, sizeof(*props), &cmppropaddr);
+	for (i = j = 0; i < n; ++i) {
+		if (j == 0 || props[i] != props[j - 1]) props[j++] = props[i];
+	}
+	*countp = j;
+	LOG_FEND();
+	return props;
+}
+
 /**********************************************************************/
 void
 indexprop(struct dmpprop_s *prop, struct dmpprop_s **imap, int dimx, uint32_t ad)
@@ -442,3 +684,251 @@ xformtoindx(union addrmap_u *amap)
 	/* maxdims and flags do not change */
 	LOG_FEND();
 }
+
+/**********************************************************************/
+/*
+func: buildhittables
+
+Build hit tables for the regions of a search map which need tests.
+
+Testing an address against sparse or interleaved arrays means 
+modulo arithmetic for every dimension of every candidate property 
+and, for self-overlapping arrays, a recursive search. Instead, for 
+each region of CF_DMPMAP_HITMAX addresses or fewer, we enumerate the 
+member addresses of its properties once and record in a table of 
+one byte per address which property (if any) each one hits. Where 
+properties share an address the first in the region's list wins, 
+as it does when testing.
+
+This must be called after the map is complete since regions are 
+merged and split as properties are added.
+*/
+static void
+hitprop(struct dmpprop_s *prop, uint8_t *hits, uint32_t span, 
+			int dimx, int64_t ad, uint8_t hit)
+{
+	uint32_t i;
+	int64_t ext;
+	struct dmpdim_s *dp;
+
+	if (dimx == prop->ndims) {
+		if (ad >= 0 && ad < span && hits[ad] == 0) hits[ad] = hit;
+		return;
+	}
+	/*
+	ad is negative if the property starts below the region. Skip the 
+	elements of this dimension whose whole sub-block (up to ext above 
+	them) falls below the region so we only enumerate what it covers.
+	*/
+	ext = 0;
+	for (dp = prop->dim + dimx + 1; dp < prop->dim + prop->ndims; ++dp)
+		ext += (int64_t)(dp->cnt - 1) * dp->inc;
+	dp = prop->dim + dimx;
+	i = 0;
+	if (ad + ext < 0) i = (-(ad + ext) + dp->inc - 1) / dp->inc;
+	for (ad += (int64_t)i * dp->inc; i < dp->cnt && ad < span; ++i) {
+		hitprop(prop, hits, span, dimx + 1, ad, hit);
+		ad += dp->inc;
+	}
+}
+
+void
+buildhittables(union addrmap_u *amap)
+{
+	struct addrfind_s *af;
+	struct addrfind_s *afend;
+	struct dmpprop_s *prop;
+	uint32_t span;
+	int i;
+
+	LOG_FSTART();
+	if (amap->any.type != am_srch) return;
+	afend = amap->srch.map + amap->srch.count;
+	for (af = amap->srch.map; af < afend; ++af) {
+		if (af->hits) {
+			free(af->hits);
+			af->hits = NULL;
+		}
+		span = af->adhi - af->adlo + 1;
+		if (af->ntests == 0 || af->ntests > UINT8_MAX 
+			|| span == 0 || span > CF_DMPMAP_HITMAX) continue;
+		af->hits = mallocxz(span);
+		if (af->ntests == 1) {
+			prop = af->p.prop;
+			hitprop(prop, af->hits, span, 0, 
+						(int64_t)prop->addr - af->adlo, 1);
+		} else for (i = 0; i < af->ntests; ++i) {
+			prop = af->p.pa[i];
+			hitprop(prop, af->hits, span, 0, 
+						(int64_t)prop->addr - af->adlo, i + 1);
+		}
+	}
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+func: xformtohybrid
+
+Transform a search map into a hybrid map (see <hybr_amap_s>).
+
+Each page is classified by the search regions which overlap it. Pages 
+with no regions are empty. A page covered by a single region holding a 
+property with no holes just points to that property. Any other page 
+can be searched in its own short list of regions, but if it contains 
+several regions, or sparse or overlapping arrays, a direct index 
+of the page is much faster. Index pages are allocated to the pages 
+with the most regions and tests first until budget bytes are used.
+*/
+struct pagescore_s {
+	uint32_t pg;
+	uint32_t score;
+};
+
+static int
+cmpscore(const void *a, const void *b)
+{
+	uint32_t sa = ((const struct pagescore_s *)a)->score;
+	uint32_t sb = ((const struct pagescore_s *)b)->score;
+
+	return (sa < sb) - (sa > sb);  /* descending */
+}
+
+void
+xformtohybrid(union addrmap_u *amap, size_t budget)
+{
+	struct addrfind_s *afs;
+	struct addrfind_s *af;
+	struct addrfind_s *afend;
+	struct hpage_s *dir;
+	struct hpage_s *hp;
+	struct pagescore_s *scores;
+	uint32_t count;
+	uint32_t base;
+	uint32_t npages;
+	uint32_t nscores;
+	uint32_t pg;
+	uint32_t plo, phi;
+	uint32_t i;
+	size_t pagebytes;
+
+	LOG_FSTART();
+	assert(amap->any.type == am_srch);
+	afs = amap->srch.map;
+	count = amap->srch.count;
+	afend = afs + count;
+	base = afs->adlo & ~HPAGE_MASK;
+	npages = ((afend - 1)->adhi - base) / HPAGE_SIZE + 1;
+	dir = mallocxz(npages * sizeof(struct hpage_s));
+	scores = mallocx(npages * sizeof(struct pagescore_s));
+	nscores = 0;
+
+	/* regions are sorted so we can walk them alongside the pages */
+	for (af = afs, pg = 0, hp = dir; pg < npages; ++pg, ++hp) {
+		struct addrfind_s *a;
+		uint32_t score;
+
+		plo = base + pg * HPAGE_SIZE;
+		phi = plo + HPAGE_MASK;
+		while (af < afend && af->adhi < plo) ++af;
+		if (af == afend || af->adlo > phi) continue;  /* hp_none */
+
+		hp->p.af = af;
+		score = 0;
+		for (a = af; a < afend && a->adlo <= phi; ++a) {
+			score += 1 + a->ntests;
+		}
+		hp->count = a - af;
+		if (hp->count == 1 && af->ntests == 0 && af->adlo <= plo 
+			&& af->adhi >= phi)
+		{
+			hp->type = hp_prop;
+			hp->p.prop = af->p.prop;
+		} else {
+			hp->type = hp_srch;
+			if (score > 1) {
+				scores[nscores].pg = pg;
+				scores[nscores].score = score;
+				++nscores;
+			}
+		}
+	}
+
+	/* spend the budget on index pages where they help most */
+	qsort(scores, nscores, sizeof(*scores), &cmpscore);
+	pagebytes = HPAGE_SIZE * sizeof(struct dmpprop_s *);
+	for (i = 0; i < nscores && budget >= pagebytes; ++i) {
+		struct dmpprop_s **pa;
+		struct addrfind_s *a;
+		uint32_t ad;
+
+		hp = dir + scores[i].pg;
+		plo = base + scores[i].pg * HPAGE_SIZE;
+		pa = mallocxz(pagebytes);
+		for (ad = 0; ad < HPAGE_SIZE; ++ad) {
+			a = findregion(hp->p.af, hp->count, plo + ad);
+			if (a) pa[ad] = (struct dmpprop_s *)region_to_prop(a, plo + ad);
+		}
+		hp->type = hp_indx;
+		hp->p.pa = pa;
+		budget -= pagebytes;
+	}
+	free(scores);
+
+	/* the search table is kept for hp_srch pages */
+	amap->hybr.type = am_hybrid;
+	amap->hybr.srch = afs;
+	amap->hybr.srchcount = count;
+	amap->hybr.map = dir;
+	amap->hybr.size = npages * sizeof(struct hpage_s);
+	amap->hybr.npages = npages;
+	amap->hybr.base = base;
+	/* maxdims and flags do not change */
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+func: choosemap
+
+Pick the best map type for a newly built search map within a memory 
+budget (in bytes) for lookup tables, and transform it accordingly.
+
+A flat index is used if it fits the budget (or is no bigger than 
+the search table), otherwise a hybrid map if its directory fits, 
+otherwise the search map is left unchanged. Returns the resulting 
+map type.
+*/
+enum maptype_e
+choosemap(union addrmap_u *amap, size_t budget)
+{
+	uint32_t range;
+	uint32_t npages;
+	size_t srchsize;
+	size_t dirsize;
+
+	LOG_FSTART();
+	assert(amap->any.type == am_srch);
+	if (amap->srch.count == 0) return am_srch;
+	range = amap->srch.map[amap->srch.count - 1].adhi + 1 
+			- amap->srch.map[0].adlo;
+	srchsize = amap->srch.count * sizeof(struct addrfind_s);
+	if ((size_t)range * sizeof(void *) <= budget
+		|| (size_t)range * sizeof(void *) <= srchsize)
+	{
+		acnlogmark(lgDBUG, "Using index map, range %u", range);
+		xformtoindx(amap);
+	} else {
+		npages = (amap->srch.map[amap->srch.count - 1].adhi 
+					- (amap->srch.map[0].adlo & ~HPAGE_MASK)) / HPAGE_SIZE + 1;
+		dirsize = npages * sizeof(struct hpage_s);
+		if (dirsize <= budget) {
+			acnlogmark(lgDBUG, "Using hybrid map, %u pages", npages);
+			xformtohybrid(amap, budget - dirsize);
+		} else {
+			acnlogmark(lgDBUG, "Using search map");
+		}
+	}
+	LOG_FEND();
+	return amap->any.type;
+}
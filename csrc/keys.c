@@ -35,7 +35,8 @@ SOFTWARE.
 file: keys.c
 
 String pool and hash table utilities adapted from those in expat XML 
-parser.
+parser, plus a simple bump allocator (arena) for objects which all 
+share one lifetime.
 */
 /**********************************************************************/
 /*
@@ -509,6 +510,23 @@ pool_termstr(struct pool_s *pool)
 	return pool_addstr(pool, "");
 }
 
+/**********************************************************************/
+/*
+func: pool_memsize
+
+Return the memory in bytes held by the blocks of a pool.
+*/
+size_t
+pool_memsize(const struct pool_s *pool)
+{
+	const struct pblock_s *blk;
+	size_t size = 0;
+
+	for (blk = pool->blocks; blk != NULL; blk = blk->nxt)
+		size += BLK_SIZE(blk->size);
+	return size;
+}
+
 /**********************************************************************/
 /*
 Add a string of length n
@@ -521,3 +539,92 @@ pool_addstrn(struct pool_s *pool, const ddlchar_t *s, int n)
 	}
 	return s;
 }
+
+/**********************************************************************/
+/*
+Arena allocation.
+
+Objects are carved sequentially out of large blocks and are never 
+freed individually - the whole arena is released at once by 
+<arena_reset()>. Blocks start small and double in size up to 
+ARENA_BLKSIZE so small trees do not carry a large block. Requests 
+bigger than a quarter of a block get a block of their own which is 
+linked behind the current one so the remaining space there is not 
+wasted.
+*/
+struct ablock_s {
+	struct ablock_s *nxt;
+	union arenaalign_u data[];
+};
+
+#define ARENA_MINBLK 0x1000
+#define ARENA_BLKSIZE 0x10000
+#define ARENA_ALIGNUP(x) (((x) + sizeof(union arenaalign_u) - 1) \
+							& ~(sizeof(union arenaalign_u) - 1))
+
+/**********************************************************************/
+/*
+func: arena_alloc
+
+Allocate size bytes from arena. The memory is aligned for any basic 
+type but is not initialized. Returns NULL if a new block is needed 
+and cannot be allocated.
+*/
+void *
+arena_alloc(struct arena_s *arena, size_t size)
+{
+	struct ablock_s *blk;
+	size_t bsize;
+	void *p;
+
+	size = ARENA_ALIGNUP(size);
+	if (size > (size_t)(arena->endp - arena->ptr)) {
+		bsize = arena->size;
+		if (bsize < ARENA_MINBLK) bsize = ARENA_MINBLK;
+		else if (bsize > ARENA_BLKSIZE) bsize = ARENA_BLKSIZE;
+
+		if (size > bsize / 4) {
+			blk = acnalloc(sizeof(struct ablock_s) + size);
+			if (blk == NULL) return NULL;
+			arena->size += size;
+			if (arena->blocks) {
+				blk->nxt = arena->blocks->nxt;
+				arena->blocks->nxt = blk;
+			} else {
+				blk->nxt = NULL;
+				arena->blocks = blk;
+			}
+			return blk->data;
+		}
+		blk = acnalloc(sizeof(struct ablock_s) + bsize);
+		if (blk == NULL) return NULL;
+		arena->size += bsize;
+		blk->nxt = arena->blocks;
+		arena->blocks = blk;
+		arena->ptr = (uint8_t *)blk->data;
+		arena->endp = arena->ptr + bsize;
+	}
+	p = arena->ptr;
+	arena->ptr += size;
+	return p;
+}
+
+/**********************************************************************/
+/*
+func: arena_reset
+
+Free everything allocated from arena and leave it empty and ready for 
+reuse.
+*/
+void
+arena_reset(struct arena_s *arena)
+{
+	struct ablock_s *blk;
+	struct ablock_s *nblk;
+
+	for (blk = arena->blocks; blk != NULL; blk = nblk) {
+		nblk = blk->nxt;
+		acnfree(blk);
+	}
+	memset(arena, 0, sizeof(struct arena_s));
+}
@@ -0,0 +1,316 @@
+/**********************************************************************/
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2026, the Acacian contributors.
+
+This file forms part of Acacian a full featured implementation of 
+ANSI E1.17 Architecture for Control Networks (ACN)
+
+#tabs=3
+*/
+/**********************************************************************/
+/*
+file: marshal.c
+
+Bulk marshalling and unmarshalling of arrays of values.
+
+DMP array properties are carried as runs of big-endian values.
+Handlers which copy a whole run to or from a host array can use the
+functions here rather than calling <marshalU16()> etc. per element.
+
+On a big-endian host the packed versions are just a copy. On a
+little-endian host they byte swap, using vector instructions if
+<CF_MARSHAL_SIMD> is set and the compiler target has SSE2, AVX2 or
+NEON. The stride versions access every inc'th element of the host
+array and are only vectorized when inc is 1.
+
+Because byte swapping is its own inverse, marshalling and
+unmarshalling use the same swap functions.
+*/
+/**********************************************************************/
+/*
+Logging level for this source file.
+If not set it will default to the global CF_LOG_DEFAULT
+
+options are
+
+lgOFF lgEMRG lgALRT lgCRIT lgERR lgWARN lgNTCE lgINFO lgDBUG
+*/
+//#define LOGLEVEL lgDBUG
+
+/**********************************************************************/
+#include <string.h>
+#include "acn.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_BIGENDIAN 1
+#elif CF_MARSHAL_SIMD && defined(__AVX2__)
+#include <immintrin.h>
+#define SWAP_AVX2 1
+#elif CF_MARSHAL_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#define SWAP_SSE2 1
+#elif CF_MARSHAL_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define SWAP_NEON 1
+#endif
+
+/**********************************************************************/
+/*
+Copy count 16-bit values from src to dst reversing the byte order of
+each. Neither need be aligned.
+*/
+static void
+swap16(uint8_t *dst, const uint8_t *src, unsigned int count)
+{
+#if HOST_BIGENDIAN
+	memcpy(dst, src, count * 2);
+#else
+#if SWAP_AVX2
+	const __m256i shuf = _mm256_setr_epi8(
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+
+	for (; count >= 16; count -= 16, src += 32, dst += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)src);
+
+		_mm256_storeu_si256((__m256i *)dst, _mm256_shuffle_epi8(v, shuf));
+	}
+#elif SWAP_SSE2
+	for (; count >= 8; count -= 8, src += 16, dst += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)src);
+
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i *)dst, v);
+	}
+#elif SWAP_NEON
+	for (; count >= 8; count -= 8, src += 16, dst += 16) {
+		vst1q_u8(dst, vrev16q_u8(vld1q_u8(src)));
+	}
+#endif
+	for (; count > 0; --count, src += 2, dst += 2) {
+		uint8_t b = src[0];
+
+		dst[0] = src[1];
+		dst[1] = b;
+	}
+#endif  /* !HOST_BIGENDIAN */
+}
+
+/**********************************************************************/
+/*
+Copy count 32-bit values from src to dst reversing the byte order of
+each.
+*/
+static void
+swap32(uint8_t *dst, const uint8_t *src, unsigned int count)
+{
+#if HOST_BIGENDIAN
+	memcpy(dst, src, count * 4);
+#else
+#if SWAP_AVX2
+	const __m256i shuf = _mm256_setr_epi8(
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	for (; count >= 8; count -= 8, src += 32, dst += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)src);
+
+		_mm256_storeu_si256((__m256i *)dst, _mm256_shuffle_epi8(v, shuf));
+	}
+#elif SWAP_SSE2
+	for (; count >= 4; count -= 4, src += 16, dst += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)src);
+
+		/* swap bytes within each half then swap the halves */
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_si128((__m128i *)dst, v);
+	}
+#elif SWAP_NEON
+	for (; count >= 4; count -= 4, src += 16, dst += 16) {
+		vst1q_u8(dst, vrev32q_u8(vld1q_u8(src)));
+	}
+#endif
+	for (; count > 0; --count, src += 4, dst += 4) {
+		uint8_t b0 = src[0];
+		uint8_t b1 = src[1];
+
+		dst[0] = src[3];
+		dst[1] = src[2];
+		dst[2] = b1;
+		dst[3] = b0;
+	}
+#endif  /* !HOST_BIGENDIAN */
+}
+
+/**********************************************************************/
+/*
+func: marshalU8array
+
+Marshal count octets from src. Returns a pointer to the next data
+byte.
+*/
+uint8_t *
+marshalU8array(uint8_t *data, const uint8_t *src, unsigned int count)
+{
+	return (uint8_t *)memcpy(data, src, count) + count;
+}
+
+/**********************************************************************/
+/*
+func: marshalU16array
+
+Marshal count 16-bit values from src in network byte order. Returns
+a pointer to the next data byte.
+*/
+uint8_t *
+marshalU16array(uint8_t *data, const uint16_t *src, unsigned int count)
+{
+	swap16(data, (const uint8_t *)src, count);
+	return data + count * 2;
+}
+
+/**********************************************************************/
+/*
+func: marshalU32array
+
+Marshal count 32-bit values from src in network byte order. Returns
+a pointer to the next data byte.
+*/
+uint8_t *
+marshalU32array(uint8_t *data, const uint32_t *src, unsigned int count)
+{
+	swap32(data, (const uint8_t *)src, count);
+	return data + count * 4;
+}
+
+/**********************************************************************/
+/*
+func: unmarshalU8array
+
+Unmarshal count octets into dest. Returns a pointer to the next data
+byte.
+*/
+const uint8_t *
+unmarshalU8array(const uint8_t *data, uint8_t *dest, unsigned int count)
+{
+	memcpy(dest, data, count);
+	return data + count;
+}
+
+/**********************************************************************/
+/*
+func: unmarshalU16array
+
+Unmarshal count 16-bit network order values into dest. Returns a
+pointer to the next data byte.
+*/
+const uint8_t *
+unmarshalU16array(const uint8_t *data, uint16_t *dest, unsigned int count)
+{
+	swap16((uint8_t *)dest, data, count);
+	return data + count * 2;
+}
+
+/**********************************************************************/
+/*
+func: unmarshalU32array
+
+Unmarshal count 32-bit network order values into dest. Returns a
+pointer to the next data byte.
+*/
+const uint8_t *
+unmarshalU32array(const uint8_t *data, uint32_t *dest, unsigned int count)
+{
+	swap32((uint8_t *)dest, data, count);
+	return data + count * 4;
+}
+
+/**********************************************************************/
+/*
+func: marshalU8stride
+
+Marshal count octets taken from every inc'th element of src.
+*/
+uint8_t *
+marshalU8stride(uint8_t *data, const uint8_t *src, unsigned int inc, unsigned int count)
+{
+	if (inc == 1) return marshalU8array(data, src, count);
+	for (; count > 0; --count, src += inc) *data++ = *src;
+	return data;
+}
+
+/**********************************************************************/
+/*
+func: marshalU16stride
+
+Marshal count 16-bit values taken from every inc'th element of src.
+*/
+uint8_t *
+marshalU16stride(uint8_t *data, const uint16_t *src, unsigned int inc, unsigned int count)
+{
+	if (inc == 1) return marshalU16array(data, src, count);
+	for (; count > 0; --count, src += inc) data = marshalU16(data, *src);
+	return data;
+}
+
+/**********************************************************************/
+/*
+func: marshalU32stride
+
+Marshal count 32-bit values taken from every inc'th element of src.
+*/
+uint8_t *
+marshalU32stride(uint8_t *data, const uint32_t *src, unsigned int inc, unsigned int count)
+{
+	if (inc == 1) return marshalU32array(data, src, count);
+	for (; count > 0; --count, src += inc) data = marshalU32(data, *src);
+	return data;
+}
+
+/**********************************************************************/
+/*
+func: unmarshalU8stride
+
+Unmarshal count octets into every inc'th element of dest.
+*/
+const uint8_t *
+unmarshalU8stride(const uint8_t *data, uint8_t *dest, unsigned int inc, unsigned int count)
+{
+	if (inc == 1) return unmarshalU8array(data, dest, count);
+	for (; count > 0; --count, dest += inc) *dest = *data++;
+	return data;
+}
+
+/**********************************************************************/
+/*
+func: unmarshalU16stride
+
+Unmarshal count 16-bit values into every inc'th element of dest.
+*/
+const uint8_t *
+unmarshalU16stride(const uint8_t *data, uint16_t *dest, unsigned int inc, unsigned int count)
+{
+	if (inc == 1) return unmarshalU16array(data, dest, count);
+	for (; count > 0; --count, dest += inc, data += 2) *dest = unmarshalU16(data);
+	return data;
+}
+
+/**********************************************************************/
+/*
+func: unmarshalU32stride
+
+Unmarshal count 32-bit values into every inc'th element of dest.
+*/
+const uint8_t *
+unmarshalU32stride(const uint8_t *data, uint32_t *dest, unsigned int inc, unsigned int count)
+{
+	if (inc == 1) return unmarshalU32array(data, dest, count);
+	for (; count > 0; --count, dest += inc, data += 4) *dest = unmarshalU32(data);
+	return data;
+}
@@ -366,12 +366,20 @@ enum: Lcomp_f
 Local component flags
 LCF_OPEN - Component is registered with SDT.
 LCF_LISTEN - Component is listening for Joins.
+LCF_SESSIONS - Cached Sessions PDUs are up to date.
 */
 
 enum Lcomp_f {
 	LCF_OPEN =1,
-	LCF_LISTEN = 2
+	LCF_LISTEN = 2,
+	LCF_SESSIONS = 4
 };
+
+/*
+Any change to channels, members or their connections which shows up in
+a Sessions message must discard the cached copy.
+*/
+#define sessionsChanged(Lcomp) ((Lcomp)->sdt.flags &= ~LCF_SESSIONS)
 /*
 Connection state flags record whether component has registered 
 */
@@ -476,6 +484,7 @@ static void sendNAK(struct Rchannel_s *Rchan, bool suppress);
 static int connectAll(struct Lchannel_s *Lchan, bool owner_only);
 static int disconnectAll(struct Lchannel_s *Lchan, uint8_t reason);
 static int sendSessions(ifMC(struct Lcomponent_s *Lcomp,) netx_addr_t *dest);
+static void freeSessions(struct sdt_Lcomp_s *sdt);
 static void resendWrappers(struct Lchannel_s *Lchan, int32_t first, int32_t last);
 static void updateRmembSeq(struct member_s *memb, int32_t Rseq);
 static uint8_t *setMAKs(uint8_t *bp, struct Lchannel_s *Lchan, uint16_t flags);
@@ -497,6 +506,7 @@ static void NAKfailAction(struct acnTimer_s *timer);
 static void NAKholdoffAction(struct acnTimer_s *timer);
 static void blanktimeAction(struct acnTimer_s *timer);
 static void keepaliveAction(struct acnTimer_s *timer);
+static void setKeepalive(struct Lchannel_s *Lchan);
 
 /* SDT message reeivers */
 static void rx_join(const uint8_t *data, int length, struct rxcontext_s *rcxt);
@@ -517,6 +527,11 @@ static void rx_disconnect(const uint8_t *data, int length, struct member_s *memb
 static void rx_disconnecting(const uint8_t *data, int length, struct member_s *memb);
 static void rx_ack(const uint8_t *data, int length, struct member_s *memb);
 
+#if CF_SDT_JOINQ_SIZE > 0
+static void joinq_purge(ifMC(struct Lcomponent_s *Lcomp));
+static void joinqAction(struct acnTimer_s *timer);
+#endif
+
 /**********************************************************************/
 /*
 External functions
@@ -691,7 +706,11 @@ memory allocations
 #define new_Lchannel()   acnNew(struct Lchannel_s)
 #define free_Lchannel(x) free(x)
 #define new_Rchannel()   acnNew(struct Rchannel_s)
+#if CF_MULTI_COMPONENT
+#define free_Rchannel(x) (free((x)->midmap), free((x)->midhi), free(x))
+#else
 #define free_Rchannel(x) free(x)
+#endif
 
 /**********************************************************************/
 /*
@@ -776,18 +795,43 @@ static inline struct member_s *
 findLmembMID(struct Rchannel_s *Rchan, uint16_t mid)
 {
 #if CF_MULTI_COMPONENT
-	struct member_s *memb;
-	
+	unsigned int lo, hi, x;
+
 	if (Rchan == NULL) return NULL;
-	for (memb = Rchan->members; memb != NULL; memb = memb->loc.lnk.r) {
-		if (memb->loc.mid == mid) break;
-	}
-	return memb;
+	if (mid < Rchan->midspace) return Rchan->midmap[mid];
+	lo = 0;
+	hi = Rchan->nmidhi;
+	while (lo < hi) {
+		x = (lo + hi) / 2;
+		if (Rchan->midhi[x]->loc.mid < mid) lo = x + 1;
+		else hi = x;
+	}
+	if (lo < Rchan->nmidhi && Rchan->midhi[lo]->loc.mid == mid)
+		return Rchan->midhi[lo];
+	return NULL;
 #else
 	return firstMemb(Rchan)->loc.mid == mid ? firstMemb(Rchan) : NULL;
 #endif
 }
 
+/*
+forEachDest(memb, Rchan, mid)
+
+Iterate over the local members of Rchan addressed by a PDU with 
+vector mid - either just the one member with that MID or all of 
+them for ALL_MEMBERS.
+*/
+#if CF_MULTI_COMPONENT
+#define nextMemb(memb) ((memb)->loc.lnk.r)
+#else
+#define nextMemb(memb) NULL
+#endif
+
+#define forEachDest(memb, Rchan, mid) \
+	for ((memb) = ((mid) == ALL_MEMBERS) ? firstMemb(Rchan) : findLmembMID(Rchan, mid); \
+		(memb) != NULL; \
+		(memb) = ((mid) == ALL_MEMBERS) ? nextMemb(memb) : NULL)
+
 /**********************************************************************/
 #if CF_SDT_MAX_CLIENT_PROTOCOLS == 1
 static struct sdt_client_s *
@@ -894,12 +938,14 @@ linkRmemb(struct Lchannel_s *Lchan, struct member_s *memb)
 		Lchan->members.many[Lchan->himid++] = memb;
 		memb->rem.mid = Lchan->himid;
 	}
+	sessionsChanged(LchanOwner(Lchan));
 	return ++Lchan->membercount;
 }
 
 static int
 unlinkRmemb(struct Lchannel_s *Lchan, struct member_s *memb)
 {
+	sessionsChanged(LchanOwner(Lchan));
 	if (--Lchan->membercount == 0) {
 		/* we've removed the last member */
 		if (Lchan->membspace) {
@@ -927,6 +973,7 @@ linkLchan(ifMC(struct Lcomponent_s *Lcomp,) struct Lchannel_s *Lchan)
 
 	Lchan->lnk.r = Lcomp->sdt.Lchannels;
 	Lcomp->sdt.Lchannels = Lchan;
+	sessionsChanged(Lcomp);
 }
 
 static inline int
@@ -936,6 +983,7 @@ unlinkLchan(ifMC(struct Lcomponent_s *Lcomp,) struct Lchannel_s *Lchan)
 
 	struct Lchannel_s *lp = Lcomp->sdt.Lchannels;
 
+	sessionsChanged(Lcomp);
 	if (lp == Lchan) return ((Lcomp->sdt.Lchannels = Lchan->lnk.r) != NULL);
 	else while (1) {
 		if (lp == NULL) return -1;
@@ -949,17 +997,65 @@ unlinkLchan(ifMC(struct Lcomponent_s *Lcomp,) struct Lchannel_s *Lchan)
 
 /**********************************************************************/
 #if CF_MULTI_COMPONENT
+/*
+	Local members of a remote channel are linked into a list and also
+	indexed by their MID in Rchan->midmap so that incoming PDUs can be
+	dispatched directly. MIDs are assigned by the remote so the map is
+	grown as needed to cover the highest MID seen, but only up to 
+	MAXMIDMAP entries. A remote could pick a MID up to 0xfffe so 
+	members above that go in a small array sorted by MID instead.
+*/
+#define MAXMIDMAP 256
+
 static inline void
 linkLmemb(struct Rchannel_s *Rchan, struct member_s *memb)
 {
+	uint16_t mid = memb->loc.mid;
+	unsigned int x;
+
 	memb->loc.lnk.r = Rchan->members;
 	Rchan->members = memb;
+
+	if (mid >= MAXMIDMAP) {
+		for (x = Rchan->nmidhi; x > 0 && Rchan->midhi[x - 1]->loc.mid > mid; --x) {}
+		Rchan->midhi = (struct member_s **)reallocx(Rchan->midhi,
+									(Rchan->nmidhi + 1) * sizeof(void *));
+		memmove(Rchan->midhi + x + 1, Rchan->midhi + x,
+					(Rchan->nmidhi - x) * sizeof(void *));
+		Rchan->midhi[x] = memb;
+		++Rchan->nmidhi;
+		return;
+	}
+	if (mid >= Rchan->midspace) {
+		unsigned int nsize;
+
+		nsize = Rchan->midspace ? Rchan->midspace : FIRSTMSPACE;
+		while (nsize <= mid) nsize <<= 1;
+		Rchan->midmap = (struct member_s **)reallocx(Rchan->midmap,
+													nsize * sizeof(void *));
+		memset(Rchan->midmap + Rchan->midspace, 0,
+					(nsize - Rchan->midspace) * sizeof(void *));
+		Rchan->midspace = nsize;
+	}
+	Rchan->midmap[mid] = memb;
 }
 
 static inline struct member_s *
 unlinkLmemb(struct Rchannel_s *Rchan, struct member_s *memb)
 {
 	struct member_s *mp;
+	unsigned int x;
+
+	if (memb->loc.mid < Rchan->midspace 
+			&& Rchan->midmap[memb->loc.mid] == memb)
+		Rchan->midmap[memb->loc.mid] = NULL;
+	for (x = 0; x < Rchan->nmidhi; ++x) {
+		if (Rchan->midhi[x] == memb) {
+			memmove(Rchan->midhi + x, Rchan->midhi + x + 1,
+						(--Rchan->nmidhi - x) * sizeof(void *));
+			break;
+		}
+	}
 
 	if (Rchan->members == memb) Rchan->members = memb->loc.lnk.r;
 	else for (mp = Rchan->members; mp; mp = mp->loc.lnk.r)
@@ -1203,12 +1299,16 @@ sdt_deregister(ifMC(struct Lcomponent_s *Lcomp))
 	ifnMC(struct Lcomponent_s *Lcomp = &localComponent;)
 	
 	LOG_FSTART();
+#if CF_SDT_JOINQ_SIZE > 0
+	joinq_purge(ifMC(Lcomp));
+#endif
 	while ((Lchan = Lcomp->sdt.Lchannels) != NULL) {
 		closeChannel(Lchan);
 	}
 
 
 	rlpUnsubscribe(Lcomp->sdt.adhoc, NULL, SDT_PROTOCOL_ID);
+	freeSessions(&Lcomp->sdt);
 	Lcomp->sdt.adhoc = NULL;
 	Lcomp->sdt.joinRx = NULL;
 	Lcomp->sdt.flags = 0;
@@ -1313,15 +1413,9 @@ messages so this function just dispatches client protocol messages.
 void
 readrxqueue()
 {
-	uint16_t INITIALIZED(vector);
-	const uint8_t *pdup;
-	const uint8_t *INITIALIZED(datap);
-	const uint8_t *pp;
-	int datasize = 0;
-	uint8_t flags;
 	struct member_s *memb;
 	struct rxwrap_s *rxp;
-	uint32_t INITIALIZED(protocol);
+	struct rxpdu_s *pdu;
 	struct sdt_client_s *clientp;
 
 	LOG_FSTART();
@@ -1329,46 +1423,47 @@ readrxqueue()
 	while (rxqueue != NULL) {
 		rxp = rxqueue->lnk.l;   /* oldest is at tail */
 		dlUnlink(rxqueue, rxp, lnk);
-		/* wrapper has already been checked in queuerxwrap() */
-		pdup = rxp->data + OFS_WRAPPER_CB;
-
-		while (pdup < rxp->data + rxp->length) {
-			flags = *pdup;
-			pp = pdup + 2;
-			pdup += getpdulen(pdup);
-
-			if (flags & VECTOR_bFLAG) {
-				vector = unmarshalU16(pp); pp += 2;
-			}
-
-			if (flags & HEADER_bFLAG) {
-				protocol = unmarshalU32(pp); pp += 6;
-				/*
-				No need to read assoc field - it was checked already 
-				when we queued the wrapper and (at peresent) higher 
-				protocols do not need to know if we're outbound or 
-				inbound.
-				*/
-			}
-			if (flags & DATA_bFLAG)  {
-				datap = pp; /* get pointer to start of the data */
-				datasize = pdup - pp;
-			}
-			forEachMemb(memb, rxp->Rchan) {
-				if ((vector == ALL_MEMBERS || vector == memb->loc.mid)
-					&& ((clientp = findConnectedClient(memb, protocol)))
+		/*
+		wrapper has already been parsed in queuerxwrap() which
+		recorded the client PDUs for us
+		*/
+		for (pdu = rxp->pdus; pdu < rxp->pdus + rxp->npdus; ++pdu) {
+			forEachDest(memb, rxp->Rchan, pdu->mid) {
+				if ((clientp = findConnectedClient(memb, CF_SDT_CLIENTPROTO))
 					&& clientp->callback)
 				{
-					(*(clientp->callback))(memb, datap, datasize, clientp->ref);
+					(*(clientp->callback))(memb, pdu->data, pdu->size, clientp->ref);
 				}
 			}
 		}
 		releaseRxbuf(rxp->rxbuf);
+		free(rxp->pdus);
 		free(rxp);
 	}
 	LOG_FEND();
 }
 
+/**********************************************************************/
+/*
+Record a client protocol PDU found in a wrapper for later dispatch by
+readrxqueue
+*/
+#define RXPDU_STEP 4
+
+static void
+addRxPDU(struct rxwrap_s *rxp, uint16_t mid, const uint8_t *data, int size)
+{
+	struct rxpdu_s *pdu;
+
+	if ((rxp->npdus % RXPDU_STEP) == 0)
+		rxp->pdus = (struct rxpdu_s *)reallocx(rxp->pdus,
+						(rxp->npdus + RXPDU_STEP) * sizeof(struct rxpdu_s));
+	pdu = rxp->pdus + rxp->npdus++;
+	pdu->data = data;
+	pdu->size = size;
+	pdu->mid = mid;
+}
+
 /**********************************************************************/
 /*
 queueNxt
@@ -1387,7 +1482,7 @@ queuerxwrap(struct Rchannel_s *Rchan, struct rxwrap_s *rxp)
 #if CF_SDT_CHECK_ASSOC
 	uint16_t assoc;
 #endif
-	bool haveClientPDUs = false;
+	bool clientPDU;
 
 	LOG_FSTART();
 
@@ -1440,10 +1535,9 @@ queuerxwrap(struct Rchannel_s *Rchan, struct rxwrap_s *rxp)
 				goto dumpwrap;
 			}
 		}
-		forEachMemb(memb, Rchan) {
-			if (memb->loc.mstate >= MS_JOINPEND
-				&& (vector == ALL_MEMBERS || vector == memb->loc.mid))
-			{
+		clientPDU = false;
+		forEachDest(memb, Rchan, vector) {
+			if (memb->loc.mstate >= MS_JOINPEND) {
 #if CF_SDT_CHECK_ASSOC
 				if (assoc && assoc != memb->rem.Lchan->chanNo) {
 					acnlogmark(lgERR, "Rx association error");
@@ -1452,12 +1546,13 @@ queuerxwrap(struct Rchannel_s *Rchan, struct rxwrap_s *rxp)
 				if (protocol == SDT_PROTOCOL_ID) {
 					sdtLevel2Rx(datap, datasize, memb);
 				} else if (protocol == CF_SDT_CLIENTPROTO && memb->connect) {
-					haveClientPDUs = true;
+					clientPDU = true;
 				}
 			}
 		}
+		if (clientPDU) addRxPDU(rxp, vector, datap, datasize);
 	}
-	if (haveClientPDUs) {
+	if (rxp->npdus) {
 		dlAddHead(rxqueue, rxp, lnk);
 		LOG_FEND();
 		return;
@@ -1465,6 +1560,7 @@ queuerxwrap(struct Rchannel_s *Rchan, struct rxwrap_s *rxp)
 
 dumpwrap:
 	releaseRxbuf(rxp->rxbuf);
+	free(rxp->pdus);
 	free(rxp);
 	LOG_FEND();
 }
@@ -1540,6 +1636,7 @@ killMember(struct member_s *memb, uint8_t reason, uint8_t event)
 	if (memb->connect & CX_SDT)
 		(*membLcomp(memb)->sdt.membevent)(EV_LOCLEAVE, Lchan, memb);
 	memb->connect &= ~(CX_CLIENTLOC | CX_CLIENTREM | CX_SDT);
+	sessionsChanged(LchanOwner(memb->rem.Lchan));
 
 	if (memb->rem.mstate >= MS_JOINPEND) {
 		acnlogmark(lgDBUG, "Sending leave");
@@ -1648,6 +1745,7 @@ setFullMember(struct member_s *memb)
 
 	LOG_FSTART();
 	memb->connect |= CX_SDT;
+	sessionsChanged(LchanOwner(memb->rem.Lchan));
 	(*membLcomp(memb)->sdt.membevent)(EV_JOINSUCCESS, memb->rem.Lchan, memb);
 
 #if CF_SDT_MAX_CLIENT_PROTOCOLS == 1
@@ -1715,6 +1813,7 @@ initLocMember(struct member_s *memb, const uint8_t *joindata, struct rxcontext_s
 	memb->loc.mstate = MS_JOINRQ;
 	memb->loc.expireTimer.action = expireAction;
 	memb->loc.expireTimer.userp = memb;
+	sessionsChanged(membLcomp(memb));
 
 	/* update discovery adhoc info!! bad bad bad. why is this in an SDT packet? */
 	(*membLcomp(memb)->sdt.membevent)(EV_DISCOVER, Rcomp, (void *)bp);
@@ -1725,6 +1824,143 @@ initLocMember(struct member_s *memb, const uint8_t *joindata, struct rxcontext_s
 /*
 SDT Message receive functions
 */
+/**********************************************************************/
+#if CF_SDT_JOINQ_SIZE > 0
+/*
+Join admission queue
+
+Cold joins are not processed on arrival but copied into a bounded 
+ring and admitted CF_SDT_JOINQ_BATCH at a time from a timer action, 
+so a storm of joins after a mass restart does not allocate and arm 
+everything in one go. The received context is only valid during 
+nested processing (see rxcontext.h) so we keep our own copy of the 
+parts rx_join needs.
+*/
+struct joinq_s {
+#if CF_MULTI_COMPONENT
+	struct Lcomponent_s *Lcomp;
+#endif
+	netx_addr_t source;
+	uint8_t srcCID[UUID_SIZE];
+	int length;
+	uint8_t data[LEN_JOIN(LEN_TA_IN_MAX)];
+};
+
+static struct joinq_s joinq[CF_SDT_JOINQ_SIZE];
+static unsigned int joinq_head = 0;
+static struct sdt_joinqstats_s joinqstats;
+static acnTimer_t joinqTimer;
+static bool joinq_admitting = false;
+
+#define joinq_ent(n) (&joinq[(joinq_head + (n)) % CF_SDT_JOINQ_SIZE])
+
+/**********************************************************************/
+/*
+func: sdt_joinqstats
+*/
+const struct sdt_joinqstats_s *
+sdt_joinqstats(void)
+{
+	return &joinqstats;
+}
+
+/**********************************************************************/
+/*
+Queue a cold join for later admission. Returns 0 if queued (or
+discarded as a repeat of one already queued), -1 if the queue is full.
+*/
+static int
+joinq_add(const uint8_t *data, int length, struct rxcontext_s *rcxt)
+{
+	struct joinq_s *jq;
+	unsigned int i;
+
+	for (i = 0; i < joinqstats.depth; ++i) {
+		jq = joinq_ent(i);
+		if (ifMC(jq->Lcomp == ctxtLcomp(rcxt) &&)
+			uuidsEq(jq->srcCID, rcxt->rlp.srcCID)
+			&& memcmp(jq->data + OFS_JOIN_CHANNO, data + OFS_JOIN_CHANNO, 2) == 0)
+		{
+			acnlogmark(lgDBUG, "Rx join already queued");
+			++joinqstats.repeats;
+			return 0;
+		}
+	}
+	if (joinqstats.depth >= CF_SDT_JOINQ_SIZE) {
+		++joinqstats.refused;
+		return -1;
+	}
+	jq = joinq_ent(joinqstats.depth);
+	ifMC(jq->Lcomp = ctxtLcomp(rcxt);)
+	jq->source = rcxt->netx.source;
+	uuidcpy(jq->srcCID, rcxt->rlp.srcCID);
+	jq->length = length;
+	memcpy(jq->data, data, length);
+
+	if (++joinqstats.depth > joinqstats.maxdepth)
+		joinqstats.maxdepth = joinqstats.depth;
+	++joinqstats.queued;
+	if (!is_active(&joinqTimer))
+		schedule_action(&joinqTimer, joinqAction, timerval_ms(CF_SDT_JOINQ_TICK_ms));
+	return 0;
+}
+
+/**********************************************************************/
+/*
+Forget any queued joins for a component which is deregistering.
+*/
+static void
+joinq_purge(ifMC(struct Lcomponent_s *Lcomp))
+{
+#if CF_MULTI_COMPONENT
+	unsigned int i, keep;
+
+	for (i = keep = 0; i < joinqstats.depth; ++i) {
+		if (joinq_ent(i)->Lcomp == Lcomp) continue;
+		if (keep != i) *joinq_ent(keep) = *joinq_ent(i);
+		++keep;
+	}
+	joinqstats.depth = keep;
+#else
+	joinqstats.depth = 0;
+#endif
+	if (joinqstats.depth == 0) cancel_timer(&joinqTimer);
+}
+
+/**********************************************************************/
+/*
+Admit the next batch of queued joins.
+*/
+static void
+joinqAction(struct acnTimer_s *timer)
+{
+	struct rxcontext_s rcxt;
+	struct joinq_s *jq;
+	int n;
+
+	LOG_FSTART();
+	memset(&rcxt, 0, sizeof(rcxt));
+	for (n = CF_SDT_JOINQ_BATCH; n > 0 && joinqstats.depth > 0; --n) {
+		jq = joinq_ent(0);
+		rcxt.netx.source = jq->source;
+		rcxt.rlp.srcCID = jq->srcCID;
+#if CF_MULTI_COMPONENT
+		rcxt.Lcomp = jq->Lcomp;
+		rcxt.rlp.handlerRef = jq->Lcomp;
+#endif
+		joinq_admitting = true;
+		rx_join(jq->data, jq->length, &rcxt);
+		joinq_admitting = false;
+		joinq_head = (joinq_head + 1) % CF_SDT_JOINQ_SIZE;
+		--joinqstats.depth;
+		++joinqstats.admitted;
+	}
+	if (joinqstats.depth > 0)
+		set_timer(timer, timerval_ms(CF_SDT_JOINQ_TICK_ms));
+	LOG_FEND();
+}
+#endif  /* CF_SDT_JOINQ_SIZE > 0 */
+
 /**********************************************************************/
 /*
 Join - level 1 message to adhoc address or reciprocal join address
@@ -1867,6 +2103,21 @@ rx_join(const uint8_t *data, int length, struct rxcontext_s *rcxt)
 			goto joinAbort;
 		}
 
+#if CF_SDT_JOINQ_SIZE > 0
+		if (!joinq_admitting) {
+			/*
+			Queue for admission later. Nothing is allocated yet so if 
+			the queue is full just refuse - the remote will retry.
+			*/
+			if (joinq_add(data, length, rcxt) < 0) {
+				acnlogmark(lgNTCE, "Rx join queue full");
+				sendJoinRefuseData(data, SDT_REASON_RESOURCES, rcxt);
+			}
+			LOG_FEND();
+			return;
+		}
+#endif
+
 		if (Rcomp == NULL) {
 #if acntestlog(LOG_DEBUG)
 			char cidstr[UUID_STR_SIZE];
@@ -2024,6 +2275,7 @@ rx_joinAccept(const uint8_t *data, int length, struct rxcontext_s *rcxt)
 	/* Do we need the downstream address? */
 	if (netx_TYPE(&Lchan->outwd_ad) == SDT_ADDR_NULL) {
 		Lchan->outwd_ad = rcxt->netx.source;
+		sessionsChanged(LchanOwner(Lchan));
 	}
 
 	switch (memb->rem.mstate) {
@@ -2335,6 +2587,7 @@ rx_connect(const uint8_t *data, int length, struct member_s *memb)
 	if ((memb->connect & CX_CLIENTREM) == 0) {
 		(*membLcomp(memb)->sdt.membevent)(EV_RCONNECT, memb->rem.Lchan, memb);
 		memb->connect |= CX_CLIENTREM;
+		sessionsChanged(LchanOwner(memb->rem.Lchan));
 	}
 #else
 #endif 
@@ -2365,6 +2618,7 @@ rx_conaccept(const uint8_t *data, int length, struct member_s *memb)
 	if ((memb->connect & CX_CLIENTLOC) == 0) {
 		(*membLcomp(memb)->sdt.membevent)(EV_LCONNECT, memb->rem.Lchan, memb);
 		memb->connect |= CX_CLIENTLOC;
+		sessionsChanged(LchanOwner(memb->rem.Lchan));
 	}
 #else
 #endif 
@@ -2395,6 +2649,7 @@ rx_conrefuse(const uint8_t *data, int length, struct member_s *memb)
 	if ((memb->connect & CX_CLIENTREM)) {
 		(*membLcomp(memb)->sdt.membevent)(EV_CONNECTFAIL, memb->rem.Lchan, memb);
 		memb->connect &= ~CX_CLIENTLOC;
+		sessionsChanged(LchanOwner(memb->rem.Lchan));
 	} else if (memb->connect & CX_LOCINIT) {
 		killMember(memb, SDT_REASON_NO_RECIPIENT, EV_CONNECTFAIL);
 	}
@@ -2427,6 +2682,7 @@ rx_disconnect(const uint8_t *data, int length, struct member_s *memb)
 	if (memb->connect & (CX_CLIENTREM)) {
 		(*membLcomp(memb)->sdt.membevent)(EV_REMDISCONNECT, memb->rem.Lchan, memb);
 		memb->connect &= ~CX_CLIENTREM;
+		sessionsChanged(LchanOwner(memb->rem.Lchan));
 	} else {
 		acnlogmark(lgERR, "Rx spurious disconnect");
 	}
@@ -2460,6 +2716,7 @@ rx_disconnecting(const uint8_t *data, int length, struct member_s *memb)
 		if (memb->connect & CX_CLIENTREM) {
 			(*membLcomp(memb)->sdt.membevent)(EV_REMDISCONNECTING, memb->rem.Lchan, memb);
 			memb->connect &= ~CX_CLIENTLOC;
+			sessionsChanged(LchanOwner(memb->rem.Lchan));
 		} else if (memb->connect & CX_LOCINIT) {
 			killMember(memb, SDT_REASON_NO_RECIPIENT, EV_REMDISCONNECTING);
 		}
@@ -2834,37 +3091,77 @@ sendLeaving(struct member_s *memb, uint8_t reason)
 /**********************************************************************/
 /*
 Send a list  of our sessions
+
+The Sessions PDUs for each local component are built once and cached 
+in Lcomp->sdt.sessions. Any change which would alter them clears 
+LCF_SESSIONS (see sessionsChanged) and the set is rebuilt on the next 
+request, so repeated polling by monitoring tools just re-sends the 
+cached packets. The list is split across as many packets as 
+necessary, breaking only between channel owner or member blocks.
+*/
+#define MAX_OWNER_BLOCKSIZE (4 + (1 + LEN_TA_IN_MAX) * 2 + 2 + 4)
+#define MAX_MEMBER_BLOCKSIZE (20 + (1 + LEN_TA_IN_MAX) * 2 + 4 + 4)
+
+/*
+Start a new cached sessions packet. Buffers are retained across 
+rebuilds so once the cache has grown to size no further allocation 
+is needed.
 */
-/* sizes defined for IPv4 and single client protocol */
-#define MAX_OWNER_BLOCKSIZE (4 + (1 + LEN_TA_IPV4) * 2 + 2 + 4)
-#define MAX_MEMBER_BLOCKSIZE (20 + (1 + LEN_TA_IPV4) * 2 + 4 + 4)
+static uint8_t *
+newSessionsPkt(struct sdt_Lcomp_s *sdt)
+{
+	struct sesspkt_s *pkt;
+
+	if (sdt->nsesspkts >= sdt->sessspace) {
+		unsigned int nsize = sdt->sessspace ? sdt->sessspace << 1 : 2;
+
+		sdt->sessions = (struct sesspkt_s *)reallocx(sdt->sessions,
+								nsize * sizeof(struct sesspkt_s));
+		memset(sdt->sessions + sdt->sessspace, 0, 
+								(nsize - sdt->sessspace) * sizeof(struct sesspkt_s));
+		sdt->sessspace = nsize;
+	}
+	pkt = sdt->sessions + sdt->nsesspkts++;
+	if (pkt->txbuf == NULL && (pkt->txbuf = new_txbuf(MAX_MTU)) == NULL) {
+		--sdt->nsesspkts;
+		return NULL;
+	}
+	return marshalU8(pkt->txbuf + RLP_OFS_PDU1DATA + 2, SDT_SESSIONS);
+}
 
 static int
-sendSessions(ifMC(struct Lcomponent_s *Lcomp,) netx_addr_t *dest)
+buildSessions(struct Lcomponent_s *Lcomp)
 {
-	ifnMC(struct Lcomponent_s *Lcomp = &localComponent;)
+	struct sdt_Lcomp_s *sdt = &Lcomp->sdt;
 	struct Lchannel_s *Lchan;
-	uint8_t *txbuf;
+	struct Rchannel_s *Rchan;
+	struct member_s *memb;
+	netx_addr_t addr;
+	static const netx_addr_t nulladdr;
 	uint8_t *bp;
 	uint8_t *ep;
 	uint16_t sessions;
-	netx_addr_t addr;
-	struct member_s *memb;
 	uint16_t mid;
 
 	LOG_FSTART();
-	txbuf = new_txbuf(MAX_MTU);
-	if (txbuf == NULL) return -1;
-	ep = txbuf + MAX_MTU - MAX_MEMBER_BLOCKSIZE;
-	bp = NULL;
+	sdt->nsesspkts = 0;
+	bp = ep = NULL;
 
-	for (Lchan = Lcomp->sdt.Lchannels; Lchan; Lchan = Lchan->lnk.r) {
+	for (Lchan = sdt->Lchannels; Lchan; Lchan = Lchan->lnk.r) {
 		sessions = 0;
+		for (mid = 1; mid <= Lchan->himid; ++mid) {
+			if ((memb = findRmembMID(Lchan, mid))) sessions |= memb->connect;
+		}
 		/* loop once with mid == 0 for Lchan then once for each member */
 		for (mid = 0; mid <= Lchan->himid; ++mid) {
-			if (bp == NULL) {
-				bp = txbuf + RLP_OFS_PDU1DATA + 2;  /* leave space for flags/vector */
-				bp = marshalU8(bp, SDT_SESSIONS);
+			if (mid && (memb = findRmembMID(Lchan, mid)) == NULL) continue;
+
+			if (bp == NULL || bp > ep) {
+				if (bp) sdt->sessions[sdt->nsesspkts - 1].length = 
+								bp - sdt->sessions[sdt->nsesspkts - 1].txbuf;
+				if ((bp = newSessionsPkt(sdt)) == NULL) return -1;
+				ep = sdt->sessions[sdt->nsesspkts - 1].txbuf 
+								+ MAX_MTU - MAX_MEMBER_BLOCKSIZE;
 			}
 
 			if (mid == 0) {
@@ -2874,40 +3171,70 @@ sendSessions(ifMC(struct Lcomponent_s *Lcomp,) netx_addr_t *dest)
 				netxGetMyAddr(Lchan->inwd_sk, &addr);
 				bp = marshalTA(bp, &addr);
 				if (sessions) {
-					marshalU16(bp, 1);
-					marshalU32(bp, CF_SDT_CLIENTPROTO);
+					bp = marshalU16(bp, 1);
+					bp = marshalU32(bp, CF_SDT_CLIENTPROTO);
 				} else {
-					marshalU16(bp, 0);
+					bp = marshalU16(bp, 0);
 				}
 			} else {
-				if ((memb = findRmembMID(Lchan, mid)) == NULL) continue;
+				Rchan = get_Rchan(memb);
 				bp = marshalU16(bp, memb->loc.mid);
 				bp = marshaluuid(bp, memb->rem.Rcomp->uuid);
-				bp = marshalU16(bp, get_Rchan(memb)->chanNo);
-				bp = marshalTA(bp, &get_Rchan(memb)->outwd_ad);
-				bp = marshalTA(bp, &get_Rchan(memb)->inwd_ad);
+				bp = marshalU16(bp, Rchan ? Rchan->chanNo : 0);
+				bp = marshalTA(bp, Rchan ? &Rchan->outwd_ad : &nulladdr);
+				bp = marshalTA(bp, Rchan ? &Rchan->inwd_ad : &nulladdr);
 				bp = marshalU16(bp, memb->rem.Lchan->chanNo);
-				sessions |= memb->connect;
 				if (memb->connect) {
-					marshalU16(bp, 1);
-					marshalU32(bp, CF_SDT_CLIENTPROTO);
+					bp = marshalU16(bp, 1);
+					bp = marshalU32(bp, CF_SDT_CLIENTPROTO);
 				} else {
-					marshalU16(bp, 0);
+					bp = marshalU16(bp, 0);
 				}
 			}
-
-			if (bp > ep || (Lchan->lnk.r == NULL && mid == Lchan->himid)) {
-				sdt1_sendbuf(txbuf, bp - txbuf, Lcomp->sdt.adhoc, dest, Lcomp->uuid);
-				bp = NULL;
-			}
 		}
 	}
+	if (bp) sdt->sessions[sdt->nsesspkts - 1].length = 
+					bp - sdt->sessions[sdt->nsesspkts - 1].txbuf;
+	sdt->flags |= LCF_SESSIONS;
+	LOG_FEND();
+	return 0;
+}
 
-	free_txbuf(txbuf, MAX_MTU);
+static int
+sendSessions(ifMC(struct Lcomponent_s *Lcomp,) netx_addr_t *dest)
+{
+	ifnMC(struct Lcomponent_s *Lcomp = &localComponent;)
+	struct sesspkt_s *pkt;
+
+	LOG_FSTART();
+	if ((Lcomp->sdt.flags & LCF_SESSIONS) == 0 && buildSessions(Lcomp) < 0)
+		return -1;
+
+	for (pkt = Lcomp->sdt.sessions;
+			pkt < Lcomp->sdt.sessions + Lcomp->sdt.nsesspkts; ++pkt)
+	{
+		sdt1_sendbuf(pkt->txbuf, pkt->length, Lcomp->sdt.adhoc, dest, Lcomp->uuid);
+	}
 	LOG_FEND();
 	return 0;
 }
 
+/*
+Release the cached sessions packets
+*/
+static void
+freeSessions(struct sdt_Lcomp_s *sdt)
+{
+	unsigned int i;
+
+	for (i = 0; i < sdt->sessspace; ++i) {
+		if (sdt->sessions[i].txbuf) free_txbuf(sdt->sessions[i].txbuf, MAX_MTU);
+	}
+	free(sdt->sessions);
+	sdt->sessions = NULL;
+	sdt->sessspace = sdt->nsesspkts = 0;
+}
+
 /**********************************************************************/
 /*
 Send a NAK
@@ -3166,6 +3493,7 @@ disconnectAll(struct Lchannel_s *Lchan, uint8_t reason)
 			&& (memb->connect & CX_CLIENTLOC)
 		) {
 			memb->connect &= ~CX_CLIENTLOC;
+			sessionsChanged(LchanOwner(memb->rem.Lchan));
 			if (txwrap == NULL)
 				addSDTmsg(&txwrap, memb, WRAP_REL_ON, disconnect_msg);
 			else
@@ -3179,6 +3507,7 @@ disconnectAll(struct Lchannel_s *Lchan, uint8_t reason)
 			&& (memb->connect & CX_CLIENTREM)
 		) {
 			memb->connect &= ~CX_CLIENTREM;
+			sessionsChanged(LchanOwner(memb->rem.Lchan));
 			if (txwrap == NULL)
 				addSDTmsg(&txwrap, memb, WRAP_REL_ON | WRAP_REPLY, disconnecting_msg);
 			else
@@ -3710,7 +4039,7 @@ _flushWrapper(struct txwrap_s *txwrap, int32_t *Rseqp)
 		free_txwrap(txwrap);
 	}
 	//acnlogmark(lgDBUG, "set keepalive %ums", Lchan->ka_t_ms);
-	set_timer(&Lchan->keepalive, timerval_ms(Lchan->ka_t_ms));
+	setKeepalive(Lchan);
 	LOG_FEND();
 	return 0;
 }
@@ -4216,6 +4545,13 @@ drop_member(struct member_s *memb, uint8_t reason)
 	LOG_FEND();
 }
 
+/**********************************************************************/
+struct member_s *
+findMember(struct Lchannel_s *Lchan, struct Rcomponent_s *Rcomp)
+{
+	return findRmembComp(Lchan, Rcomp);
+}
+
 /**********************************************************************/
 /*
 Timeout functions
@@ -4382,6 +4718,37 @@ blanktimeAction(struct acnTimer_s *timer)
 	Lchan->nakfirst = Lchan->naklast = 0;
 }
 
+/**********************************************************************/
+/*
+Arm the keepalive timer for a channel.
+
+Rather than expiring exactly ka_t_ms from now, the deadline is 
+brought forward onto a shared grid of CF_SDT_KEEPALIVE_TICK_ms 
+provided that stays within CF_SDT_KEEPALIVE_SLACK percent of the 
+interval. Idle channels then fall due together and are all 
+serviced in one pass of the event loop instead of each waking 
+us separately. While setMAKs has shortened the interval the slack 
+is usually too small to reach a tick and the exact time is used.
+*/
+static void
+setKeepalive(struct Lchannel_s *Lchan)
+{
+	unsigned int ka_ms;
+
+	ka_ms = Lchan->ka_t_ms;
+#if CF_SDT_KEEPALIVE_TICK_ms > 0
+	{
+		unsigned int early;
+
+		early = ((unsigned int)time_in_ms(get_acn_time()) + ka_ms)
+						% CF_SDT_KEEPALIVE_TICK_ms;
+		if (early < ka_ms && early <= ka_ms * CF_SDT_KEEPALIVE_SLACK / 100)
+			ka_ms -= early;
+	}
+#endif
+	set_timer(&Lchan->keepalive, timerval_ms(ka_ms));
+}
+
 /**********************************************************************/
 /*
 
@@ -4765,10 +5132,8 @@ pendingRxWrap(struct Rchannel_s *Rchan, const uint8_t *data, int length)
 			}
 		}
 		if (protocol == SDT_PROTOCOL_ID) {
-			forEachMemb(memb, Rchan) {
-				if (memb->loc.mstate >= MS_JOINPEND
-					&& (vector == ALL_MEMBERS || vector == memb->loc.mid))
-				{
+			forEachDest(memb, Rchan, vector) {
+				if (memb->loc.mstate >= MS_JOINPEND) {
 #if CF_SDT_CHECK_ASSOC
 					if (assoc && assoc != memb->rem.Lchan->chanNo) {
 						acnlogmark(lgERR, "Rx association error");
@@ -37,6 +37,10 @@ Demo controller
 
 #define CF_JOIN_TX_GROUPS 0
 #define CF_STR_FOLDSPACE 1
+#define CF_DDL_THREADS 4
+#define CF_DDL_LAZYSTRINGS 1
+#define CF_DDL_INDEX 1
+#define CF_DDL_FETCH 1
 
 #define CF_DMPCOMP_C_ 1
 #define RANDOM_DROP 8
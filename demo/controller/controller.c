@@ -36,6 +36,7 @@ accept the first few letters. See <term_event> for details.
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <string.h>
 
 
 /*
@@ -88,6 +89,9 @@ ctlcxt - transmit context for control messages (see <dmptcxt_s>).
 remlist - array of remote components (they are also stored in a uuid set
 for rapid lookup by CID).
 nremotes - the count of components in remlist.
+remtrees - the shared device tree (if any) whose address map has been 
+assigned to each entry of remlist. Each holds a reference which is 
+dropped when the component is no longer discovered.
 ctlmbrs - array holding SDT connections of members of the control group.
 localComponent - <Lcomponent_s> holding ACN data representing the
 single controller component (see <CF_MULTI_COMPONENT>).
@@ -96,6 +100,7 @@ struct dmptcxt_s *ctlcxt = NULL;
 
 /**********************************************************************/
 struct Rcomponent_s *remlist[MAX_REMOTES];
+struct rootdev_s *remtrees[MAX_REMOTES] = {NULL,};
 struct member_s *ctlmbrs[MAX_REMOTES] = {NULL,};
 int nremotes = 0;
 /**********************************************************************/
@@ -288,6 +293,70 @@ showprops(struct dmprcxt_s *rcxt, const uint8_t *bp)
 	return count;
 }
 
+/**********************************************************************/
+#define REQ_WINDOW 16
+#define REQ_TIMEOUT_ms 2000
+
+/*
+func: reqdone
+
+Completion callback for tracked get-property requests. Replies 
+themselves are shown by <showprops()> so only report failures here.
+*/
+static void
+reqdone(struct Rcomponent_s *Rcomp, const struct adspec_s *ads, int status,
+			void *ref)
+{
+	if (status == DMPREQ_TIMEOUT)
+		fprintf(stdout, "Get property %u timed out\n", ads->addr);
+	else if (status > 0)
+		fprintf(stdout, "Get property %u failed, reason %d\n", ads->addr, status);
+}
+
+/**********************************************************************/
+/*
+func: freereqtrk
+
+Free a component's request tracker together with its transmit 
+context.
+*/
+static void
+freereqtrk(struct Rcomponent_s *Rcomp)
+{
+	struct dmptcxt_s *reqcxt;
+
+	if (Rcomp->dmp.reqtrk == NULL) return;
+	reqcxt = Rcomp->dmp.reqtrk->tcxt;
+	dmp_freereqtrk(Rcomp);
+	free(reqcxt);
+}
+
+/**********************************************************************/
+/*
+func: newreqtrk
+
+Create a request tracker for a newly connected member of the control 
+group. Tracked requests have their own transmit context which is 
+allocated per component, so it stays with the component however 
+<remlist> is reordered.
+*/
+static void
+newreqtrk(struct member_s *mbr)
+{
+	struct dmptcxt_s *reqcxt;
+
+	freereqtrk(mbr->rem.Rcomp);
+	reqcxt = acnNew(struct dmptcxt_s);
+	reqcxt->dest = mbr;
+	reqcxt->wflags = WRAP_REL_ON;
+	if (dmp_newreqtrk(mbr->rem.Rcomp, reqcxt, REQ_WINDOW, REQ_TIMEOUT_ms,
+						&reqdone) == NULL)
+	{
+		acnlogerror(lgERR);
+		free(reqcxt);
+	}
+}
+
 /**********************************************************************/
 /*
 func: cd_sdtev
@@ -312,6 +381,7 @@ cd_sdtev(int event, void *object, void *info)
 		mbr = (struct member_s *)info;
 
 		if (ctlcxt && Lchan == ctlcxt->dest) {
+			newreqtrk(mbr);
 			for (i = 0; i < nremotes; ++i) {
 				if (remlist[i] == mbr->rem.Rcomp) {
 					ctlmbrs[i] = mbr;
@@ -327,6 +397,7 @@ cd_sdtev(int event, void *object, void *info)
 		mbr = (struct member_s *)info;
 
 		if (ctlcxt && Lchan == ctlcxt->dest) {
+			freereqtrk(mbr->rem.Rcomp);
 			for (i = 0; i < nremotes; ++i) {
 				if (ctlmbrs[i] == mbr) {
 					ctlmbrs[i] = NULL;
@@ -481,56 +552,33 @@ readprop(char **bpp, int rem, const struct dmpprop_s **dpp, struct adspec_s *ofp
 }
 /**********************************************************************/
 /*
-func: ddltree
+func: showtree
 
-Print the property tree of the specified device. If there is no 
+Print the property tree of a remote device. If there is no 
 property tree associated with the device, parse its DDL first to 
-generate one.
+generate one. The tree and its map are shared by all devices with 
+the same DCID, each of which holds a reference (see <getrootdev()>).
 */
 static void
-ddltree(char **bpp)
+showtree(int rem)
 {
 	struct Rcomponent_s *Rcomp;
-	const struct rootdev_s *root;
-	const uint8_t *rootdcid;
-	int rem;
+	struct rootdev_s *root;
 	int i;
 
-	if ((rem = readremote(bpp)) < 0) return;
 	Rcomp = remlist[rem];
 	
-	if ((rootdcid = finduuid(&devtrees, Rcomp->slp.dcid)) != NULL) {
-		root = container_of(rootdcid, struct rootdev_s, dcid[0]);
-	} else {  /* need to parse it */
+	if ((root = findrootdev(Rcomp->slp.dcid)) == NULL) {
 		char dcidstr[UUID_STR_SIZE];
-		union addrmap_u *amap;
-		uint32_t adrange;
-		unsigned int ixratio;
 
 		fprintf(stdout, "Parsing DDL\n");
-		uuid2str(Rcomp->slp.dcid, dcidstr);
-		root = parseroot(dcidstr);
-		if (root == NULL) {
-			acnlog(lgERR, "Can't generate device %.8s...", dcidstr);
+		if ((root = getrootdev(Rcomp->slp.dcid)) == NULL) {
+			acnlog(lgERR, "Can't generate device %.8s...",
+					uuid2str(Rcomp->slp.dcid, dcidstr));
 			return;
 		}
-		acnlog(lgDBUG, "Add new DCID %.8s...", dcidstr);
-		rootdcid = root->dcid;
-		amap = root->amap;
-		assert(amap != NULL);
-		adrange = root->maxaddr - root->minaddr;
-		ixratio = (adrange * sizeof(void *))
-				/ (amap->srch.count * sizeof(struct addrfind_s));
-
-		acnlog(lgDBUG, "Address range %u, index:search map size ratio %u",
-				adrange, ixratio);
-		if (adrange <= 64 || ixratio < 3) {
-			/* other criteria for conversion could be used */
-			acnlogmark(lgDBUG, "Transforming map");
-			xformtoindx(amap);
-		} else {
-			acnlogmark(lgDBUG, "Using search map");
-		}
+		acnlog(lgDBUG, "Add new DCID %.8s...", uuid2str(root->dcid, dcidstr));
+		assert(root->amap != NULL);
 	}
 	acnlog(lgDBUG, "Assign new map to all devices of this DCID");
 	for (i = 0; i < nremotes; ++i) {
@@ -541,10 +589,12 @@ ddltree(char **bpp)
 		assert(Rcomp->slp.dcid);
 		acnlogmark(lgDBUG, "try %d \"%s\"...", i, Rcomp->slp.uacn);
 		if (Rcomp->dmp.amap == NULL
-			&& uuidsEq(rootdcid, Rcomp->slp.dcid))
+			&& uuidsEq(root->dcid, Rcomp->slp.dcid))
 		{
 			acnlogmark(lgDBUG, "...assigning");
+			++root->usecount;
 			Rcomp->dmp.amap = root->amap;
+			remtrees[i] = root;
 		}
 	}
 	acnlog(lgDBUG, "all assigned");
@@ -553,6 +603,73 @@ ddltree(char **bpp)
 			"----------------------\n"
 			, rem + 1);
 	printtree(stdout, root->ddlroot);
+	droprootdev(root);
+}
+
+#if CF_DDL_FETCH
+/**********************************************************************/
+/*
+Called when the DDL fetched by <ddltree()> is all in.
+*/
+static void
+ddlfetched(const uint8_t *dcid, int err, void *ref)
+{
+	char dcidstr[UUID_STR_SIZE];
+	int i;
+
+	if (err) {
+		acnlog(lgWARN, "Fetching DDL for %.8s...: %s",
+				uuid2str(dcid, dcidstr), strerror(err));
+	}
+	for (i = 0; i < nremotes; ++i) {
+		if ((remlist[i]->slp.flags & slp_dev)
+			&& uuidsEq(remlist[i]->slp.dcid, dcid))
+		{
+			showtree(i);
+			return;
+		}
+	}
+}
+#endif
+
+/**********************************************************************/
+/*
+func: ddltree
+
+Print the property tree of the specified device (see <showtree()>). 
+If the device's DDL is not available locally it is fetched from the 
+device first and the tree printed when it arrives.
+*/
+static void
+ddltree(char **bpp)
+{
+	int rem;
+
+	if ((rem = readremote(bpp)) < 0) return;
+#if CF_DDL_FETCH
+	{
+		struct Rcomponent_s *Rcomp = remlist[rem];
+		struct rootdev_s *root;
+
+		/* only asking whether it is loaded, so don't keep the tree */
+		if ((root = findrootdev(Rcomp->slp.dcid)) != NULL) {
+			droprootdev(root);
+		} else if (Rcomp->slp.ddlurl) {
+			switch (ddlfetch(Rcomp->slp.dcid, Rcomp->slp.ddlurl,
+											&ddlfetched, NULL)) {
+			case 1:
+				fprintf(stdout, "Fetching DDL from device\n");
+				return;
+			case -1:
+				acnlogerror(lgWARN);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+#endif
+	showtree(rem);
 }
 /**********************************************************************/
 /*
@@ -565,10 +682,17 @@ dodiscover()
 {
 	char *ctyp;
 	struct Rcomponent_s *Rcomp;
-	int i;
+	struct Rcomponent_s *oldlist[MAX_REMOTES];
+	struct rootdev_s *oldtrees[MAX_REMOTES];
+	int nold;
+	int i, j;
 	char uuidstr[UUID_STR_SIZE];
-	const uint8_t *rootdcid;
 
+	/* keep the old list to carry tree references across */
+	nold = nremotes;
+	memcpy(oldlist, remlist, nold * sizeof(remlist[0]));
+	memcpy(oldtrees, remtrees, nold * sizeof(remtrees[0]));
+	memset(remtrees, 0, sizeof(remtrees));
 	nremotes = 0;
 
 	discover();
@@ -602,21 +726,44 @@ dodiscover()
 				ntohs(netx_PORT(&Rcomp->sdt.adhocAddr)),
 				uuid2str(Rcomp->uuid, uuidstr)
 			);
-			rootdcid = finduuid(&devtrees, Rcomp->slp.dcid);
-			if (rootdcid != NULL) {
-				const struct rootdev_s *root;
-
-				root = container_of(rootdcid, struct rootdev_s, dcid[0]);
-				Rcomp->dmp.amap = root->amap;
-			}
 			if (i < MAX_REMOTES) {
 				remlist[i] = Rcomp;
+				for (j = 0; j < nold; ++j) {
+					if (oldlist[j] == Rcomp) {
+						remtrees[i] = oldtrees[j];
+						oldtrees[j] = NULL;
+						break;
+					}
+				}
+				if (Rcomp->dmp.amap == NULL && (Rcomp->slp.flags & slp_dev)) {
+					struct rootdev_s *root;
+
+					/* the reference is kept in remtrees */
+					if ((root = findrootdev(Rcomp->slp.dcid)) != NULL) {
+						Rcomp->dmp.amap = root->amap;
+						remtrees[i] = root;
+					}
+				}
 			}
 			++i;
 
 		} NEXT_UUID()
 		nremotes = (i <= MAX_REMOTES) ? i : MAX_REMOTES;
 	}
+	/*
+	components which have gone no longer need their trees, but must 
+	not keep pointers into them in case they come back
+	*/
+	for (j = 0; j < nold; ++j) {
+		if (oldtrees[j] == NULL) continue;
+		if (oldlist[j]->dmp.amap == oldtrees[j]->amap) {
+#if CF_DMP_RMIRROR
+			dmp_freemirror(oldlist[j]);
+#endif
+			oldlist[j]->dmp.amap = NULL;
+		}
+		droprootdev(oldtrees[j]);
+	}
 }
 /**********************************************************************/
 /*
@@ -814,20 +961,20 @@ setprop(char **bpp)
 /*
 func: getprop
 
-Construct and send a get-property message.
+Queue a get-property request with the remote's request tracker and 
+send it.
 */
 static void
 getprop(char **bpp)
 {
 	int rem;
-	struct member_s *mbr;
+	struct dmp_reqtrk_s *trk;
 	const struct dmpprop_s *dprop;
 	struct adspec_s ads;
-	uint8_t *txp;
 
 	LOG_FSTART();
 	if ((rem = readremote(bpp)) < 0) return;
-	if ((mbr = ctlmbrs[rem]) == NULL) {
+	if (ctlmbrs[rem] == NULL || (trk = remlist[rem]->dmp.reqtrk) == NULL) {
 		fprintf(stdout, "Remote %i \"%s\" is not connected\n", rem + 1,
 				remlist[rem]->slp.uacn);
 		return;
@@ -841,12 +988,8 @@ getprop(char **bpp)
 	ads.inc = ads.count = 1;
 	ofs2addr(dprop, &ads, &ads);
 
-	assert(ctlcxt->pdup == NULL);
-	ctlcxt->dest = mbr;
-	ctlcxt->wflags = WRAP_REL_ON;
-	txp = dmp_openpdu(ctlcxt, DMP_GET_PROPERTY << 8 | DMPAD_SINGLE,
-							&ads, 0);
-	dmp_closeflush(ctlcxt, txp);	
+	if (dmp_reqget(trk, &ads, NULL) < 0 || dmp_reqflush(trk) < 0)
+		acnlogerror(lgERR);
 	LOG_FEND();
 }
 
@@ -40,6 +40,7 @@ Print DDL tree demo
 
 #define CF_ACNLOG ACNLOG_STDERR
 #define CF_STR_FOLDSPACE 1
+#define CF_DDL_THREADS 4
 
 #define CF_EPI10   0
 #define CF_EPI11   0
@@ -65,6 +65,10 @@ else
 # use external expat library
 LDFLAGS += -lexpat
 endif
+# DDL worker threads
+ifneq "${CF_DDL_THREADS}" "0"
+LDFLAGS += -pthread
+endif
 endif
 
 # if CF_EPI29 then SLP is needed
@@ -72,6 +76,11 @@ ifeq "${CF_EPI29}" "1"
 LDFLAGS += -lslp
 endif
 
+# generated device maps can be a lookup function
+ifeq "${CF_DMPMAP_GENFN}" "1"
+mapgen_flags += -f
+endif
+
 .SUFFIXES:
 
 vpath %.c ${_r_acacian}/csrc ${_r_utils} ${_r_o}
@@ -92,7 +101,7 @@ ${_r_o}/%.o : %.c
 	${CC} -c -o $@ -D${demo}=1 ${CPPFLAGS} -I${_r_o} ${CFLAGS} $<
 
 ${_r_o}/%_map.c ${_r_o}/%_map.h: %.dev.ddl ${mapgen}
-	${mapgen} -c ${_r_o}/$*_map.c -h ${_r_o}/$*_map.h $<
+	${mapgen} ${mapgen_flags} -c ${_r_o}/$*_map.c -h ${_r_o}/$*_map.h $<
 
 # Some targets for generating debug info
 ${_r_o}/macros :
@@ -53,5 +53,6 @@ Warning: Tokens must be in lexical order
 
 #define CF_NUMEXTENDFIELDS 5
 #define CF_PROPEXT_FNS 1
+#define CF_DMPMAP_GENFN 1
 
 #endif  /* __acncfg_device_h__ */
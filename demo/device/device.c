@@ -90,9 +90,13 @@ const char uacn_dflt[] = IMMP_deviceID_defaultname;
 
 
 /*
-event session context
+Subscriptions to the bargraph are managed by a DMP subscriber 
+registry which opens event channels as needed and coalesces changes 
+so a subscriber sees at most one event message per EV_INTERVAL_ms 
+however fast the bars are changed.
 */
-struct dmptcxt_s *evcxt = NULL;
+#define EV_INTERVAL_ms 50
+struct dmp_subreg_s *barsubs = NULL;
 
 static struct termios savetty;
 static bool termin, termout;
@@ -209,8 +213,6 @@ declare_bars(
 )
 {
 	uint8_t *txp;
-	int i;
-	unsigned int ofs;
 	struct dmpprop_s *dprop = &DMP_bargraph;
 
 	LOG_FSTART();
@@ -218,14 +220,25 @@ declare_bars(
 	txp = dmp_openpdu(tcxt, vec << 8 | DMPAD_RANGE_STRUCT, dmpads, dprop->size * offs->count);
 	acnlogmark(lgDBUG, "declare bars %u:%u:%u", offs->addr, offs->inc, offs->count);
 
-	for (ofs = offs->addr, i = offs->count; i--;) {
-		acnlogmark(lgDBUG, "  bar[%u] = %u", ofs, barvals[ofs]);
-		txp = marshalU16(txp, barvals[ofs]);
-		ofs += offs->inc;
-	}
+	txp = marshalU16stride(txp, barvals + offs->addr, offs->inc, offs->count);
 	dmp_closepdu(tcxt, txp);
 	LOG_FEND();
 }
+/**********************************************************************/
+/*
+Value callback for barsubs
+*/
+static int
+getbarval(void *ref, uint32_t addr, uint8_t *buf)
+{
+	struct adspec_s dmpads = {addr, 0, 1};
+	struct adspec_s offs;
+
+	if (addr2ofs(&DMP_bargraph, &dmpads, &offs) < 0) return -1;
+	marshalU16(buf, barvals[offs.addr]);
+	return 2;
+}
+
 /**********************************************************************/
 int getbar(struct dmprcxt_s *rcxt, const uint8_t *bp)
 {
@@ -251,20 +264,23 @@ int setbar(struct dmprcxt_s *rcxt, const uint8_t *bp)
 
 	if (addr2ofs(rcxt->dprop, &rcxt->ads, &offs) < 0) return -1;
 
-	for (ofs = offs.addr, i = offs.count; i--;) {
-		uint16_t newval;
+	{
+		uint16_t newvals[offs.count];
+
+		unmarshalU16array(bp, newvals, offs.count);
+		for (ofs = offs.addr, i = 0; i < offs.count; ++i) {
+			uint16_t newval = newvals[i];
 
-		newval = unmarshalU16(bp);
-		if (newval > IMMP_barMax) newval = IMMP_barMax;
-		dirty |= (barvals[ofs] != newval);
-		barvals[ofs] = newval;
-		bp += 2;
-		ofs += offs.inc;
+			if (newval > IMMP_barMax) newval = IMMP_barMax;
+			dirty |= (barvals[ofs] != newval);
+			barvals[ofs] = newval;
+			ofs += offs.inc;
+		}
 	}
 	if (dirty) {
-		if ((rcxt->dprop->flags & pflg(event)) && evcxt) {
-			declare_bars(evcxt, &rcxt->ads, &offs, DMP_EVENT);
-			dmp_flushpdus(evcxt);
+		if ((rcxt->dprop->flags & pflg(event)) && barsubs) {
+			rcxt->ads.count = offs.count;
+			dmp_subchanged(barsubs, &rcxt->ads);
 		}
 		showbars();
 	}
@@ -276,48 +292,10 @@ int setbar(struct dmprcxt_s *rcxt, const uint8_t *bp)
 */
 int subscribebar(struct dmprcxt_s *rcxt, const uint8_t *bp)
 {
-	struct Lchannel_s *evchan;
-	int i;
 	struct adspec_s offs;
 
 	if (addr2ofs(rcxt->dprop, &rcxt->ads, &offs) < 0) return -1;
-
-	if (evcxt) {
-		evchan = evcxt->dest;
-	} else {
-		evcxt = acnNew(struct dmptcxt_s);
-		evchan = openChannel(CHF_NOCLOSE, NULL);  /* use default parameters */
-
-		if (evchan == NULL) {
-			free(evcxt);
-			evcxt = NULL;
-			acnlogmark(lgNTCE, "Unable to open event channel");
-			return -1;
-		}
-		evcxt->wflags = WRAP_ALL_MEMBERS /* | WRAP_REL_ON */;
-		evcxt->dest = evchan;
-	}
-
-	/*
-	request the connection - sync event gets sent when we get a callback
-	(in dd_sdtev()) to say connection is made.
-	*/
-	i = addMember(evchan, ((struct member_s *)rcxt->src)->rem.Rcomp);
-	if (i < 0) return i;
-	return offs.count;
-}
-/**********************************************************************/
-void
-drop_subscriber(struct member_s *memb)
-{
-	struct Lchannel_s *evchan = (struct Lchannel_s *)evcxt->dest;
-
-	drop_member(memb, SDT_REASON_NONSPEC);
-	if (evchan->membercount == 0) {
-		closeChannel(evchan);
-		free(evcxt);
-		evcxt = NULL;
-	}
+	return dmp_rxsubscribe(rcxt, bp);
 }
 /**********************************************************************/
 int unsubscribebar(struct dmprcxt_s *rcxt, const uint8_t *bp)
@@ -325,8 +303,7 @@ int unsubscribebar(struct dmprcxt_s *rcxt, const uint8_t *bp)
 	struct adspec_s offs;
 
 	if (addr2ofs(rcxt->dprop, &rcxt->ads, &offs) < 0) return -1;
-	drop_subscriber((struct member_s *)rcxt->src);
-	return offs.count;
+	return dmp_rxunsubscribe(rcxt, bp);
 }
 /**********************************************************************/
 static void
@@ -383,26 +360,13 @@ void dd_sdtev(int event, void *object, void *info)
 	switch (event) {
 	case EV_RCONNECT:  /* object = Lchan, info = memb */
 	case EV_LCONNECT:  /* object = Lchan, info = memb */
-	{
-		struct Lchannel_s *Lchan = (struct Lchannel_s *)object;
-
-		if (evcxt && evcxt->dest == Lchan) { 
-			/* new connection in event channel */
-			struct adspec_s offs = {0, 1, DIM_bargraph__0};
-			struct adspec_s dmpads = {DMP_bargraph.addr, INC_bargraph__0, DIM_bargraph__0};
-	
-			declare_bars(evcxt, &dmpads, &offs, DMP_SYNC_EVENT);
-			dmp_flushpdus(evcxt);
-		}
-	}	break;
+		/* new connection in an event channel gets sync events */
+		dmp_subconnect((struct Lchannel_s *)object, (struct member_s *)info);
+		break;
 	case EV_REMDISCONNECT:  /* object = Lchan, info = memb */
-	{
-		struct member_s *memb = (struct member_s *)info;
-		struct Lchannel_s *Lchan = (struct Lchannel_s *)object;
-
-		if (evcxt && evcxt->dest == Lchan) drop_subscriber(memb);
-	}	break;
 	case EV_LOCDISCONNECT:  /* object = Lchan, info = memb */
+		dmp_subdisconnect((struct Lchannel_s *)object, (struct member_s *)info);
+		break;
 	case EV_DISCOVER:  /* object = Rcomp, info = discover data in packet */
 	case EV_JOINSUCCESS:  /* object = Lchan, info = memb */
 	case EV_JOINFAIL:  /* object = Lchan, info = memb->rem.Rcomp */
@@ -473,13 +437,12 @@ bar_Y(int y)
 	if (v != barvals[ix]) {
 		barvals[ix] = v;
 	
-		if (evcxt) {
+		if (barsubs) {
 			struct adspec_s dmpads;
 			struct adspec_s offs = {ix, 1, 1};
 	
 			ofs2addr(&DMP_bargraph, &offs, &dmpads);
-			declare_bars(evcxt, &dmpads, &offs, DMP_EVENT);
-			dmp_flushpdus(evcxt);
+			dmp_subchanged(barsubs, &dmpads);
 		}
 	}
 }
@@ -713,6 +676,10 @@ run_device(const char *uuidstr, uint16_t port, const char **interfaces)
 	/* prepare DMP */
 	if (dmp_register() < 0) {
 		acnlogerror(lgERR);
+	} else if ((barsubs = dmp_newsubreg(&DMP_bargraph, &getbarval, NULL,
+											EV_INTERVAL_ms)) == NULL)
+	{
+		acnlogerror(lgERR);
 	} else if (sdt_register(&dd_sdtev, &listenaddr, ADHOCJOIN_ANY) < 0) {
 		acnlogerror(lgERR);
 	} else {
@@ -731,6 +698,7 @@ run_device(const char *uuidstr, uint16_t port, const char **interfaces)
 			termrestore();
 			slp_deregister();
 		}
+		dmp_freesubreg(barsubs);
 		sdt_deregister();
 	}
 	uacn_close();
@@ -119,6 +119,7 @@ is not valic C code.
 #endif
 
 @_CF_MARSHAL_INLINE CF_MARSHAL_INLINE
+@_CF_MARSHAL_SIMD CF_MARSHAL_SIMD
 @_CF_STRICT_CHECKS CF_STRICT_CHECKS
 @_CF_MULTI_COMPONENT CF_MULTI_COMPONENT
 @_CF_ACN_FCTN_SIZE ACN_FCTN_SIZE
@@ -171,6 +172,11 @@ is not valic C code.
 @_CF_SDT_MAX_CLIENT_PROTOCOLS CF_SDT_MAX_CLIENT_PROTOCOLS
 @_CF_SDTRX_AUTOCALL CF_SDTRX_AUTOCALL
 @_CF_SDT_CHECK_ASSOC CF_SDT_CHECK_ASSOC
+@_CF_SDT_JOINQ_SIZE CF_SDT_JOINQ_SIZE
+@_CF_SDT_JOINQ_BATCH CF_SDT_JOINQ_BATCH
+@_CF_SDT_JOINQ_TICK_ms CF_SDT_JOINQ_TICK_ms
+@_CF_SDT_KEEPALIVE_TICK_ms CF_SDT_KEEPALIVE_TICK_ms
+@_CF_SDT_KEEPALIVE_SLACK CF_SDT_KEEPALIVE_SLACK
 #if CF_SDT_MAX_CLIENT_PROTOCOLS == 1
 @_CF_SDT_CLIENTPROTO CF_SDT_CLIENTPROTO
 #if CF_SDT_CLIENTPROTO == DMP_PROTOCOL_ID
@@ -214,6 +220,9 @@ is not valic C code.
 #endif
 #if CF_DMPON_TCP
 @_CF_DMPON_TCP 1
+@_CF_DMPTCP_BLOCKSIZE CF_DMPTCP_BLOCKSIZE
+@_CF_DMPTCP_MAXIOV CF_DMPTCP_MAXIOV
+@_CF_DMPTCP_MAXQUEUE CF_DMPTCP_MAXQUEUE
 #else
 @_CF_DMPON_TCP 0
 #endif
@@ -225,6 +234,10 @@ is not valic C code.
 
 @_CF_DMP_RMAXCXNS CF_DMP_RMAXCXNS
 @_CF_PROPEXT_FNS CF_PROPEXT_FNS
+@_CF_DMPMAP_GENFN CF_DMPMAP_GENFN
+@_CF_DMP_RMIRROR CF_DMP_RMIRROR
+@_CF_DMP_MIRRORDIRTY CF_DMP_MIRRORDIRTY
+@_CF_DMP_REQTRACK CF_DMP_REQTRACK
 #else
 @_CF_DMP 0
 #endif
@@ -234,13 +247,28 @@ is not valic C code.
 @_CF_EXPAT_BUILTIN CF_EXPAT_BUILTIN
 @_CF_DDLACCESS_DMP CF_DDLACCESS_DMP
 @_CF_DDLACCESS_EPI26 CF_DDLACCESS_EPI26
+@_CF_DMPMAP_PAGEBITS CF_DMPMAP_PAGEBITS
+@_CF_DMPMAP_MEMBUDGET CF_DMPMAP_MEMBUDGET
+@_CF_DMPMAP_HITMAX CF_DMPMAP_HITMAX
 @_CF_DDL_BEHAVIORS CF_DDL_BEHAVIORS
 @_CF_DDL_IMMEDIATEPROPS CF_DDL_IMMEDIATEPROPS
 @_CF_DDL_STRINGS CF_DDL_STRINGS
+@_CF_DDL_LAZYSTRINGS CF_DDL_LAZYSTRINGS
 @_CF_DDL_MAXNEST CF_DDL_MAXNEST
 @_CF_STR_FOLDSPACE CF_STR_FOLDSPACE
 @_CF_DDL_MAXTEXT CF_DDL_MAXTEXT
+@_CF_DDL_THREADS CF_DDL_THREADS
+@_CF_DDL_MMAP CF_DDL_MMAP
+@_CF_DDL_INDEX CF_DDL_INDEX
+@_CF_DDL_FETCH CF_DDL_FETCH
+@_CF_DDL_FETCHMAX CF_DDL_FETCHMAX
+@_CF_TFTP_BLKSIZE CF_TFTP_BLKSIZE
+@_CF_TFTP_WINDOW CF_TFTP_WINDOW
+@_CF_TFTP_TIMEOUT CF_TFTP_TIMEOUT
+@_CF_TFTP_RETRIES CF_TFTP_RETRIES
+@_CF_DDL_TREEBUDGET CF_DDL_TREEBUDGET
 @_CF_MAPGEN CF_MAPGEN
+@_CF_DDL_CACHE CF_DDL_CACHE
 #else
 @_CF_DDL 0
 #endif
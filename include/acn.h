@@ -82,6 +82,8 @@ the configuration.
 #include "ddlparse.h"
 #include "behaviors.h"
 #include "ddlresolve.h"
+#include "ddlcache.h"
+#include "ddlfetch.h"
 #endif
 
 #if CF_DMP
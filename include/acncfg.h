@@ -276,11 +276,21 @@ necessary. This also applies to E1.31 ‘Streaming ACN’.
 	If you do not want to compile inline, then setting this false 
 	uses macros instead, but these evaluate their arguments multiple 
 	times and do not check their types so beware.
+
+	CF_MARSHAL_SIMD - Use vector instructions for bulk marshalling
+
+	The bulk array functions in marshal.c use SSE2, AVX2 or NEON 
+	byte swapping where the compiler target supports them. Set this 
+	false to force the portable code.
 */
 #ifndef CF_MARSHAL_INLINE
 #define CF_MARSHAL_INLINE 1
 #endif
 
+#ifndef CF_MARSHAL_SIMD
+#define CF_MARSHAL_SIMD 1
+#endif
+
 /**********************************************************************/
 /*
 	macros: Error Checking
@@ -497,6 +507,30 @@ default is set below
 	is entirely redundant and this implementation has no need of it. 
 	It sets it appropriately on transmit but only checks on receive 
 	if this macro is true.
+
+	CF_SDT_JOINQ_SIZE - Length of the admission queue for cold 
+	(unsolicited) joins. Rather than allocating channels and members 
+	and sending JoinAccept as each cold join arrives, joins are queued 
+	and admitted in batches from the event loop. When the queue is 
+	full further cold joins are refused with reason "resources" and 
+	the remote will retry later. This smooths out join storms when 
+	many components start together. Set to 0 to process every join 
+	immediately. See <sdt_joinqstats>.
+
+	CF_SDT_JOINQ_BATCH - Maximum number of queued joins admitted on 
+	each pass.
+
+	CF_SDT_JOINQ_TICK_ms - Interval between admission passes. Zero 
+	admits the next batch on the next pass through the event loop.
+
+	CF_SDT_KEEPALIVE_TICK_ms - Keepalive deadlines for local channels 
+	are aligned to a shared grid of this interval so that idle 
+	channels fall due together and are serviced in a single wakeup. 
+	Set to 0 to time each channel's keepalive independently.
+
+	CF_SDT_KEEPALIVE_SLACK - The maximum amount, as a percentage of 
+	the keepalive interval, by which a keepalive may be brought 
+	forward to align with a tick. A keepalive is never delayed.
 */
 
 #ifndef CF_SDT
@@ -515,6 +549,26 @@ default is set below
 #define CF_SDT_CHECK_ASSOC 0
 #endif
 
+#ifndef CF_SDT_JOINQ_SIZE
+#define CF_SDT_JOINQ_SIZE 32
+#endif
+
+#ifndef CF_SDT_JOINQ_BATCH
+#define CF_SDT_JOINQ_BATCH 8
+#endif
+
+#ifndef CF_SDT_JOINQ_TICK_ms
+#define CF_SDT_JOINQ_TICK_ms 0
+#endif
+
+#ifndef CF_SDT_KEEPALIVE_TICK_ms
+#define CF_SDT_KEEPALIVE_TICK_ms 200
+#endif
+
+#ifndef CF_SDT_KEEPALIVE_SLACK
+#define CF_SDT_KEEPALIVE_SLACK 25
+#endif
+
 /**********************************************************************/
 /*
 	macros: DMP
@@ -569,11 +623,31 @@ default is set below
 	protocols. e.g. SDT and TCP
 	CF_DMP_MULTITRANSPORT
 	CF_DMPON_SDT - Include SDT transport support
-	CF_DMPON_TCP - Include TCP transport support
+	CF_DMPON_TCP - Include TCP transport support. This also carries 
+	DMP over Unix domain stream sockets (see <dmp_tcpopen>).
+
+	CF_DMPTCP_BLOCKSIZE - Largest DMP PDU block (including its 
+	framing) sent or accepted on a stream connection.
+	CF_DMPTCP_MAXIOV - Maximum blocks written in one writev() call.
+	CF_DMPTCP_MAXQUEUE - Maximum blocks queued for transmission on 
+	one stream connection before new blocks are refused.
 
 	CF_DMP_RMAXCXNS - Number of connections to/from the same 
 	remote component. These take space in the component structure 
 	for each remote.
+
+	CF_DMP_RMIRROR - Controllers only. Support a mirror of remote 
+	property values which is updated directly from get-property 
+	replies and events (see <dmp_newmirror>).
+
+	CF_DMP_MIRRORDIRTY - Maximum number of separate dirty address 
+	ranges a mirror records between polls. Further changes are merged 
+	into the nearest range.
+
+	CF_DMP_REQTRACK - Controllers only. Support tracking of 
+	get-property requests to remote components with a window of 
+	outstanding requests and timeouts (see <dmp_newreqtrk>). Requires 
+	<CF_EVLOOP>.
 */
 
 #ifndef CF_DMP
@@ -635,7 +709,6 @@ default is set below
 #endif
 
 #ifndef CF_DMPON_TCP
-/* currently unsupported though there are some hooks */
 #define CF_DMPON_TCP (!CF_DMPON_SDT)
 #endif
 
@@ -651,6 +724,32 @@ default is set below
 #define CF_PROPEXT_FNS 0
 #endif
 
+#ifndef CF_DMP_RMIRROR
+#define CF_DMP_RMIRROR 1
+#endif
+
+#ifndef CF_DMP_MIRRORDIRTY
+#define CF_DMP_MIRRORDIRTY 16
+#endif
+
+#ifndef CF_DMP_REQTRACK
+#define CF_DMP_REQTRACK CF_EVLOOP
+#endif
+
+#if CF_DMPON_TCP
+#ifndef CF_DMPTCP_BLOCKSIZE
+#define CF_DMPTCP_BLOCKSIZE 4096
+#endif
+
+#ifndef CF_DMPTCP_MAXIOV
+#define CF_DMPTCP_MAXIOV 32
+#endif
+
+#ifndef CF_DMPTCP_MAXQUEUE
+#define CF_DMPTCP_MAXQUEUE 256
+#endif
+#endif  /* CF_DMPON_TCP */
+
 #endif  /* CF_DMP */
 
 /**********************************************************************/
@@ -673,9 +772,45 @@ default is set below
 	CF_DDL_BEHAVIORS - Parse and apply DDL behaviors
 	CF_DDL_IMMEDIATEPROPS - Parse and record values for immediate 
 	properties.
+	CF_DDL_LAZYSTRINGS - Do not parse the languagesets referenced by 
+	labels while parsing a device. Each set is parsed the first time 
+	one of its labels is looked up by <lblookup()>. Needs 
+	CF_DDL_STRINGS.
 	CF_DDL_MAXNEST - Maximum XML nesting level within a single 
 	DDL module.
 	CF_DDL_MAXTEXT - Size allocated for parsing text nodes.
+	CF_DDL_THREADS - Number of worker threads which read and XML 
+	parse queued DDL modules ahead of the main parse. Zero parses each 
+	module in turn in the calling thread. Needs POSIX threads.
+	CF_DDL_MMAP - Map DDL module files into memory and parse them in a 
+	single pass instead of reading them through a buffer. Files which 
+	cannot be mapped (pipes, sockets) are still read.
+	CF_DDL_INDEX - Index the modules in each DDL path directory by 
+	UUID on first use so a module is opened without searching the path 
+	(see <Module index>). On Linux the index is kept current with 
+	inotify.
+	CF_DDL_FETCH - Fetch missing DDL from devices by TFTP as 
+	described by EPI-11 (see <ddlfetch.c>). Needs <CF_EVLOOP>.
+	CF_DDL_FETCHMAX - Maximum number of module transfers which run 
+	at once.
+	CF_TFTP_BLKSIZE - TFTP block size requested (RFC 2348).
+	CF_TFTP_WINDOW - TFTP window size requested (RFC 7440).
+	CF_TFTP_TIMEOUT - TFTP retransmission time in ms.
+	CF_TFTP_RETRIES - TFTP retransmissions before giving up.
+	CF_DDL_TREEBUDGET - Memory in bytes which shared device trees (see 
+	<getrootdev()>) may occupy before unused ones are freed.
+
+	CF_DMPMAP_PAGEBITS - Hybrid address maps (see <am_hybrid>) divide 
+	the address space into pages of 2^CF_DMPMAP_PAGEBITS addresses.
+	CF_DMPMAP_MEMBUDGET - Memory in bytes which the map builder may 
+	spend on direct index tables when choosing a map type.
+	CF_DMPMAP_HITMAX - Largest search region (in addresses) for which 
+	a hit table is built to replace property tests for sparse and 
+	overlapping arrays. Set to 0 to disable hit tables.
+	CF_DMPMAP_GENFN - The device's address map is a lookup function 
+	generated by mapgen -f (see <am_func>) and DMP calls it directly 
+	instead of going through <addr_to_prop()>. Only for devices with 
+	a single local device component whose map is addr_map.
 
 */
 
@@ -695,6 +830,22 @@ apply to the maps generated by mapgen.
 #define CF_DDLACCESS_EPI26  0
 #endif
 
+#ifndef CF_DMPMAP_PAGEBITS
+#define CF_DMPMAP_PAGEBITS 6
+#endif
+
+#ifndef CF_DMPMAP_MEMBUDGET
+#define CF_DMPMAP_MEMBUDGET 16384
+#endif
+
+#ifndef CF_DMPMAP_HITMAX
+#define CF_DMPMAP_HITMAX 4096
+#endif
+
+#ifndef CF_DMPMAP_GENFN
+#define CF_DMPMAP_GENFN 0
+#endif
+
 #ifndef CF_DDL_BEHAVIORS
 #define CF_DDL_BEHAVIORS   1
 #endif
@@ -707,6 +858,10 @@ apply to the maps generated by mapgen.
 #define CF_DDL_STRINGS   1
 #endif
 
+#ifndef CF_DDL_LAZYSTRINGS
+#define CF_DDL_LAZYSTRINGS   0
+#endif
+
 #ifndef CF_DDL_MAXNEST
 #define CF_DDL_MAXNEST 256
 #endif
@@ -722,6 +877,46 @@ big
 #define CF_DDL_MAXTEXT 512
 #endif
 
+#ifndef CF_DDL_THREADS
+#define CF_DDL_THREADS 0
+#endif
+
+#ifndef CF_DDL_MMAP
+#define CF_DDL_MMAP 1
+#endif
+
+#ifndef CF_DDL_INDEX
+#define CF_DDL_INDEX 0
+#endif
+
+#ifndef CF_DDL_FETCH
+#define CF_DDL_FETCH 0
+#endif
+
+#ifndef CF_DDL_FETCHMAX
+#define CF_DDL_FETCHMAX 8
+#endif
+
+#ifndef CF_TFTP_BLKSIZE
+#define CF_TFTP_BLKSIZE 1428
+#endif
+
+#ifndef CF_TFTP_WINDOW
+#define CF_TFTP_WINDOW 8
+#endif
+
+#ifndef CF_TFTP_TIMEOUT
+#define CF_TFTP_TIMEOUT 1000
+#endif
+
+#ifndef CF_TFTP_RETRIES
+#define CF_TFTP_RETRIES 5
+#endif
+
+#ifndef CF_DDL_TREEBUDGET
+#define CF_DDL_TREEBUDGET (4 * 1024 * 1024)
+#endif
+
 /*
 macro: CF_MAPGEN
 
@@ -731,6 +926,21 @@ Enable static map generation extensions
 #define CF_MAPGEN 0
 #endif
 
+/*
+macro: CF_DDL_CACHE
+
+Save each device tree parsed by <parseroot()> as a binary image 
+keyed by DCID and load it from there next time instead of parsing 
+(see <ddlcache.c>). The image holds raw structures so is only 
+usable by a build with the same configuration. Not available with 
+EPI26 access or map generation whose trees hold pointers which 
+cannot be saved.
+*/
+#ifndef CF_DDL_CACHE
+#define CF_DDL_CACHE (CF_DDL && CF_DDLACCESS_DMP \
+						&& !CF_DDLACCESS_EPI26 && !CF_MAPGEN)
+#endif
+
 #if CF_DDL
 
 #endif /* CF_DDL */
@@ -877,6 +1087,10 @@ definitions) and sanity checks for some illegal configurations.
 #error "DMP component: set exactly 1 of CF_DMPCOMP_CD CF_DMPCOMP_C_ CF_DMPCOMP__D"
 #endif
 
+#if CF_DDL_FETCH && !CF_EVLOOP
+#error "CF_DDL_FETCH needs CF_EVLOOP"
+#endif
+
 #if CF_MULTI_COMPONENT
 #define ifMC(...) __VA_ARGS__
 #define ifnMC(...)
@@ -101,6 +101,9 @@ struct slp_Rcomp_s {
 	char *fctn;
 	char *uacn;
 	uint8_t *dcid;
+#if CF_DDL_FETCH
+	char *ddlurl;  /* first fetchable device-description */
+#endif
 	acnTimer_t slpValidT;
 };
 
@@ -0,0 +1,46 @@
+/**********************************************************************/
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2026, the Acacian contributors.
+
+This file forms part of Acacian a full featured implementation of 
+ANSI E1.17 Architecture for Control Networks (ACN)
+
+#tabs=3
+*/
+/**********************************************************************/
+/*
+header: ddlcache.h
+
+Binary cache of parsed device trees. Header for <ddlcache.c>
+*/
+
+#ifndef __ddlcache_h__
+#define __ddlcache_h__ 1
+
+#if CF_DDL_CACHE
+/*
+type: ddlsrc_s
+
+Record of a DDL module file read while parsing a root device. The
+list of these is saved with the tree so a cached image can be
+checked against its sources.
+*/
+struct ddlsrc_s {
+	struct ddlsrc_s *nxt;
+	uint64_t size;
+	int64_t mtime;
+	ddlchar_t name[];
+};
+
+int ddlcache_addsrc(struct ddlsrc_s **srcs, const ddlchar_t *name, int fd);
+void ddlcache_freesrcs(struct ddlsrc_s *srcs);
+struct rootdev_s *ddlcache_load(const ddlchar_t *name);
+int ddlcache_save(struct rootdev_s *root, const struct ddlsrc_s *srcs);
+void ddlcache_free(struct rootdev_s *root);
+#endif  /* CF_DDL_CACHE */
+
+#endif  /* __ddlcache_h__ */
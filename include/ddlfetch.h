@@ -0,0 +1,38 @@
+/**********************************************************************/
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2026, the Acacian contributors.
+
+This file forms part of Acacian a full featured implementation of
+ANSI E1.17 Architecture for Control Networks (ACN)
+
+#tabs=3
+*/
+/**********************************************************************/
+/*
+header: ddlfetch.h
+
+Retrieval of DDL from devices by TFTP (EPI-11). Header for
+<ddlfetch.c>
+*/
+
+#ifndef __ddlfetch_h__
+#define __ddlfetch_h__ 1
+
+#if CF_DDL_FETCH
+/*
+type: ddlfetch_fn
+
+Called when a fetch started by <ddlfetch()> has finished. err is 0
+if every module which was requested has been fetched, otherwise it
+is the errno value for the first one which failed.
+*/
+typedef void ddlfetch_fn(const uint8_t *dcid, int err, void *ref);
+
+int ddlfetch(const uint8_t *dcid, const char *url, ddlfetch_fn *donefn, void *ref);
+#endif  /* CF_DDL_FETCH */
+
+#endif  /* __ddlfetch_h__ */
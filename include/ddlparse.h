@@ -98,9 +98,66 @@ const ddlchar_t *pool_addstr(struct pool_s *pool, const ddlchar_t *s);
 const ddlchar_t *pool_termstr(struct pool_s *pool);
 const ddlchar_t *pool_addstrn(struct pool_s *pool, const ddlchar_t *s, int n);
 const ddlchar_t *pool_addfoldsp(struct pool_s *pool, const ddlchar_t *s);
+size_t pool_memsize(const struct pool_s *pool);
 /* can't currently delete a single string */
 #define pool_delstr(pool, str)
 
+/**********************************************************************/
+/*
+type: arena_s
+
+Bump allocator for objects which are all freed together (see 
+<keys.c>). A zeroed arena_s is empty.
+*/
+union arenaalign_u {
+	long long ll;
+	double d;
+	void *p;
+};
+
+struct ablock_s;
+
+struct arena_s {
+	uint8_t *ptr;
+	uint8_t *endp;
+	struct ablock_s *blocks;
+	size_t size;
+};
+
+void *arena_alloc(struct arena_s *arena, size_t size);
+void arena_reset(struct arena_s *arena);
+
+/*
+func: arena_allocx
+
+Allocate from an arena or exit on failure as <mallocx()>.
+*/
+static inline void *
+arena_allocx(struct arena_s *arena, size_t size)
+{
+	void *m;
+
+	if ((m = arena_alloc(arena, size)) == NULL) {
+		acnlogerror(lgCRIT);
+		exit(EXIT_FAILURE);
+	}
+	return m;
+}
+
+/*
+func: arena_allocxz
+
+Allocate and zero memory from an arena or exit on failure.
+*/
+static inline void *
+arena_allocxz(struct arena_s *arena, size_t size)
+{
+	return memset(arena_allocx(arena, size), 0, size);
+}
+
+#define arenaNew(arena, type) \
+			((__typeof__(type) *)arena_allocxz((arena), sizeof(type)))
+
 /**********************************************************************/
 #define MAX_REFINES 6
 
@@ -184,6 +241,10 @@ struct language_s {  /* hash as "@en-GB"? */
 	unsigned int nkeys;
 };
 
+/*
+With CF_DDL_LAZYSTRINGS languages is NULL until the set has been 
+parsed and nlangs is set to LSET_FAILED if it could not be.
+*/
 struct lset_s {
 	uint8_t uuid[UUID_SIZE];
 	struct hashtab_s hasht;
@@ -191,6 +252,8 @@ struct lset_s {
 	int16_t nlangs;
 	int16_t userlang;
 };
+
+#define LSET_FAILED (-1)
 #endif
 /**********************************************************************/
 /*
@@ -385,12 +448,21 @@ __prop_iter:\
 /**********************************************************************/
 /*
 rootprop is the root of a device component and includes some extra
-information
+information. The property tree, DMP properties, parameters and 
+immediate value arrays are allocated from arena and are all freed 
+together by <freerootdev()>. If the tree was loaded from the binary 
+cache then cache is the mapped image containing it (see 
+<ddlcache.c>).
+
+Trees shared through <getrootdev()> are counted by usecount and 
+linked in least recently used order by lru. memsize is the 
+approximate memory held by the tree.
 */
 struct rootdev_s {
 	uint8_t dcid[UUID_SIZE];
 	struct ddlprop_s *ddlroot;
 	struct pool_s strpool;
+	struct arena_s arena;
 	struct hashtab_s idtab;
 #if CF_DDLACCESS_DMP
 	union addrmap_u *amap;
@@ -400,6 +472,13 @@ struct rootdev_s {
 	uint32_t maxaddr;
 	uint32_t minaddr;
 #endif
+#if CF_DDL_CACHE
+	void *cache;
+	size_t cachesize;
+#endif
+	unsigned int usecount;
+	size_t memsize;
+	dlLink(struct rootdev_s, lru);
 };
 
 /**********************************************************************/
@@ -426,6 +505,8 @@ void *add_devtask(struct dcxt_s *dcxp, devtask_fn *task, size_t size);
 /**********************************************************************/
 
 struct qentry_s;  /* defined in parse.c */
+struct ddlsrc_s;  /* defined in ddlcache.h */
+struct ddlworkers_s;  /* defined in parse.c */
 
 #define BV_MAXREFINES 32
 #define PROP_MAXBVS 32
@@ -444,6 +525,10 @@ struct dcxt_s {
 	tok_t elprev;
 	int elcount;
 	XML_Parser parser;
+#if CF_DDL_THREADS
+	struct ddlworkers_s *workers;
+	bool wanttext;
+#endif
 	int txtlen;
 	union {
 		const ddlchar_t *p;
@@ -454,6 +539,9 @@ struct dcxt_s {
 	int naliases;
 	struct uuidalias_s aliases[MAXALIASES];
 	struct devtask_s *tasks;
+#if CF_DDL_CACHE
+	struct ddlsrc_s *srcs;
+#endif
 	unsigned int arraytotal;
 	struct rootdev_s *rootdev;
 	unsigned int subdevno;
@@ -488,13 +576,17 @@ struct dcxt_s {
 #define SKIPON(dcxp) ((dcxp)->skip = (dcxp)->nestlvl)
 
 /**********************************************************************/
-extern struct uuidset_s langsets;
+extern struct uuidset_s languagesets;
 extern struct uuidset_s behaviorsets;
 extern struct uuidset_s devtrees;
+extern struct pool_s permpool;
 /**********************************************************************/
 
 struct rootdev_s *parseroot(const char *dcidstr);
 void freerootdev(struct rootdev_s *root);
+struct rootdev_s *findrootdev(const uint8_t *dcid);
+struct rootdev_s *getrootdev(const uint8_t *dcid);
+void droprootdev(struct rootdev_s *root);
 char *flagnames(uint32_t flags, const char **names, char *buf, const char *format);
 struct ddlprop_s *itsdevice(struct ddlprop_s *prop);
 const ddlchar_t *resolveuuid(struct dcxt_s *dcxp, const ddlchar_t *name, uint8_t *dcid);
@@ -24,6 +24,13 @@ UUID to DDL file resolver. Header for <resolve.c>
 #define __resolve_h__ 1
 
 int openpath(const char *path, const char *name, const char *exts);
+int openddl(const ddlchar_t *name);
 int openddlx(ddlchar_t *name);
+char *gethomedir(void);
+const char *getddlpath(char *buf, size_t size);
+#if CF_DDL_MMAP
+const void *mapddl(int fd, size_t *sizep);
+void unmapddl(const void *map, size_t size);
+#endif
 
 #endif  /* __resolve_h__ */
@@ -298,6 +298,10 @@ Includes:
 
 union addrmap_u *amap - Required if local component is a controller 
 (<CF_DMPCOMP_C_> or <CF_DMPCOMP_CD>), otherwise omitted.
+struct dmp_mirror_s *mirror - Optional mirror of the component's 
+property values (controllers with <CF_DMP_RMIRROR> only).
+struct dmp_reqtrk_s *reqtrk - Optional get-property request tracker 
+(controllers with <CF_DMP_REQTRACK> only).
 unsigned int ncxns - Number of connections we have to this component.
 void *cxns[] - Array of connection identifiers (depends on DMP's 
 transport, see <CF_DMP_MULTITRANSPORT>).
@@ -305,6 +309,12 @@ transport, see <CF_DMP_MULTITRANSPORT>).
 struct dmp_Rcomp_s {
 #if CF_DMPCOMP_Cx
 	union addrmap_u *amap;
+#if CF_DMP_RMIRROR
+	struct dmp_mirror_s *mirror;
+#endif
+#if CF_DMP_REQTRACK
+	struct dmp_reqtrk_s *reqtrk;
+#endif
 #endif
 	unsigned int ncxns;
 	void *cxns[CF_DMP_RMAXCXNS];
@@ -337,6 +347,10 @@ a device may accumulate set-property-fail responses for some
 properties in the context of the controller's session whilst 
 generating event messages in it's own event session for properties 
 whose value has been successfully changed.
+
+For SDT, dest is a member or (with WRAP_ALL_MEMBERS) a local 
+channel. For stream connections dest is a <dmp_tcpcxn_s> and the 
+context must be initialized by <dmp_tcptcxt>.
 */
 struct dmptcxt_s {
 	void *dest;  /* who to send to */
@@ -346,6 +360,12 @@ struct dmptcxt_s {
 	uint8_t *endp;
 	uint16_t wflags;
 	struct txwrap_s *txwrap;
+#if CF_DMPON_TCP
+	struct dmp_tcpblk_s *txblk;
+#endif
+#if CF_DMP_MULTITRANSPORT
+	uint8_t tcp;  /* dest is a stream connection */
+#endif
 };
 
 struct dmprcxt_s {
@@ -353,10 +373,21 @@ struct dmprcxt_s {
 	uint8_t hdr;
 	const struct dmpprop_s *dprop;
 	struct adspec_s ads;
-	void *src;  /* who received from (a member_s if CF_DMPON_SDT) */
+	void *src;  /* who received from (member_s or dmp_tcpcxn_s) */
+#if CF_DMP_MULTITRANSPORT
+	uint8_t tcp;  /* src is a stream connection */
+#endif
 	union addrmap_u *amap;
+	uint32_t *ixs;  /* array indexes of ads.addr in tree order, or NULL */
 	uint32_t lastaddr;
+	const uint8_t *endp;  /* end of the current PDU's data */
 	dmprx_fn *rxfn;
+#if CF_DMPCOMP_Cx && CF_DMP_RMIRROR
+	struct dmp_mirror_s *mirror;
+#endif
+#if CF_DMPCOMP_Cx && CF_DMP_REQTRACK
+	struct dmp_reqtrk_s *reqtrk;
+#endif
 #if CF_DMPCOMP_xD
 	/* if a device most received commands are likely to need a response */
 	struct dmptcxt_s rspcxt;
@@ -456,6 +487,214 @@ nxtp the end of the accumulated data.
 */
 void dmp_truncatepdu(struct dmptcxt_s *tcxt, uint32_t count, uint8_t *nxtp);
 
+/*
+type: dmpval_s
+
+One property value for <dmp_setprops> or <dmp_events>.
+
+addr - the DMP address of the property.
+size - number of bytes in data.
+data - the value, already marshaled in network order. For variable 
+size properties this includes the two byte length prefix.
+*/
+struct dmpval_s {
+	uint32_t addr;
+	int size;
+	const uint8_t *data;
+};
+
+/*
+func: dmp_setprops
+
+Add set-property messages for a list of (address, value) pairs to 
+the transmit context, using the smallest PDU stream available.
+
+The list is sorted into address order (in place) and split into runs 
+of equally sized values whose addresses increase by a constant 
+increment. Each run is sent as one range address PDU and if every 
+value in a run is the same the common value form is used. Address 
+size, relative addressing, new blocks and new wrappers are all 
+handled automatically. As with other transmit functions the 
+accumulated PDUs are not sent until <dmp_flushpdus> is called.
+
+Returns the number of PDUs generated or -1 on error.
+*/
+int dmp_setprops(struct dmptcxt_s *tcxt, struct dmpval_s *vals, int count);
+
+/*
+func: dmp_events
+
+As <dmp_setprops> but generates event messages.
+*/
+int dmp_events(struct dmptcxt_s *tcxt, struct dmpval_s *vals, int count);
+
+#if CF_DMPCOMP_xD && CF_EVLOOP
+/**********************************************************************/
+/*
+group: Event coalescing
+
+A device whose properties change faster than subscribers need to 
+see them can route changes through an event publisher. Each change 
+just marks the address dirty. A flush is scheduled no sooner than 
+interval_ms after the previous one, so a burst of changes to the 
+same property produces one event carrying the latest value, and 
+changes to neighbouring properties are packed into range PDUs by 
+<dmp_events>.
+
+A publisher covers one contiguous address window and sends to one 
+transmit context, so where subscribers want different minimum 
+intervals create a publisher per subscriber (or per group of 
+subscribers sharing a transmit context).
+
+type: evval_fn
+
+Callback to fetch the current value of a property at flush time.
+Marshal the value at addr into buf (which has room for the size 
+given to <dmp_newevpub>) and return its length, or return -1 to 
+omit the address from this flush.
+*/
+typedef int evval_fn(void *ref, uint32_t addr, uint8_t *buf);
+
+/*
+type: dmp_evpub_s
+
+Event publisher state. Fields are private - use the functions below.
+*/
+struct dmp_evpub_s {
+	struct dmptcxt_s *tcxt;
+	uint32_t base;
+	uint32_t span;
+	unsigned int size;
+	evval_fn *getval;
+	void *ref;
+	unsigned int interval_ms;
+	uint32_t lastflush;
+	acnTimer_t timer;
+	unsigned int ndirty;
+	uint32_t dirty[];
+};
+
+/*
+func: dmp_newevpub
+
+Create a publisher for addresses base to base + span - 1 sending to 
+tcxt. size is the largest marshaled value getval can return. Returns 
+NULL on error.
+*/
+struct dmp_evpub_s *dmp_newevpub(struct dmptcxt_s *tcxt, uint32_t base,
+						uint32_t span, unsigned int size, evval_fn *getval,
+						void *ref, unsigned int interval_ms);
+
+/*
+func: dmp_freeevpub
+
+Cancel any pending flush and free the publisher. Unsent changes are 
+discarded.
+*/
+void dmp_freeevpub(struct dmp_evpub_s *pub);
+
+/*
+func: dmp_evdirty
+
+Mark the addresses in ads as changed. Addresses outside the 
+publisher's window are ignored.
+*/
+void dmp_evdirty(struct dmp_evpub_s *pub, const struct adspec_s *ads);
+
+/*
+func: dmp_evflush
+
+Send events for all dirty addresses now. This is called from the 
+publisher's timer but may also be called directly. Returns the number 
+of PDUs generated or -1 on error.
+*/
+int dmp_evflush(struct dmp_evpub_s *pub);
+
+#if CF_DMPON_SDT
+/**********************************************************************/
+/*
+group: Subscriber registry
+
+Built in handling of subscriptions for a property (or property 
+array). Subscribers to overlapping sets of addresses share a local 
+event channel, so each event is sent once per group of interested 
+components and never to a channel with no interested members. Each 
+channel has its own event publisher so changes are coalesced as 
+described above.
+
+To use, create a registry for the property with <dmp_newsubreg>, 
+call <dmp_rxsubscribe> and <dmp_rxunsubscribe> from the property's 
+subscribe and unsubscribe handlers (or install them directly), pass 
+SDT connect and disconnect events to <dmp_subconnect> and 
+<dmp_subdisconnect>, and call <dmp_subchanged> whenever values change.
+
+type: dmp_subreg_s
+
+Registry state. This is opaque to the application.
+*/
+struct dmp_subreg_s;
+
+/*
+func: dmp_newsubreg
+
+Create a subscriber registry for dprop. Values are read using 
+getval when events are sent and events to any one channel are sent 
+no more often than interval_ms.
+*/
+struct dmp_subreg_s *dmp_newsubreg(const struct dmpprop_s *dprop,
+						evval_fn *getval, void *ref, unsigned int interval_ms);
+
+/*
+func: dmp_freesubreg
+
+Drop all subscribers, close their event channels and free the 
+registry.
+*/
+void dmp_freesubreg(struct dmp_subreg_s *reg);
+
+/*
+func: dmp_rxsubscribe
+
+Receive handler for DMP_SUBSCRIBE which adds the sender to the 
+registry for rcxt->dprop. The sender is added to an event channel 
+and sync events are sent once it has connected.
+
+func: dmp_rxunsubscribe
+
+Receive handler for DMP_UNSUBSCRIBE. When a subscriber has no 
+addresses left it is dropped from its event channel.
+*/
+int dmp_rxsubscribe(struct dmprcxt_s *rcxt, const uint8_t *bp);
+int dmp_rxunsubscribe(struct dmprcxt_s *rcxt, const uint8_t *bp);
+
+/*
+func: dmp_subconnect
+
+Call on EV_LCONNECT or EV_RCONNECT. If Lchan is a registry event 
+channel, sends sync events to the new member and returns true, 
+otherwise returns false.
+
+func: dmp_subdisconnect
+
+Call on EV_REMDISCONNECT or EV_LOCDISCONNECT. If Lchan is a registry 
+event channel, the subscriber is removed and true is returned, 
+otherwise returns false.
+*/
+bool dmp_subconnect(struct Lchannel_s *Lchan, struct member_s *memb);
+bool dmp_subdisconnect(struct Lchannel_s *Lchan, struct member_s *memb);
+
+/*
+func: dmp_subchanged
+
+Notify the registry that the values at ads have changed. Events are 
+scheduled on each channel with members interested in any of them.
+*/
+void dmp_subchanged(struct dmp_subreg_s *reg, const struct adspec_s *ads);
+
+#endif  /* CF_DMPON_SDT */
+
+#endif  /* CF_DMPCOMP_xD && CF_EVLOOP */
+
 /**********************************************************************/
 /*
 group: Receive functions
@@ -475,5 +714,318 @@ provided message handlers [rxvec in <dmp_Lcomp_s>].
 */
 void dmp_sdtRx(struct member_s *memb, const uint8_t *pdus, int blocksize, void *ref);
 
+#if CF_DMPON_TCP
+/**********************************************************************/
+/*
+group: Stream transport
+
+DMP may be carried over TCP or Unix domain stream sockets between 
+trusted processes, e.g. a controller and a gateway on the same host. 
+There is no SDT session, sequencing or acknowledgement - the stream 
+provides reliable ordered delivery. Each DMP PDU block on the stream 
+is preceded by its length as a four octet network order value.
+
+Blocks flushed by <dmp_flushpdus> are queued on the connection and 
+written with a single writev() call when the event loop next finds 
+the socket writable, so all the blocks generated while handling one 
+batch of events leave in one system call.
+
+Received blocks are handled exactly as those received over SDT except 
+that rcxt->src is the <dmp_tcpcxn_s>.
+
+type: dmp_tcpblk_s
+
+A block queued for transmission, with its length prefix.
+
+type: dmp_tcpcxn_s
+
+A stream connection. Fields are private - use the functions below.
+*/
+struct dmp_tcpblk_s {
+	struct dmp_tcpblk_s *nxt;
+	unsigned int len;  /* bytes used including the length prefix */
+	uint8_t data[CF_DMPTCP_BLOCKSIZE];
+};
+
+struct dmp_tcpcxn_s;
+
+/*
+type: dmptcp_close_fn
+
+Called when a connection is closed by the remote end or by an error. 
+The connection is freed on return.
+*/
+typedef void dmptcp_close_fn(struct dmp_tcpcxn_s *cxn, void *ref);
+
+struct dmp_tcpcxn_s {
+	poll_fn *pollfn;  /* must be first */
+	int fd;
+	uint32_t events;
+	unsigned int flags;
+#if CF_MULTI_COMPONENT
+	struct Lcomponent_s *Lcomp;
+#endif
+	struct Rcomponent_s *Rcomp;
+	dmptcp_close_fn *closefn;
+	void *ref;
+	struct dmp_tcpblk_s *txq;
+	struct dmp_tcpblk_s **txqtail;
+	unsigned int nq;
+	unsigned int txofs;  /* bytes of txq already written */
+	struct dmp_tcpblk_s *freeblks;
+	unsigned int rxlen;
+	uint8_t rxbuf[2 * CF_DMPTCP_BLOCKSIZE];
+};
+
+/*
+func: dmp_tcpopen
+
+Start DMP on a connected stream socket fd, e.g. one returned by 
+accept(), between Lcomp and Rcomp. The socket is made non-blocking 
+and registered with the event loop and the connection is added to 
+Rcomp's connections. closefn (which may be NULL) is called with ref 
+if the connection fails or is closed remotely.
+
+Returns the new connection or NULL on error (fd is not closed). It 
+is an error (EMFILE) if Rcomp already has CF_DMP_RMAXCXNS connections.
+*/
+struct dmp_tcpcxn_s *dmp_tcpopen(ifMC(struct Lcomponent_s *Lcomp,)
+						struct Rcomponent_s *Rcomp, int fd,
+						dmptcp_close_fn *closefn, void *ref);
+
+/*
+func: dmp_tcpconnect
+
+Create a stream socket, connect it to addr (which may be an 
+AF_INET, AF_INET6 or AF_UNIX address) and open it as <dmp_tcpopen>.
+*/
+struct dmp_tcpcxn_s *dmp_tcpconnect(ifMC(struct Lcomponent_s *Lcomp,)
+						struct Rcomponent_s *Rcomp,
+						const struct sockaddr *addr, socklen_t addrlen,
+						dmptcp_close_fn *closefn, void *ref);
+
+/*
+func: dmp_tcpclose
+
+Write any queued blocks that the socket will take without blocking, 
+then close the socket and free the connection. closefn is not 
+called. May be called from within a receive handler.
+*/
+void dmp_tcpclose(struct dmp_tcpcxn_s *cxn);
+
+/*
+func: dmp_tcptcxt
+
+Initialize a transmit context to send to a stream connection.
+*/
+void dmp_tcptcxt(struct dmptcxt_s *tcxt, struct dmp_tcpcxn_s *cxn);
+
+#endif  /* CF_DMPON_TCP */
+
+
+#if CF_DMPCOMP_Cx && CF_DMP_RMIRROR
+/**********************************************************************/
+/*
+group: Remote property mirror
+
+A controller may keep a mirror of the property values of a remote 
+component. The mirror holds the most recent value of every property 
+in the component's address map in a single buffer and is updated 
+directly from get-property replies, events and sync events as they 
+are received, so the application can poll for changes instead of 
+handling each message.
+
+If a mirror is attached, the application's receive functions for 
+those vectors are optional. If present they are still called after 
+the mirror has been updated.
+
+type: dmp_range_s
+
+An inclusive range of DMP addresses.
+
+type: dmp_mirror_s
+
+Mirror state. gen is incremented on every update so a cheap 
+comparison tells whether anything has changed since the last poll. 
+Other fields are private.
+*/
+struct dmp_range_s {
+	uint32_t lo;
+	uint32_t hi;
+};
+
+struct mirprop_s {
+	const struct dmpprop_s *dprop;
+	size_t ofs;           /* offset of first slot in buf */
+	unsigned int slot;    /* bytes per slot */
+	uint32_t nslots;      /* one per array element */
+};
+
+struct dmp_mirror_s {
+	uint32_t gen;
+	union addrmap_u *amap;
+	unsigned int nprops;
+	struct mirprop_s *props;
+	uint8_t *buf;
+	size_t bufsize;
+	unsigned int ndirty;
+	struct dmp_range_s dirty[CF_DMP_MIRRORDIRTY];
+};
+
+/*
+func: dmp_newmirror
+
+Create a mirror for Rcomp using its address map (Rcomp->dmp.amap 
+must already be set) and attach it to the component.
+
+Each property gets one slot per array element, numbered in dimension 
+order, so sparse and interleaved arrays take no space for the 
+addresses between their elements. Self-overlapping arrays, whose 
+elements share addresses, get one slot per address in their span 
+instead. Variable size properties keep their two byte length prefix and have room for 
+their declared maximum size. Values are network byte order exactly as 
+received.
+*/
+struct dmp_mirror_s *dmp_newmirror(struct Rcomponent_s *Rcomp);
+
+/*
+func: dmp_freemirror
+
+Detach and free the mirror of Rcomp (if any).
+*/
+void dmp_freemirror(struct Rcomponent_s *Rcomp);
+
+/*
+func: dmp_mirrorval
+
+Return a pointer to the mirrored value at addr and put its size in 
+*sizep. For variable size properties the pointer is past the length 
+prefix. Returns NULL if addr is not in the map.
+*/
+const uint8_t *dmp_mirrorval(struct dmp_mirror_s *mir, uint32_t addr,
+								unsigned int *sizep);
+
+/*
+func: dmp_mirrorchanges
+
+Copy up to max ranges of addresses changed since the last call into 
+ranges, then clear the record. Returns the number copied.
+*/
+int dmp_mirrorchanges(struct dmp_mirror_s *mir, struct dmp_range_s *ranges,
+							int max);
+
+#define dmp_mirrorgen(mir) ((mir)->gen)
+
+#endif  /* CF_DMPCOMP_Cx && CF_DMP_RMIRROR */
+
+#if CF_DMPCOMP_Cx && CF_DMP_REQTRACK
+/**********************************************************************/
+/*
+group: Request tracking
+
+A controller may route get-property requests to a remote component 
+through a request tracker attached to the component.
+
+Requests are queued by <dmp_reqget> and sent by <dmp_reqflush>. 
+Queued requests are sorted by address and neighbours are merged into 
+range PDUs. No more than window requests are outstanding at once - 
+the rest are sent as earlier ones complete. A request completes when 
+every address in it has been answered by a get-property reply or 
+fail, or when timeout_ms has passed since it was sent.
+
+The application's receive functions (or the mirror) still handle the 
+replies as usual - the tracker only counts off the addresses answered.
+
+type: dmpreq_fn
+
+Request completion callback. status is 0 if every address was 
+answered by a reply, the DMP reason code of the first failure, or 
+DMPREQ_TIMEOUT or DMPREQ_CANCEL.
+
+type: dmp_reqtrk_s
+
+Tracker state. Fields are private - use the functions below.
+*/
+#define DMPREQ_TIMEOUT (-1)
+#define DMPREQ_CANCEL (-2)
+
+typedef void dmpreq_fn(struct Rcomponent_s *Rcomp, const struct adspec_s *ads,
+								int status, void *ref);
+
+struct dmp_req_s {
+	struct dmp_req_s *nxt;
+	struct adspec_s ads;
+	uint32_t left;      /* addresses not yet answered */
+	int status;
+	uint32_t deadline;  /* ms */
+	void *ref;
+	uint32_t answered[];  /* one bit per address in ads */
+};
+
+enum reqtrkflg_e {
+	RT_STALLED = 1,     /* last flush failed */
+	RT_INCALLBACK = 2,  /* completion callbacks in progress */
+	RT_FREED = 4,       /* freed from a callback */
+};
+
+struct dmp_reqtrk_s {
+	struct Rcomponent_s *Rcomp;
+	struct dmptcxt_s *tcxt;
+	dmpreq_fn *donefn;
+	unsigned int window;
+	unsigned int timeout_ms;
+	unsigned int nsent;
+	struct dmp_req_s *pending;  /* sorted by address */
+	struct dmp_req_s *sent;     /* oldest first */
+	struct dmp_req_s **senttail;
+	acnTimer_t timer;
+	unsigned int flags;
+};
+
+/*
+func: dmp_newreqtrk
+
+Create a tracker for requests to Rcomp, sent using tcxt, and attach 
+it to the component. donefn is called as each request completes.
+*/
+struct dmp_reqtrk_s *dmp_newreqtrk(struct Rcomponent_s *Rcomp,
+						struct dmptcxt_s *tcxt, unsigned int window,
+						unsigned int timeout_ms, dmpreq_fn *donefn);
+
+/*
+func: dmp_freereqtrk
+
+Detach and free the tracker of Rcomp (if any). Outstanding and queued 
+requests complete with DMPREQ_CANCEL.
+*/
+void dmp_freereqtrk(struct Rcomponent_s *Rcomp);
+
+/*
+func: dmp_reqget
+
+Queue a get-property request for the addresses in ads. ref is passed 
+to donefn on completion. Returns 0 on success or -1 on error.
+*/
+int dmp_reqget(struct dmp_reqtrk_s *trk, const struct adspec_s *ads, void *ref);
+
+/*
+func: dmp_reqgetall
+
+Queue requests to read every readable property in the component's 
+address map - one request per property, or per row of the innermost 
+dimension for sparse arrays. Returns the number of requests queued 
+or -1 on error.
+*/
+int dmp_reqgetall(struct dmp_reqtrk_s *trk, void *ref);
+
+/*
+func: dmp_reqflush
+
+Send as many queued requests as the window allows. Returns the 
+number of requests sent or -1 on error.
+*/
+int dmp_reqflush(struct dmp_reqtrk_s *trk);
+
+#endif  /* CF_DMPCOMP_Cx && CF_DMP_REQTRACK */
 
 #endif /* __dmp_h__ */
@@ -142,9 +142,13 @@ enum: maptype_e
 am_none - no map or unspecified map.
 am_srch - a map optimized for binary search
 am_indx - a direct lookup map; fast but only suitable for certain devices
+am_hybrid - a page directory where each page of addresses is looked 
+up by the cheapest method that fits a memory budget.
+am_func - a lookup function generated by mapgen for a single device 
+(see <CF_DMPMAP_GENFN>).
 */
 
-enum maptype_e {am_none = 0, am_srch, am_indx};
+enum maptype_e {am_none = 0, am_srch, am_indx, am_hybrid, am_func};
 
 struct addrfind_s;
 /*
@@ -161,19 +165,37 @@ address search>. The search strategy divides the address space into
 a linear sorted array of regions defined by an upper and lower 
 address bound within which one or more properties occur.
 
-addrfind_s - a single element of the srch_amap_s search table.
+addrfind_s - a single element of the srch_amap_s search table. 
+Regions which need tests may have a hit table with one byte per 
+address in the region: zero for no property, one for p.prop or 
+n for p.pa[n - 1] (see <buildhittables>).
 
 indx_amap_s - linear vector address map for direct property lookup. The
 fastest address lookup type but only practical with few properties with
 closely grouped addresses.
+
+hybr_amap_s - two level map for large devices with widely spaced 
+address blocks. The address space is divided into pages of 
+2^<CF_DMPMAP_PAGEBITS> addresses and the directory has one <hpage_s> 
+per page. Each page is empty, a direct index array, a single property 
+with no holes, or a short list of regions from the original search 
+table (which is kept in srch). Index arrays are only allocated for 
+the pages which need them most until <CF_DMPMAP_MEMBUDGET> is used.
+
+hpage_s - a single page of the hybrid map directory.
+
+func_amap_s - a map with no tables, only a function which finds the 
+property for an address. These are generated by mapgen -f and compiled 
+into devices.
 */
 
 /*
 Each type in the union contains the first two elements, type and 
 size, in the same order so they are invariant with map type. The 
-third element is also always the pointer to the map array, but its 
-target type differs depending on map type. Size is always the size 
-of the allocated map block in bytes.
+third element is also always the pointer to the map array (or for 
+am_func the lookup function), but its target type differs depending 
+on map type. Size is always the size of the allocated map block in 
+bytes.
 */
 
 struct any_amap_s {
@@ -206,12 +228,55 @@ struct indx_amap_s{
 	uint32_t base;
 };
 
+enum hpagetype_e {hp_none = 0, hp_indx, hp_prop, hp_srch};
+
+struct hpage_s {
+	uint16_t type;
+	uint32_t count;  /* number of regions for hp_srch - up to HPAGE_SIZE */
+	union {
+		struct dmpprop_s **pa;
+		struct dmpprop_s *prop;
+		struct addrfind_s *af;
+	} p;
+};
+
+struct hybr_amap_s {
+	uint8_t dcid[UUID_SIZE];
+	enum maptype_e type;
+	size_t size;
+	struct hpage_s *map;
+	uint16_t flags;
+	uint16_t maxdims;
+	uint32_t npages;
+	uint32_t base;
+	struct addrfind_s *srch;
+	uint32_t srchcount;
+};
+
+typedef const struct dmpprop_s *findprop_fn(uint32_t addr);
+
+struct func_amap_s {
+	uint8_t dcid[UUID_SIZE];
+	enum maptype_e type;
+	size_t size;
+	findprop_fn *fn;
+	uint16_t flags;
+	uint16_t maxdims;
+	const struct dmpprop_s *const *props;  /* sorted by address */
+	uint32_t nprops;
+};
+
 union addrmap_u {
 	struct any_amap_s any;
 	struct indx_amap_s indx;
 	struct srch_amap_s srch;
+	struct hybr_amap_s hybr;
+	struct func_amap_s func;
 };
 
+#define HPAGE_SIZE ((uint32_t)1 << CF_DMPMAP_PAGEBITS)
+#define HPAGE_MASK (HPAGE_SIZE - 1)
+
 struct addrfind_s {
 	uint32_t adlo;   /* lowest address of the region */
 	uint32_t adhi;   /* highest address */
@@ -220,6 +285,7 @@ struct addrfind_s {
 		struct dmpprop_s *prop;
 		struct dmpprop_s **pa;
 	} p;
+	uint8_t *hits;   /* hit table or NULL */
 };
 
 #define maplength(amapp, _type_) (amapp->any.size / sizeof(*amapp->_type_.map))
@@ -228,9 +294,22 @@ struct addrfind_s {
 prototypes
 */
 const struct dmpprop_s *addr_to_prop(union addrmap_u *amap, uint32_t addr);
+const struct dmpprop_s *addr_to_proprun(union addrmap_u *amap,
+						const struct adspec_s *ads, uint32_t *countp, uint32_t *indexes);
+const struct dmpprop_s *proprun(const struct dmpprop_s *prop,
+						const struct adspec_s *ads, uint32_t *countp, uint32_t *indexes);
+bool propmatch(const struct dmpprop_s *p, uint32_t addr);
 void freeamap(union addrmap_u *amap);
+const struct dmpprop_s **amap_proplist(union addrmap_u *amap, unsigned int *countp);
 void indexprop(struct dmpprop_s *prop, struct dmpprop_s **imap, int dimx, uint32_t ad);
 void xformtoindx(union addrmap_u *amap);
+void xformtohybrid(union addrmap_u *amap, size_t budget);
+void buildhittables(union addrmap_u *amap);
+enum maptype_e choosemap(union addrmap_u *amap, size_t budget);
+#if CF_DMPMAP_GENFN
+/* generated by mapgen -f */
+findprop_fn addr_map_find;
+#endif
 //void fillindexes(const struct dmpprop_s *prop, struct adspec_s *ads, uint32_t *indexes);
 
 #endif /*  __dmpmap_h__       */
@@ -48,6 +48,20 @@ evl_register(int fd, poll_fn **cb, uint32_t events)
 	evs.data.ptr = cb;
 	return epoll_ctl(evl_pollfd, i, fd, &evs);
 }
+
+/*
+Change the events wanted on a file descriptor which is already 
+registered.
+*/
+static inline int
+evl_modify(int fd, poll_fn **cb, uint32_t events)
+{
+	struct epoll_event evs;
+
+	evs.events = events;
+	evs.data.ptr = cb;
+	return epoll_ctl(evl_pollfd, EPOLL_CTL_MOD, fd, &evs);
+}
 #endif  /* defined(__linux__) || defined(__linux) */
 
 /**********************************************************************/
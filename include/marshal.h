@@ -211,6 +211,37 @@ static macros for marshalling into arrays
 #define stmarshal16(x) (((x) >> 8) & 0xff), ((x) & 0xff)
 #define stmarshal32(x) (((x) >> 24) & 0xff), (((x) >> 16) & 0xff), (((x) >> 8) & 0xff), ((x) & 0xff)
 
+/*
+Bulk marshalling of arrays (see marshal.c)
+
+Each copies count values between network order data and a host 
+array, returning a pointer to the data following them. The stride 
+versions access every inc'th element of the host array, matching 
+the inc of a DMP address range.
+*/
+uint8_t *marshalU8array(uint8_t *data, const uint8_t *src, unsigned int count);
+uint8_t *marshalU16array(uint8_t *data, const uint16_t *src, unsigned int count);
+uint8_t *marshalU32array(uint8_t *data, const uint32_t *src, unsigned int count);
+const uint8_t *unmarshalU8array(const uint8_t *data, uint8_t *dest, unsigned int count);
+const uint8_t *unmarshalU16array(const uint8_t *data, uint16_t *dest, unsigned int count);
+const uint8_t *unmarshalU32array(const uint8_t *data, uint32_t *dest, unsigned int count);
+
+uint8_t *marshalU8stride(uint8_t *data, const uint8_t *src, unsigned int inc, unsigned int count);
+uint8_t *marshalU16stride(uint8_t *data, const uint16_t *src, unsigned int inc, unsigned int count);
+uint8_t *marshalU32stride(uint8_t *data, const uint32_t *src, unsigned int inc, unsigned int count);
+const uint8_t *unmarshalU8stride(const uint8_t *data, uint8_t *dest, unsigned int inc, unsigned int count);
+const uint8_t *unmarshalU16stride(const uint8_t *data, uint16_t *dest, unsigned int inc, unsigned int count);
+const uint8_t *unmarshalU32stride(const uint8_t *data, uint32_t *dest, unsigned int inc, unsigned int count);
+
+#define marshal16array(data, src, count) marshalU16array(data, (const uint16_t *)(src), count)
+#define marshal32array(data, src, count) marshalU32array(data, (const uint32_t *)(src), count)
+#define unmarshal16array(data, dest, count) unmarshalU16array(data, (uint16_t *)(dest), count)
+#define unmarshal32array(data, dest, count) unmarshalU32array(data, (uint32_t *)(dest), count)
+#define marshal16stride(data, src, inc, count) marshalU16stride(data, (const uint16_t *)(src), inc, count)
+#define marshal32stride(data, src, inc, count) marshalU32stride(data, (const uint32_t *)(src), inc, count)
+#define unmarshal16stride(data, dest, inc, count) unmarshalU16stride(data, (uint16_t *)(dest), inc, count)
+#define unmarshal32stride(data, dest, inc, count) unmarshalU32stride(data, (uint32_t *)(dest), inc, count)
+
 
 #ifdef __cplusplus
 }
@@ -266,6 +266,17 @@ Macros to interface to client structures
 #define BADPROTO(proto) ((proto) == 0)
 #endif
 
+/************************************************************************/
+/*
+type: sesspkt_s
+
+A ready built Sessions packet held in the local component's cache.
+*/
+struct sesspkt_s {
+	uint8_t              *txbuf;
+	int                  length;
+};
+
 /************************************************************************/
 /*
 type: sdt_Lcomp_s
@@ -283,6 +294,10 @@ struct sdt_Lcomp_s {
 	struct Lchannel_s    *Lchannels;
 	uint8_t              flags;
 	uint16_t             lastChanNo;
+	/* cached Sessions PDUs for GetSessions requests */
+	struct sesspkt_s     *sessions;
+	unsigned int         nsesspkts;
+	unsigned int         sessspace;
 #if CF_SDT_MAX_CLIENT_PROTOCOLS == 1
 	struct sdt_client_s  client;
 #else
@@ -385,6 +400,12 @@ struct Rchannel_s {
 	uint8_t             NAKtries;
 #if CF_MULTI_COMPONENT
 	struct member_s            *members;
+	/* index of local members by MID for dispatch of incoming PDUs */
+	struct member_s            **midmap;
+	unsigned int               midspace;
+	/* members with MIDs too high for midmap, sorted by MID */
+	struct member_s            **midhi;
+	unsigned int               nmidhi;
 #endif
 };
 
@@ -529,8 +550,18 @@ for each wrapper we create a tracking structure rxwrap_s. These are
 stored before initial processing (if they arrive out of order) and when
 queued for application, in a doubly linked list in sequence order with
 newest at the head and oldest at the tail.
+
+Client protocol PDUs are located when the wrapper is first parsed
+(SDT's own PDUs are processed at that point) and recorded in pdus
+so the wrapper does not need to be parsed again for dispatch.
 */
 
+struct rxpdu_s {
+	const uint8_t      *data;
+	int                size;
+	uint16_t           mid;
+};
+
 struct rxwrap_s {
 	dlLink(struct rxwrap_s, lnk);
 	struct rxbuf_s     *rxbuf;
@@ -541,6 +572,8 @@ struct rxwrap_s {
 	int32_t            Rseq;
 	int                length;
 	bool               reliable;
+	unsigned int       npdus;
+	struct rxpdu_s     *pdus;
 };
 
 /************************************************************************/
@@ -664,6 +697,14 @@ disconnecting and leaving messages.
 */
 void drop_member(struct member_s *memb, uint8_t reason);
 
+/*
+func: findMember
+
+Find the member of a local channel belonging to a remote component. 
+Returns NULL if Rcomp is not currently a member of Lchan.
+*/
+struct member_s *findMember(struct Lchannel_s *Lchan, struct Rcomponent_s *Rcomp);
+
 /*
 func: sdt_addClient
 
@@ -688,6 +729,38 @@ De-register a client protocol from the SDT layer.
 */
 void sdt_dropClient(ifMC(struct Lcomponent_s *Lcomp));
 
+#if CF_SDT_JOINQ_SIZE > 0
+/*
+type: sdt_joinqstats_s
+
+Join admission queue statistics [<CF_SDT_JOINQ_SIZE>].
+
+	depth - Number of cold joins currently waiting for admission.
+	maxdepth - High water mark of depth.
+	queued - Total joins accepted into the queue.
+	admitted - Total joins taken from the queue and processed.
+	refused - Total joins refused because the queue was full.
+	repeats - Total repeated joins discarded because an identical
+	request was already queued.
+*/
+struct sdt_joinqstats_s {
+	unsigned int depth;
+	unsigned int maxdepth;
+	unsigned long queued;
+	unsigned long admitted;
+	unsigned long refused;
+	unsigned long repeats;
+};
+
+/*
+func: sdt_joinqstats
+
+Return a pointer to the join admission queue statistics. The
+structure is updated in place as joins are queued and admitted.
+*/
+const struct sdt_joinqstats_s *sdt_joinqstats(void);
+#endif
+
 /*
 group: SDT transmit functions
 */
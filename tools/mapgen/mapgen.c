@@ -54,8 +54,12 @@ const char dfltcfilename[] = "devicemap.c";
 
 const char srcharrayname[] = "findprop_array";
 const char overarrayname[] = "testprop_array";
+const char hitarrayname[] = "hittable_array";
 const char addrmapname[] = "addr_map";
 const char indxarrayname[] = "property_index";
+const char pagearrayname[] = "property_page";
+const char pagedirname[] = "page_directory";
+const char findfnname[] = "addr_map_find";
 
 #define PPX "DMP_"
 
@@ -390,16 +394,17 @@ printprops(struct ddlprop_s *prop)
 func: printtests
 
 Print the extra array of property pointers needed where multiple
-properties interleave in an address range.
+properties interleave in an address range, and the hit tables for 
+regions which have them (see <buildhittables>).
 */
 static void
-printtests(struct srch_amap_s *smap)
+printtests(struct addrfind_s *map, uint32_t count)
 {
 	struct addrfind_s *af;
 	int overp = 0;
 
 	LOG_FSTART();
-	for (af = smap->map; af < smap->map + smap->count; ++af) {
+	for (af = map; af < map + count; ++af) {
 		if (af->ntests > map_max_tests) map_max_tests = af->ntests;
 		if (af->ntests > 1) {
 			int i;
@@ -414,36 +419,71 @@ printtests(struct srch_amap_s *smap)
 	}
 	if (overp > 0)
 		fprintf(cfile, "};\n\n");
+
+	overp = 0;
+	for (af = map; af < map + count; ++af) {
+		uint32_t i;
+
+		if (af->hits == NULL) continue;
+		if (overp == 0)
+			fprintf(cfile, "uint8_t %s[] = {", hitarrayname);
+		for (i = 0; i <= af->adhi - af->adlo; ++i, ++overp) {
+			fprintf(cfile, (overp % 16) ? " %u," : "\n\t%u,", af->hits[i]);
+		}
+	}
+	if (overp > 0)
+		fprintf(cfile, "\n};\n\n");
 	LOG_FEND();
 }
 
 /**********************************************************************/
 /*
-func: printsrchmap
+func: printregions
 
-Print an addrmap structure in the generic search map format (<srch_amap_s>).
+Print the region table of a search map (an array of <addrfind_s>).
 */
 static void
-printsrchmap(struct srch_amap_s *smap)
+printregions(struct addrfind_s *map, uint32_t count)
 {
 	struct addrfind_s *af;
 	int i;
 	int overp = 0;
-	char dcidb[DCID_BIN_SIZE];
+	uint32_t hitp = 0;
 
 	LOG_FSTART();
 	fprintf(cfile, "struct addrfind_s %s[] = {\n", srcharrayname);
-	for (i = 0, af = smap->map; i < smap->count; ++i, ++af) {
+	for (i = 0, af = map; i < count; ++i, ++af) {
 		fprintf(cfile, "\t{.adlo = %u, .adhi = %u, .ntests = %i, .p = {",
 				af->adlo, af->adhi, af->ntests);
 		if (af->ntests < 2) {
-			fprintf(cfile, ".prop = &" PPX "%s}},\n", propcname(af->p.prop->prop));
+			fprintf(cfile, ".prop = &" PPX "%s}", propcname(af->p.prop->prop));
 		} else {
-			fprintf(cfile, ".pa = %s + %d}},\n", overarrayname, overp);
+			fprintf(cfile, ".pa = %s + %d}", overarrayname, overp);
 			overp += af->ntests;
 		}
+		if (af->hits) {
+			fprintf(cfile, ", .hits = %s + %u},\n", hitarrayname, hitp);
+			hitp += af->adhi - af->adlo + 1;
+		} else {
+			fprintf(cfile, "},\n");
+		}
 	}
 	fprintf(cfile, "};\n\n");
+	LOG_FEND();
+}
+/**********************************************************************/
+/*
+func: printsrchmap
+
+Print an addrmap structure in the generic search map format (<srch_amap_s>).
+*/
+static void
+printsrchmap(struct srch_amap_s *smap)
+{
+	char dcidb[DCID_BIN_SIZE];
+
+	LOG_FSTART();
+	printregions(smap->map, smap->count);
 	fprintf(cfile,
 		"union addrmap_u %s = {.srch = {\n"
 		"\t.dcid = %s,\n"
@@ -516,15 +556,279 @@ printindxmap(struct indx_amap_s *imap)
 	LOG_FEND();
 }
 
+/**********************************************************************/
+/*
+func: printhybrmap
+
+Print an addrmap structure in the hybrid page map format 
+(<hybr_amap_s>).
+*/
+static void
+printhybrmap(struct hybr_amap_s *hmap)
+{
+	struct hpage_s *hp;
+	uint32_t i, j;
+	char dcidb[DCID_BIN_SIZE];
+
+	LOG_FSTART();
+	printtests(hmap->srch, hmap->srchcount);
+	printregions(hmap->srch, hmap->srchcount);
+	for (i = 0, hp = hmap->map; i < hmap->npages; ++i, ++hp) {
+		if (hp->type != hp_indx) continue;
+		fprintf(cfile, "struct dmpprop_s *%s_%u[] = {\n", pagearrayname, i);
+		for (j = 0; j < HPAGE_SIZE; ++j) {
+			if (hp->p.pa[j]) {
+				fprintf(cfile, "\t&" PPX "%s,\n", propcname(hp->p.pa[j]->prop));
+			} else {
+				fputs("\tNULL,\n", cfile);
+			}
+		}
+		fprintf(cfile, "};\n\n");
+	}
+	fprintf(cfile, "struct hpage_s %s[] = {\n", pagedirname);
+	for (i = 0, hp = hmap->map; i < hmap->npages; ++i, ++hp) {
+		switch (hp->type) {
+		case hp_indx:
+			fprintf(cfile, "\t{.type = hp_indx, .p = {.pa = %s_%u}},\n",
+					pagearrayname, i);
+			break;
+		case hp_prop:
+			fprintf(cfile, "\t{.type = hp_prop, .p = {.prop = &" PPX "%s}},\n",
+					propcname(hp->p.prop->prop));
+			break;
+		case hp_srch:
+			fprintf(cfile, "\t{.type = hp_srch, .count = %u, .p = {.af = %s + %u}},\n",
+					hp->count, srcharrayname, (unsigned int)(hp->p.af - hmap->srch));
+			break;
+		default:
+			fputs("\t{.type = hp_none},\n", cfile);
+			break;
+		}
+	}
+	fprintf(cfile, "};\n\n");
+	fprintf(cfile,
+		"union addrmap_u %s = {.hybr = {\n"
+		"\t.dcid = %s,\n"
+		"\t.type = am_hybrid,\n"
+		"\t.size = 0,\n"
+		"\t.map = %s,\n"
+		"\t.flags = 0x%04x,\n"
+		"\t.maxdims = %u,\n"
+		"\t.npages = %u,\n"
+		"\t.base = %u,\n"
+		"\t.srch = %s,\n"
+		"\t.srchcount = %u,\n"
+		"}};\n\n"
+		, addrmapname, dcid_lit(hmap->dcid, dcidb), pagedirname, 
+		hmap->flags, hmap->maxdims, hmap->npages, hmap->base,
+		srcharrayname, hmap->srchcount);
+	fprintf(hfile,
+			"\n"
+			"#define MAP_TYPE am_hybrid\n"
+			"#define MAP_HAS_OVERLAP %u\n"
+			"#define MAP_MAX_DIMS %u\n"
+			"#define MAP_MAX_TESTS %u\n"
+			"extern union addrmap_u %s;\n"
+			, (hmap->flags & pflg(overlap)) != 0, hmap->maxdims, map_max_tests, addrmapname);	
+	LOG_FEND();
+}
+
+/**********************************************************************/
+/*
+func: printmatchfn
+
+Print a match function for a sparse array property which is not 
+self-overlapping. This is <propmatch()> with the dimensions of the 
+property folded in as constants. The argument is the offset of the 
+address from the property's base address.
+*/
+static void
+printmatchfn(const struct dmpprop_s *np)
+{
+	const struct dmpdim_s *dp;
+	uint32_t lim;
+	uint32_t top;
+	int i;
+
+	fprintf(cfile,
+		"static inline bool\n"
+		"match_%s(uint32_t a0)\n"
+		"{\n"
+		"\tif (a0 >= %u) return false;\n",
+		propcname(np->prop), np->span);
+	lim = np->span;
+	for (i = 0, dp = np->dim; i < np->ndims; ++i, ++dp) {
+		top = dp->inc * dp->cnt;
+		if (top < lim) fprintf(cfile, "\tif (a0 >= %u) return false;\n", top);
+		if (i == np->ndims - 1) {
+			if (dp->inc == 1) fputs("\treturn true;\n", cfile);
+			else fprintf(cfile, "\treturn a0 %% %i == 0;\n", dp->inc);
+		} else {
+			fprintf(cfile, 
+				"\ta0 %%= %i;\n"
+				"\tif (a0 == 0) return true;\n",
+				dp->inc);
+			lim = dp->inc;
+		}
+	}
+	fputs("}\n\n", cfile);
+}
+
+/**********************************************************************/
+/*
+func: matchtest
+
+Print the C condition for an address matching a property within a 
+region which needs tests.
+*/
+static void
+matchtest(const struct dmpprop_s *np)
+{
+	const char *cname = propcname(np->prop);
+
+	if (np->ndims == 0)
+		fprintf(cfile, "addr == %u", np->addr);
+	else if (np->flags & pflg(packed))
+		fprintf(cfile, "addr - %u < %u", np->addr, np->span);
+	else if (np->flags & pflg(overlap))
+		fprintf(cfile, "propmatch(&" PPX "%s, addr)", cname);
+	else
+		fprintf(cfile, "match_%s(addr - %u)", cname, np->addr);
+}
+
+/**********************************************************************/
+/*
+func: printfindnode
+
+Recursively print a binary decision tree over count regions starting 
+at af. Addresses reaching this node are known to be in the range 
+lo..hi - 1 so bounds already tested higher up the tree are omitted.
+*/
+#define tabs(n) ((int)(n)), "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"
+
+static void
+printfindnode(struct addrfind_s *af, uint32_t count, uint64_t lo, uint64_t hi,
+					int depth)
+{
+	uint32_t mid;
+	int i;
+
+	if (count > 1) {
+		mid = count / 2;
+		fprintf(cfile, "%.*sif (addr < %u) {\n", tabs(depth), af[mid].adlo);
+		printfindnode(af, mid, lo, af[mid].adlo, depth + 1);
+		fprintf(cfile, "%.*s}\n", tabs(depth));
+		printfindnode(af + mid, count - mid, af[mid].adlo, hi, depth);
+		return;
+	}
+	if (lo < af->adlo && hi > (uint64_t)af->adhi + 1)
+		fprintf(cfile, "%.*sif (addr < %u || addr > %u) return NULL;\n",
+					tabs(depth), af->adlo, af->adhi);
+	else if (lo < af->adlo)
+		fprintf(cfile, "%.*sif (addr < %u) return NULL;\n", tabs(depth), af->adlo);
+	else if (hi > (uint64_t)af->adhi + 1)
+		fprintf(cfile, "%.*sif (addr > %u) return NULL;\n", tabs(depth), af->adhi);
+
+	switch (af->ntests) {
+	case 0:
+		fprintf(cfile, "%.*sreturn &" PPX "%s;\n", tabs(depth),
+					propcname(af->p.prop->prop));
+		break;
+	case 1:
+		fprintf(cfile, "%.*sreturn ", tabs(depth));
+		matchtest(af->p.prop);
+		fprintf(cfile, " ? &" PPX "%s : NULL;\n", propcname(af->p.prop->prop));
+		break;
+	default:
+		for (i = 0; i < af->ntests; ++i) {
+			fprintf(cfile, "%.*sif (", tabs(depth));
+			matchtest(af->p.pa[i]);
+			fprintf(cfile, ") return &" PPX "%s;\n", propcname(af->p.pa[i]->prop));
+		}
+		fprintf(cfile, "%.*sreturn NULL;\n", tabs(depth));
+		break;
+	}
+}
+
+/**********************************************************************/
+/*
+func: printfuncmap
+
+Print the address map as a lookup function specialized for this 
+device, and an addrmap structure of type <am_func> which points to it 
+(see <Address map type selection>).
+*/
+static void
+printfuncmap(struct srch_amap_s *smap)
+{
+	const struct dmpprop_s **props;
+	struct addrfind_s *af;
+	unsigned int n, i;
+	char dcidb[DCID_BIN_SIZE];
+
+	LOG_FSTART();
+	if ((props = amap_proplist((union addrmap_u *)smap, &n)) == NULL) n = 0;
+	for (i = 0; i < n; ++i) {
+		if (props[i]->ndims > 0 
+			&& (props[i]->flags & (pflg(packed) | pflg(overlap))) == 0)
+		{
+			printmatchfn(props[i]);
+		}
+	}
+	/* property list for amap_proplist() */
+	fputs("static const struct dmpprop_s *const map_props[] = {\n", cfile);
+	for (i = 0; i < n; ++i)
+		fprintf(cfile, "\t&" PPX "%s,\n", propcname(props[i]->prop));
+	if (n == 0) fputs("\tNULL\n", cfile);
+	fputs("};\n\n", cfile);
+	free(props);
+	for (af = smap->map; af < smap->map + smap->count; ++af) {
+		if (af->ntests > map_max_tests) map_max_tests = af->ntests;
+	}
+	fprintf(cfile,
+		"const struct dmpprop_s *\n"
+		"%s(uint32_t addr)\n"
+		"{\n",
+		findfnname);
+	if (smap->count == 0) fputs("\treturn NULL;\n", cfile);
+	else printfindnode(smap->map, smap->count, 0, (uint64_t)1 << 32, 1);
+	fputs("}\n\n", cfile);
+	fprintf(cfile,
+		"union addrmap_u %s = {.func = {\n"
+		"\t.dcid = %s,\n"
+		"\t.type = am_func,\n"
+		"\t.size = 0,\n"
+		"\t.fn = &%s,\n"
+		"\t.flags = 0x%04x,\n"
+		"\t.maxdims = %u,\n"
+		"\t.props = map_props,\n"
+		"\t.nprops = %u,\n"
+		"}};\n\n"
+		, addrmapname, dcid_lit(smap->dcid, dcidb), findfnname,
+		smap->flags, smap->maxdims, n);
+	fprintf(hfile,
+			"\n"
+			"#define MAP_TYPE am_func\n"
+			"#define MAP_HAS_OVERLAP %u\n"
+			"#define MAP_MAX_DIMS %u\n"
+			"#define MAP_MAX_TESTS %u\n"
+			"extern union addrmap_u %s;\n"
+			"const struct dmpprop_s *%s(uint32_t addr);\n"
+			, (smap->flags & pflg(overlap)) != 0, smap->maxdims, map_max_tests,
+			addrmapname, findfnname);
+	LOG_FEND();
+}
+
 /**********************************************************************/
 /*
 Program usage message.
 */
 const char usage_str[] = 
-"Usage: mapgen [ -h hfile ] [ -c cfile ] [-i hdr.h ] [-u] UUID\n"
+"Usage: mapgen [ -h hfile ] [ -c cfile ] [-i hdr.h ] [-f] [-u] UUID\n"
 "  hfile is name of .h output, (default 'devicemap.h')\n"
 "  cfile is name of .c output, (default 'devicemap.c')\n"
 "  each -i option generates '#include \"hdr.h\"' in the .c file\n"
+"  -f generates a lookup function instead of map tables\n"
 ;
 
 /*
@@ -552,10 +856,11 @@ func: main
 
 Main mapgen program.
 
-> Usage: mapgen [ -h hfile ] [ -c cfile ] [-i hdr.h ] [-u] UUID
+> Usage: mapgen [ -h hfile ] [ -c cfile ] [-i hdr.h ] [-f] [-u] UUID
 >   hfile is name of .h output, (default 'devicemap.h')
 >   cfile is name of .c output, (default 'devicemap.c')
 >   each -i option generates '#include \"hdr.h\"' in the .c file
+>   -f generates a lookup function instead of map tables
 
 - Parse command line arguments
 - Parse the root DCID and its subdevices to generate a property tree
@@ -580,6 +885,13 @@ index map has an entry for each element. The code here calculates
 the size of the index array that would be needed and transforms the map
 to index format if
 the size is ‘reasonable’.
+
+With -f no map tables are generated at all. Instead mapgen writes a 
+function addr_map_find() which is a binary decision tree over the 
+regions of the search map with the membership tests for sparse arrays 
+folded into constant arithmetic, and an <am_func> map which points to 
+it. A device built with <CF_DMPMAP_GENFN> calls this function directly 
+on receipt of each message.
 */
 int
 main(int argc, char *argv[])
@@ -591,11 +903,11 @@ main(int argc, char *argv[])
 	const char *cfilename = dfltcfilename;
 	char dcidstr[UUID_STR_SIZE];
 	union addrmap_u *amap;
-	unsigned int adrange;
 	const char *headers[argc];
 	int hi = 0;
+	bool genfn = false;
 
-	while ((opt = getopt(argc, argv, "h:c:u:i:")) >= 0) switch (opt) {
+	while ((opt = getopt(argc, argv, "h:c:u:i:f")) >= 0) switch (opt) {
 	case 'h':
 		hfilename = optarg;
 		break;
@@ -612,6 +924,9 @@ main(int argc, char *argv[])
 	case 'i':
 		headers[hi++] = optarg;
 		break;
+	case 'f':
+		genfn = true;
+		break;
 	default:
 		usage(true);
 		break;
@@ -638,16 +953,18 @@ main(int argc, char *argv[])
 	c_putheader(dcidstr, headers);
 	printprops(rootdev->ddlroot);
 
-	adrange = amap->srch.map[amap->srch.count - 1].adhi + 1 - amap->srch.map[0].adlo;
-	acnlogmark(lgDBUG, "Address range: %u", adrange);
-	if (adrange <= 32 || ((adrange * sizeof(void *)) / (amap->srch.count * sizeof(struct addrfind_s))) < 3) {
-		/* other criteria for conversion could be used */
-		acnlogmark(lgDBUG, "Transforming map\n");
-		xformtoindx(amap);
+	if (genfn) printfuncmap(&amap->srch);
+	else switch (choosemap(amap, CF_DMPMAP_MEMBUDGET)) {
+	case am_indx:
 		printindxmap(&amap->indx);
-	} else {
-		printtests(&amap->srch);
+		break;
+	case am_hybrid:
+		printhybrmap(&amap->hybr);
+		break;
+	default:
+		printtests(amap->srch.map, amap->srch.count);
 		printsrchmap(&amap->srch);
+		break;
 	}
 
 	h_putfooter();